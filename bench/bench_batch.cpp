@@ -0,0 +1,80 @@
+#include "../src/radix_trie.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <random>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+using Trie = Patricia::RadixTrie<std::string, int>;
+
+volatile size_t gSink;
+
+}
+
+int main() {
+    std::mt19937 random(4);
+    std::uniform_int_distribution<int> length(6, 24);
+    std::uniform_int_distribution<int> letter(0, 25);
+    std::vector<std::string> words;
+    for (size_t i = 0; i < (1 << 20); ++i) {
+        std::string word(length(random), 'a');
+        for (auto &c : word) {
+            c = static_cast<char>('a' + letter(random));
+        }
+        words.push_back(word);
+    }
+    std::vector<std::pair<std::string, int>> values;
+    for (size_t i = 0; i < words.size(); i += 2) {
+        values.emplace_back(words[i], 0);
+    }
+    Trie trie;
+    trie.build(values.begin(), values.end());
+    std::shuffle(words.begin(), words.end(), random);
+    std::vector<std::string_view> keys(words.begin(), words.end());
+
+    std::printf("%-8s %12s %12s %12s %8s\n", "batch", "find", "findBatch", "contains", "speedup");
+    for (size_t batch : {16, 64, 256, 1024}) {
+        std::vector<Trie::iterator> out(batch);
+        std::unique_ptr<bool[]> found(new bool[batch]);
+        size_t rounds = keys.size() / batch;
+
+        auto start = Clock::now();
+        size_t hits = 0;
+        for (size_t round = 0; round < rounds; ++round) {
+            for (size_t i = 0; i < batch; ++i) {
+                hits += trie.find(keys[round * batch + i]) != trie.end();
+            }
+        }
+        std::chrono::duration<double, std::nano> loop = Clock::now() - start;
+
+        start = Clock::now();
+        for (size_t round = 0; round < rounds; ++round) {
+            trie.findBatch(keys.data() + round * batch, batch, out.data());
+            for (size_t i = 0; i < batch; ++i) {
+                hits += out[i] != trie.end();
+            }
+        }
+        std::chrono::duration<double, std::nano> batched = Clock::now() - start;
+
+        start = Clock::now();
+        for (size_t round = 0; round < rounds; ++round) {
+            trie.containsBatch(keys.data() + round * batch, batch, found.get());
+            for (size_t i = 0; i < batch; ++i) {
+                hits += found[i];
+            }
+        }
+        std::chrono::duration<double, std::nano> contains = Clock::now() - start;
+        gSink = hits;
+
+        double lookups = static_cast<double>(rounds * batch);
+        std::printf("%-8zu %10.1fns %10.1fns %10.1fns %7.2fx\n", batch, loop.count() / lookups,
+                batched.count() / lookups, contains.count() / lookups, loop.count() / batched.count());
+    }
+    return 0;
+}
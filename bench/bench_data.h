@@ -0,0 +1,192 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <random>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+namespace Bench {
+
+// Deterministic key generators for the benchmarks. Only std::mt19937_64,
+// whose output the standard fixes, and plain modulo are used, so a seed
+// gives the same keys with every compiler and standard library.
+class Generator {
+public:
+    explicit Generator(uint64_t seed);
+    uint64_t below(uint64_t bound);
+    std::string nickname();
+    std::string url();
+    std::string ipv4();
+    std::string bytes();
+private:
+    std::mt19937_64 mRandom;
+};
+
+enum class Dataset {
+    Nickname,
+    Url,
+    Ipv4,
+    Bytes,
+    Uint32,
+    Uint64
+};
+
+const char* datasetName(Dataset dataset);
+
+bool isInteger(Dataset dataset);
+
+// count distinct keys of the given kind, in generation order.
+std::vector<std::string> generate(Dataset dataset, size_t count, uint64_t seed);
+
+// count distinct integer keys: IPv4 addresses for Uint32, spread out ids
+// for Uint64.
+template <typename T>
+std::vector<T> generateIntegers(Dataset dataset, size_t count, uint64_t seed);
+
+inline Generator::Generator(uint64_t seed)
+    : mRandom(seed) { }
+
+inline uint64_t Generator::below(uint64_t bound) {
+    return mRandom() % bound;
+}
+
+// Syllable names with the occasional digit suffix, like user handles:
+// many short keys sharing short prefixes.
+inline std::string Generator::nickname() {
+    static const char *syllables[] = {
+        "a", "al", "an", "ar", "ba", "be", "da", "de", "el", "er", "ga", "ia",
+        "ka", "ko", "la", "le", "li", "ma", "mi", "na", "ni", "ol", "ra", "ri",
+        "sa", "se", "sha", "ta", "to", "va", "vi", "xa", "ya", "yu", "za", "zo"
+    };
+    constexpr size_t count = sizeof(syllables) / sizeof(syllables[0]);
+    std::string result;
+    size_t parts = 2 + below(3);
+    for (size_t i = 0; i < parts; ++i) {
+        result += syllables[below(count)];
+    }
+    if (below(4) == 0) {
+        result += std::to_string(below(1000));
+    }
+    return result;
+}
+
+// URLs over a few hosts and a small path vocabulary: long keys with long
+// shared prefixes.
+inline std::string Generator::url() {
+    static const char *hosts[] = {
+        "example.com", "www.example.org", "cdn.static.example.net", "api.service.io",
+        "docs.project.dev", "shop.store.example", "news.daily.example", "img.cache.example"
+    };
+    static const char *segments[] = {
+        "api", "v1", "v2", "users", "items", "search", "static", "images", "assets",
+        "blog", "posts", "archive", "2019", "2020", "2021", "tags", "catalog", "page"
+    };
+    std::string result = below(8) == 0 ? "http://" : "https://";
+    result += hosts[below(sizeof(hosts) / sizeof(hosts[0]))];
+    size_t depth = 1 + below(4);
+    for (size_t i = 0; i < depth; ++i) {
+        result += '/';
+        result += segments[below(sizeof(segments) / sizeof(segments[0]))];
+    }
+    result += '/';
+    result += std::to_string(below(1000000));
+    if (below(3) == 0) {
+        result += "?page=" + std::to_string(below(50));
+    }
+    return result;
+}
+
+// Dotted quads drawn from a few hundred /16 networks, the way addresses
+// cluster in access logs.
+inline std::string Generator::ipv4() {
+    uint64_t network = below(256);
+    uint64_t first = 10 + network % 200;
+    uint64_t second = (network * 37) % 256;
+    return std::to_string(first) + "." + std::to_string(second) + "." +
+        std::to_string(below(256)) + "." + std::to_string(below(256));
+}
+
+// Binary keys of 4 to 32 bytes with every byte value equally likely.
+inline std::string Generator::bytes() {
+    std::string result(4 + below(29), '\0');
+    for (auto &c : result) {
+        c = static_cast<char>(below(256));
+    }
+    return result;
+}
+
+inline const char* datasetName(Dataset dataset) {
+    switch (dataset) {
+    case Dataset::Nickname:
+        return "nickname";
+    case Dataset::Url:
+        return "url";
+    case Dataset::Ipv4:
+        return "ipv4";
+    case Dataset::Bytes:
+        return "bytes";
+    case Dataset::Uint32:
+        return "u32";
+    case Dataset::Uint64:
+        return "u64";
+    }
+    return "unknown";
+}
+
+inline bool isInteger(Dataset dataset) {
+    return dataset == Dataset::Uint32 || dataset == Dataset::Uint64;
+}
+
+inline std::vector<std::string> generate(Dataset dataset, size_t count, uint64_t seed) {
+    Generator generator(seed);
+    std::unordered_set<std::string> seen;
+    std::vector<std::string> result;
+    result.reserve(count);
+    while (result.size() < count) {
+        std::string key;
+        switch (dataset) {
+        case Dataset::Nickname:
+            key = generator.nickname();
+            break;
+        case Dataset::Url:
+            key = generator.url();
+            break;
+        case Dataset::Ipv4:
+            key = generator.ipv4();
+            break;
+        case Dataset::Bytes:
+        default:
+            key = generator.bytes();
+            break;
+        }
+        if (seen.insert(key).second) {
+            result.push_back(std::move(key));
+        }
+    }
+    return result;
+}
+
+template <typename T>
+std::vector<T> generateIntegers(Dataset dataset, size_t count, uint64_t seed) {
+    Generator generator(seed);
+    std::unordered_set<T> seen;
+    std::vector<T> result;
+    result.reserve(count);
+    while (result.size() < count) {
+        T key;
+        if (dataset == Dataset::Uint32) {
+            uint64_t network = generator.below(256);
+            key = static_cast<T>((10 + network % 200) << 24 | ((network * 37) % 256) << 16 |
+                    generator.below(65536));
+        } else {
+            key = static_cast<T>(generator.below(~uint64_t(0)));
+        }
+        if (seen.insert(key).second) {
+            result.push_back(key);
+        }
+    }
+    return result;
+}
+
+} // namespace Bench
@@ -0,0 +1,80 @@
+#include "../src/radix_dawg.h"
+#include "../src/radix_frozen.h"
+#include "../src/radix_trie.h"
+#include "../src/nickname_io.h"
+#include "bench_data.h"
+#include <chrono>
+#include <cstdio>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+using Trie = Patricia::RadixTrie<std::string_view, int>;
+
+// One row: the trie, its frozen snapshot (the same nodes without pointers)
+// and the minimized graph with the heap bytes of all three, plus the find
+// cost of the last two. The ratio is that of the graph to the snapshot.
+void report(const char *name, const std::vector<std::string_view> &keys) {
+    std::vector<std::pair<std::string_view, int>> values;
+    for (size_t i = 0; i < keys.size(); ++i) {
+        values.emplace_back(keys[i], static_cast<int>(i));
+    }
+    Trie trie(values.begin(), values.end());
+    std::ostringstream snapshot;
+    Patricia::FrozenRadixTrie<int>::write(trie, snapshot);
+    auto bytes = snapshot.str();
+    Patricia::FrozenRadixTrie<int> frozen(bytes.data(), bytes.size());
+
+    auto start = Clock::now();
+    Patricia::RadixDawg<int> dawg(trie);
+    std::chrono::duration<double, std::milli> build = Clock::now() - start;
+
+    long checksum = 0;
+    start = Clock::now();
+    for (auto key : keys) {
+        checksum += frozen.find(key).value();
+    }
+    std::chrono::duration<double, std::nano> frozenFind = Clock::now() - start;
+    start = Clock::now();
+    for (auto key : keys) {
+        checksum -= dawg.value(dawg.index(key));
+    }
+    std::chrono::duration<double, std::nano> dawgFind = Clock::now() - start;
+    if (checksum != 0) {
+        std::fprintf(stderr, "bench_dawg: lookups disagree on %s\n", name);
+        std::exit(1);
+    }
+    double count = static_cast<double>(keys.size());
+    std::printf("%-10s %8zu %9zu %9zu %11zu %12zu %11zu %6.1f%% %9.1f %8.1f %8.1f\n", name, trie.size(),
+            frozen.nodeCount(), dawg.nodeCount(), trie.stats().heapBytes, frozen.bytes(), dawg.bytes(),
+            100.0 * static_cast<double>(dawg.bytes()) / static_cast<double>(frozen.bytes()),
+            frozenFind.count() / count, dawgFind.count() / count, build.count());
+}
+
+}
+
+// Memory of a minimized graph against the trie and its frozen snapshot on
+// the generated corpora and on any word list files given as arguments.
+int main(int argc, char **argv) {
+    std::printf("%-10s %8s %9s %9s %11s %12s %11s %7s %9s %8s %8s\n", "corpus", "keys", "nodes", "dawg", "trie bytes",
+            "frozen bytes", "dawg bytes", "ratio", "frozen ns", "dawg ns", "build ms");
+    for (auto dataset : {Bench::Dataset::Nickname, Bench::Dataset::Url, Bench::Dataset::Ipv4, Bench::Dataset::Bytes}) {
+        auto words = Bench::generate(dataset, 200000, 11);
+        std::vector<std::string_view> keys(words.begin(), words.end());
+        report(Bench::datasetName(dataset), keys);
+    }
+    for (int i = 1; i < argc; ++i) {
+        auto input = Patricia::InputBuffer::open(argv[i]);
+        std::vector<std::string_view> keys;
+        Patricia::forEachLine(input.data(), [&keys](std::string_view line) {
+            keys.push_back(line);
+        });
+        report(argv[i], keys);
+    }
+    return 0;
+}
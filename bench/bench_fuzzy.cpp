@@ -0,0 +1,86 @@
+#include "../src/radix_trie.h"
+#include "bench_data.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+using Trie = Patricia::RadixTrie<std::string, int>;
+
+// Levenshtein distance of two words, given up (returning bound + 1) once
+// a whole row exceeds bound: the usual brute-force scan.
+size_t boundedDistance(std::string_view left, std::string_view right, size_t bound, std::vector<size_t> &row) {
+    if ((left.size() > right.size() ? left.size() - right.size() : right.size() - left.size()) > bound) {
+        return bound + 1;
+    }
+    row.resize(right.size() + 1);
+    for (size_t j = 0; j < row.size(); ++j) {
+        row[j] = j;
+    }
+    for (size_t i = 1; i <= left.size(); ++i) {
+        size_t diagonal = row[0];
+        row[0] = i;
+        size_t smallest = row[0];
+        for (size_t j = 1; j <= right.size(); ++j) {
+            size_t above = row[j];
+            row[j] = std::min({row[j] + 1, row[j - 1] + 1, diagonal + (left[i - 1] != right[j - 1])});
+            diagonal = above;
+            smallest = std::min(smallest, row[j]);
+        }
+        if (smallest > bound) {
+            return bound + 1;
+        }
+    }
+    return row.back();
+}
+
+}
+
+int main() {
+    auto words = Bench::generate(Bench::Dataset::Nickname, 200000, 5);
+    Trie trie;
+    for (const auto &word : words) {
+        trie.insert(word, 0);
+    }
+    // Taken nicknames with one byte changed, like a user's second choice.
+    Bench::Generator generator(6);
+    std::vector<std::string> queries;
+    for (size_t i = 0; i < 500; ++i) {
+        auto query = words[generator.below(words.size())];
+        query[generator.below(query.size())] = static_cast<char>('a' + generator.below(26));
+        queries.push_back(query);
+    }
+
+    std::printf("%-9s %14s %14s %9s %10s\n", "distance", "scan us/query", "trie us/query", "speedup", "matches");
+    for (size_t distance : {1, 2}) {
+        std::vector<size_t> row;
+        size_t scanned = 0;
+        auto start = Clock::now();
+        for (const auto &query : queries) {
+            for (const auto &word : words) {
+                scanned += boundedDistance(word, query, distance, row) <= distance;
+            }
+        }
+        std::chrono::duration<double, std::micro> scan = Clock::now() - start;
+
+        size_t found = 0;
+        start = Clock::now();
+        for (const auto &query : queries) {
+            found += trie.fuzzyFind(query, distance).size();
+        }
+        std::chrono::duration<double, std::micro> walk = Clock::now() - start;
+        if (found != scanned) {
+            std::fprintf(stderr, "bench_fuzzy: %zu matches from the trie, %zu from the scan\n", found, scanned);
+            return 1;
+        }
+        double count = static_cast<double>(queries.size());
+        std::printf("%-9zu %14.1f %14.1f %8.1fx %10zu\n", distance, scan.count() / count, walk.count() / count,
+                scan.count() / walk.count(), found);
+    }
+    return 0;
+}
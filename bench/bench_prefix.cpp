@@ -0,0 +1,93 @@
+#include "../src/radix_trie.h"
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+using Kernel = size_t (*)(const char *, const char *, size_t);
+
+volatile size_t gSink;
+
+double measureKernel(Kernel kernel, const std::vector<std::string> &left,
+        const std::vector<std::string> &right, size_t rounds) {
+    auto start = Clock::now();
+    size_t sum = 0;
+    for (size_t round = 0; round < rounds; ++round) {
+        for (size_t i = 0; i < left.size(); ++i) {
+            sum += kernel(left[i].data(), right[i].data(), left[i].size());
+        }
+    }
+    gSink = sum;
+    std::chrono::duration<double, std::nano> elapsed = Clock::now() - start;
+    return elapsed.count() / (rounds * left.size());
+}
+
+void benchKernels() {
+    std::mt19937 random(1);
+    std::printf("%-8s %10s %10s %10s %10s\n", "length", "scalar", "sse2", "avx2", "dispatch");
+    for (size_t length : {8, 16, 32, 64, 128, 256, 1024, 4096}) {
+        std::vector<std::string> left;
+        std::vector<std::string> right;
+        for (size_t i = 0; i < 256; ++i) {
+            std::string text(length, 'a');
+            for (auto &c : text) {
+                c = static_cast<char>('a' + random() % 26);
+            }
+            left.push_back(text);
+            text[length - 1 - random() % (length / 8 + 1)] ^= 1;
+            right.push_back(text);
+        }
+        size_t rounds = 4000000 / (length * 16) + 16;
+        double scalar = measureKernel(Patricia::simd::mismatchScalar, left, right, rounds);
+        double sse2 = 0;
+        double avx2 = 0;
+#ifdef RADIX_HAVE_SSE2
+        sse2 = measureKernel(Patricia::simd::mismatchSse2, left, right, rounds);
+#endif
+#ifdef RADIX_HAVE_AVX2
+        if (Patricia::simd::hasAvx2()) {
+            avx2 = measureKernel(Patricia::simd::mismatchAvx2, left, right, rounds);
+        }
+#endif
+        double dispatch = measureKernel(Patricia::simd::mismatch, left, right, rounds);
+        std::printf("%-8zu %8.2fns %8.2fns %8.2fns %8.2fns\n", length, scalar, sse2, avx2, dispatch);
+    }
+}
+
+void benchTrie() {
+    std::mt19937 random(2);
+    std::printf("\n%-8s %12s %12s\n", "prefix", "insert", "find");
+    for (size_t prefix : {8, 64, 256, 1024}) {
+        std::string shared(prefix, 'p');
+        std::vector<std::string> keys;
+        for (size_t i = 0; i < 20000; ++i) {
+            keys.push_back(shared + "/" + std::to_string(random()) + "/" + shared);
+        }
+        Patricia::RadixTrie<std::string, int> trie;
+        auto start = Clock::now();
+        for (const auto &key : keys) {
+            trie.insert({key, 0});
+        }
+        std::chrono::duration<double, std::nano> insert = Clock::now() - start;
+        start = Clock::now();
+        size_t found = 0;
+        for (const auto &key : keys) {
+            found += trie.find(key) != trie.end();
+        }
+        std::chrono::duration<double, std::nano> find = Clock::now() - start;
+        gSink = found;
+        std::printf("%-8zu %10.1fns %10.1fns\n", prefix, insert.count() / keys.size(), find.count() / keys.size());
+    }
+}
+
+}
+
+int main() {
+    benchKernels();
+    benchTrie();
+    return 0;
+}
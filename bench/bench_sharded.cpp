@@ -0,0 +1,101 @@
+#include "../src/radix_sharded.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+using Sharded = Patricia::ShardedRadixTrie<std::string, int>;
+using Trie = Patricia::RadixTrie<std::string, int>;
+
+volatile size_t gSink;
+
+std::vector<std::string> makeKeys(size_t count) {
+    std::mt19937 random(3);
+    std::uniform_int_distribution<int> length(6, 20);
+    std::uniform_int_distribution<int> letter(0, 25);
+    std::vector<std::string> keys;
+    keys.reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+        std::string key(length(random), 'a');
+        for (auto &c : key) {
+            c = static_cast<char>('a' + letter(random));
+        }
+        keys.push_back(key);
+    }
+    return keys;
+}
+
+// Runs work(thread) on threads threads and returns million operations per
+// second for operations items in total.
+template <typename F>
+double measure(unsigned threads, size_t operations, F &&work) {
+    std::vector<std::thread> pool;
+    auto start = Clock::now();
+    for (unsigned t = 0; t < threads; ++t) {
+        pool.emplace_back(work, t);
+    }
+    for (auto &thread : pool) {
+        thread.join();
+    }
+    std::chrono::duration<double, std::micro> elapsed = Clock::now() - start;
+    return operations / elapsed.count();
+}
+
+}
+
+int main(int argc, char **argv) {
+    unsigned maxThreads = argc > 1 ? static_cast<unsigned>(std::atoi(argv[1])) : std::thread::hardware_concurrency();
+    if (maxThreads == 0) {
+        maxThreads = 1;
+    }
+    auto keys = makeKeys(1 << 20);
+    auto splits = Sharded::splitsFor(keys.begin(), keys.end(), 4 * maxThreads);
+    std::printf("%-8s %14s %14s %14s %14s\n", "threads", "insert", "find", "mutex insert", "mutex find");
+    std::vector<unsigned> counts;
+    for (unsigned threads = 1; threads < maxThreads; threads *= 2) {
+        counts.push_back(threads);
+    }
+    counts.push_back(maxThreads);
+    for (unsigned threads : counts) {
+        Sharded sharded(splits);
+        double insert = measure(threads, keys.size(), [&](unsigned t) {
+            for (size_t i = t; i < keys.size(); i += threads) {
+                sharded.insert(keys[i], 0);
+            }
+        });
+        double find = measure(threads, keys.size(), [&](unsigned t) {
+            size_t found = 0;
+            for (size_t i = t; i < keys.size(); i += threads) {
+                found += sharded.contains(keys[i]);
+            }
+            gSink = found;
+        });
+
+        Trie single;
+        std::mutex lock;
+        double mutexInsert = measure(threads, keys.size(), [&](unsigned t) {
+            for (size_t i = t; i < keys.size(); i += threads) {
+                std::lock_guard<std::mutex> guard(lock);
+                single.insert(keys[i], 0);
+            }
+        });
+        double mutexFind = measure(threads, keys.size(), [&](unsigned t) {
+            size_t found = 0;
+            for (size_t i = t; i < keys.size(); i += threads) {
+                std::lock_guard<std::mutex> guard(lock);
+                found += single.find(keys[i]) != single.end();
+            }
+            gSink = found;
+        });
+        std::printf("%-8u %9.2f Mop/s %9.2f Mop/s %9.2f Mop/s %9.2f Mop/s\n",
+                threads, insert, find, mutexInsert, mutexFind);
+    }
+    return 0;
+}
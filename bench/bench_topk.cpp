@@ -0,0 +1,61 @@
+#include "../src/radix_trie.h"
+#include "bench_data.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+using Trie = Patricia::RadixTrie<std::string, int, std::less<std::string>, Patricia::RadixArena,
+        Patricia::RadixScoreAugment<int>>;
+
+}
+
+int main() {
+    auto words = Bench::generate(Bench::Dataset::Nickname, 500000, 7);
+    Bench::Generator generator(8);
+    Trie trie;
+    for (const auto &word : words) {
+        trie.insert(word, static_cast<int>(generator.below(1000000)));
+    }
+    const size_t k = 10;
+    const size_t rounds = 200;
+
+    std::printf("%-8s %10s %14s %14s %9s\n", "prefix", "matches", "scan us/query", "topK us/query", "speedup");
+    for (std::string prefix : {"", "a", "ma", "mar", "mari"}) {
+        size_t matches = trie.count_prefix(prefix);
+        std::vector<int> scanned;
+        auto start = Clock::now();
+        for (size_t round = 0; round < rounds; ++round) {
+            scanned.clear();
+            for (const auto &entry : trie.prefixMatch(prefix)) {
+                scanned.push_back(entry.second);
+            }
+            auto middle = scanned.begin() + std::min(k, scanned.size());
+            std::partial_sort(scanned.begin(), middle, scanned.end(), std::greater<int>());
+            scanned.erase(middle, scanned.end());
+        }
+        std::chrono::duration<double, std::micro> scan = Clock::now() - start;
+
+        std::vector<int> best;
+        start = Clock::now();
+        for (size_t round = 0; round < rounds; ++round) {
+            best.clear();
+            for (auto it : trie.topK(prefix, k)) {
+                best.push_back(it->second);
+            }
+        }
+        std::chrono::duration<double, std::micro> search = Clock::now() - start;
+        if (best != scanned) {
+            std::fprintf(stderr, "bench_topk: topK disagrees with the scan for \"%s\"\n", prefix.c_str());
+            return 1;
+        }
+        double count = static_cast<double>(rounds);
+        std::printf("%-8s %10zu %14.1f %14.1f %8.1fx\n", prefix.empty() ? "\"\"" : prefix.c_str(), matches,
+                scan.count() / count, search.count() / count, scan.count() / search.count());
+    }
+    return 0;
+}
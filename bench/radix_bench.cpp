@@ -0,0 +1,496 @@
+#include "../src/nickname.h"
+#include "../src/radix_trie.h"
+#include "bench_data.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iterator>
+#include <map>
+#include <new>
+#include <set>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+// Every allocation of the process goes through these, so the live heap
+// bytes of a container are the difference of gLiveBytes around building it.
+// The size is kept in a header in front of the block.
+namespace {
+
+constexpr size_t AllocHeader = alignof(std::max_align_t);
+std::atomic<size_t> gLiveBytes{0};
+
+void* countedNew(size_t size) {
+    void *block = std::malloc(size + AllocHeader);
+    if (block == nullptr) {
+        throw std::bad_alloc();
+    }
+    *static_cast<size_t *>(block) = size;
+    gLiveBytes.fetch_add(size, std::memory_order_relaxed);
+    return static_cast<char *>(block) + AllocHeader;
+}
+
+void countedDelete(void *pointer) noexcept {
+    if (pointer == nullptr) {
+        return;
+    }
+    void *block = static_cast<char *>(pointer) - AllocHeader;
+    gLiveBytes.fetch_sub(*static_cast<size_t *>(block), std::memory_order_relaxed);
+    std::free(block);
+}
+
+}
+
+void* operator new(size_t size) {
+    return countedNew(size);
+}
+
+void* operator new[](size_t size) {
+    return countedNew(size);
+}
+
+void operator delete(void *pointer) noexcept {
+    countedDelete(pointer);
+}
+
+void operator delete[](void *pointer) noexcept {
+    countedDelete(pointer);
+}
+
+void operator delete(void *pointer, size_t) noexcept {
+    countedDelete(pointer);
+}
+
+void operator delete[](void *pointer, size_t) noexcept {
+    countedDelete(pointer);
+}
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+using Bench::Dataset;
+
+volatile size_t gSink;
+
+// Sink for the nickname workload: counts the bytes a real run would write.
+struct CountingSink {
+    CountingSink& operator<<(std::string_view text) {
+        bytes += text.size();
+        return *this;
+    }
+    size_t bytes = 0;
+};
+
+// One adapter per container under test, all with the same static
+// interface so the workloads are written once.
+// Integer keys select the crit-bit RadixTrie.
+template <typename Key>
+struct RadixAdapter {
+    using key = Key;
+    using type = Patricia::RadixTrie<Key, int>;
+    static constexpr const char *name = "RadixTrie";
+    static constexpr bool ordered = true;
+    static void insert(type &c, const Key &key) {
+        c.insert(key, 0);
+    }
+    static bool find(type &c, const Key &key) {
+        return c.find(key) != c.end();
+    }
+    static size_t prefix(type &c, const std::string &prefix) {
+        return c.count_prefix(prefix);
+    }
+    static void nickname(type &c, CountingSink &sink) {
+        Patricia::writeNicknames(c, sink);
+    }
+    static void erase(type &c, const Key &key) {
+        c.erase(key);
+    }
+};
+
+template <typename T>
+const T& keyOf(const T &value) {
+    return value;
+}
+
+template <typename K, typename V>
+const K& keyOf(const std::pair<const K, V> &value) {
+    return value.first;
+}
+
+// Something cheap that depends on the key, so iteration cannot be elided.
+inline size_t weight(const std::string &key) {
+    return key.size();
+}
+
+template <typename T>
+size_t weight(const T &key) {
+    return static_cast<size_t>(key);
+}
+
+template <typename T, bool Ordered>
+struct StdAdapter {
+    using key = typename T::key_type;
+    using type = T;
+    static constexpr bool ordered = Ordered;
+    static void insert(type &c, const key &k) {
+        if constexpr (std::is_same<typename T::value_type, key>::value) {
+            c.insert(k);
+        } else {
+            c.emplace(k, 0);
+        }
+    }
+    static bool find(type &c, const key &k) {
+        return c.find(k) != c.end();
+    }
+    // lower_bound and a walk for the ordered containers, a full scan for
+    // the hashed one.
+    static size_t prefix(type &c, const std::string &prefix) {
+        size_t count = 0;
+        if constexpr (Ordered) {
+            for (auto it = c.lower_bound(prefix); it != c.end(); ++it) {
+                if (keyOf(*it).compare(0, prefix.size(), prefix) != 0) {
+                    break;
+                }
+                ++count;
+            }
+        } else {
+            for (const auto &value : c) {
+                count += keyOf(value).compare(0, prefix.size(), prefix) == 0;
+            }
+        }
+        return count;
+    }
+    static void nickname(type &c, CountingSink &sink) {
+        Patricia::NicknameStream<CountingSink> stream(sink);
+        for (const auto &value : c) {
+            stream.push(keyOf(value));
+        }
+        stream.finish();
+    }
+    static void erase(type &c, const key &k) {
+        c.erase(k);
+    }
+};
+
+template <typename Key>
+struct MapAdapter : StdAdapter<std::map<Key, int>, true> {
+    static constexpr const char *name = "std::map";
+};
+
+template <typename Key>
+struct SetAdapter : StdAdapter<std::set<Key>, true> {
+    static constexpr const char *name = "std::set";
+};
+
+template <typename Key>
+struct UnorderedAdapter : StdAdapter<std::unordered_map<Key, int>, false> {
+    static constexpr const char *name = "std::unordered_map";
+};
+
+struct Result {
+    std::string dataset;
+    std::string container;
+    std::string workload;
+    size_t keys;
+    double nsPerOp;
+    double bytesPerKey;
+    long peakRssKb;
+};
+
+template <typename Key>
+struct Workload {
+    std::vector<Key> hits;
+    std::vector<Key> misses;
+    std::vector<Key> shuffled;
+    std::vector<Key> prefixes;
+};
+
+// The first half of the generated keys is inserted, the second half only
+// looked up. Prefix queries exist for string keys only.
+template <typename Key>
+Workload<Key> prepare(Dataset dataset, size_t keys, uint64_t seed) {
+    Workload<Key> result;
+    std::vector<Key> all;
+    if constexpr (std::is_same<Key, std::string>::value) {
+        all = Bench::generate(dataset, keys * 2, seed);
+    } else {
+        all = Bench::generateIntegers<Key>(dataset, keys * 2, seed);
+    }
+    result.hits.assign(all.begin(), all.begin() + keys);
+    result.misses.assign(all.begin() + keys, all.end());
+    result.shuffled = result.hits;
+    Bench::Generator generator(seed + 1);
+    for (size_t i = result.shuffled.size(); i > 1; --i) {
+        std::swap(result.shuffled[i - 1], result.shuffled[generator.below(i)]);
+    }
+    if constexpr (std::is_same<Key, std::string>::value) {
+        for (size_t i = 0; i < result.shuffled.size() && i < 1000; ++i) {
+            const auto &key = result.shuffled[i];
+            result.prefixes.push_back(key.substr(0, (key.size() * 2 + 2) / 3));
+        }
+    }
+    return result;
+}
+
+long peakRssKb() {
+    struct rusage usage;
+    ::getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss;
+}
+
+template <typename F>
+double nsPerOp(size_t ops, F &&fn) {
+    auto start = Clock::now();
+    fn();
+    std::chrono::duration<double, std::nano> elapsed = Clock::now() - start;
+    return ops == 0 ? 0.0 : elapsed.count() / static_cast<double>(ops);
+}
+
+// Runs every workload on a fresh container of adapter A. Erase goes last
+// since it empties the container.
+template <typename A>
+std::vector<Result> measure(const std::string &dataset, const Workload<typename A::key> &work) {
+    std::vector<Result> timings;
+    auto record = [&](const char *workload, double ns) {
+        timings.push_back(Result{dataset, A::name, workload, work.hits.size(), ns, 0.0, 0});
+    };
+    {
+        size_t before = gLiveBytes.load();
+        size_t bytes = 0;
+        typename A::type container;
+        record("insert", nsPerOp(work.hits.size(), [&] {
+            for (const auto &key : work.hits) {
+                A::insert(container, key);
+            }
+            bytes = gLiveBytes.load() - before;
+        }));
+
+        size_t found = 0;
+        record("find_hit", nsPerOp(work.shuffled.size(), [&] {
+            for (const auto &key : work.shuffled) {
+                found += A::find(container, key);
+            }
+        }));
+        record("find_miss", nsPerOp(work.misses.size(), [&] {
+            for (const auto &key : work.misses) {
+                found += A::find(container, key);
+            }
+        }));
+        record("iterate", nsPerOp(work.hits.size(), [&] {
+            for (const auto &value : container) {
+                found += weight(keyOf(value));
+            }
+        }));
+        if constexpr (std::is_same<typename A::key, std::string>::value) {
+            size_t queries = A::ordered ? work.prefixes.size() : std::min<size_t>(work.prefixes.size(), 16);
+            record("prefix_scan", nsPerOp(queries, [&] {
+                for (size_t i = 0; i < queries; ++i) {
+                    found += A::prefix(container, work.prefixes[i]);
+                }
+            }));
+            if (A::ordered) {
+                CountingSink sink;
+                record("nickname", nsPerOp(work.hits.size(), [&] {
+                    A::nickname(container, sink);
+                }));
+                found += sink.bytes;
+            }
+        }
+        record("erase", nsPerOp(work.shuffled.size(), [&] {
+            for (const auto &key : work.shuffled) {
+                A::erase(container, key);
+            }
+        }));
+        gSink = found;
+        for (auto &timing : timings) {
+            timing.bytesPerKey = static_cast<double>(bytes) / static_cast<double>(work.hits.size());
+        }
+    }
+    long rss = peakRssKb();
+    for (auto &timing : timings) {
+        timing.peakRssKb = rss;
+    }
+    return timings;
+}
+
+std::string serialize(const std::vector<Result> &results) {
+    std::ostringstream out;
+    for (const auto &result : results) {
+        out << result.dataset << '\t' << result.container << '\t' << result.workload << '\t'
+            << result.keys << '\t' << result.nsPerOp << '\t' << result.bytesPerKey << '\t'
+            << result.peakRssKb << '\n';
+    }
+    return out.str();
+}
+
+std::vector<Result> deserialize(const std::string &text) {
+    std::vector<Result> results;
+    std::istringstream in(text);
+    std::string line;
+    while (std::getline(in, line)) {
+        std::istringstream fields(line);
+        Result result;
+        std::getline(fields, result.dataset, '\t');
+        std::getline(fields, result.container, '\t');
+        std::getline(fields, result.workload, '\t');
+        fields >> result.keys >> result.nsPerOp >> result.bytesPerKey >> result.peakRssKb;
+        results.push_back(result);
+    }
+    return results;
+}
+
+// Measures in a forked child so that peak RSS belongs to one container and
+// the allocator state of one run does not leak into the next. The dataset
+// is generated before the fork, so its pages count towards every child.
+template <typename A>
+std::vector<Result> isolated(const std::string &dataset, const Workload<typename A::key> &work) {
+    int fds[2];
+    if (::pipe(fds) != 0) {
+        return measure<A>(dataset, work);
+    }
+    std::fflush(stdout);
+    pid_t pid = ::fork();
+    if (pid < 0) {
+        ::close(fds[0]);
+        ::close(fds[1]);
+        return measure<A>(dataset, work);
+    }
+    if (pid == 0) {
+        ::close(fds[0]);
+        auto text = serialize(measure<A>(dataset, work));
+        const char *data = text.data();
+        size_t left = text.size();
+        while (left > 0) {
+            ssize_t count = ::write(fds[1], data, left);
+            if (count <= 0) {
+                ::_exit(1);
+            }
+            data += count;
+            left -= static_cast<size_t>(count);
+        }
+        ::_exit(0);
+    }
+    ::close(fds[1]);
+    std::string text;
+    char buffer[4096];
+    ssize_t count;
+    while ((count = ::read(fds[0], buffer, sizeof(buffer))) > 0) {
+        text.append(buffer, static_cast<size_t>(count));
+    }
+    ::close(fds[0]);
+    int status = 0;
+    ::waitpid(pid, &status, 0);
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+        std::fprintf(stderr, "radix_bench: %s on %s failed\n", A::name, dataset.c_str());
+        return {};
+    }
+    return deserialize(text);
+}
+
+void printCsv(const std::vector<Result> &results) {
+    std::printf("dataset,container,workload,keys,ns_per_op,bytes_per_key,peak_rss_kb\n");
+    for (const auto &result : results) {
+        std::printf("%s,%s,%s,%zu,%.2f,%.2f,%ld\n", result.dataset.c_str(), result.container.c_str(),
+                result.workload.c_str(), result.keys, result.nsPerOp, result.bytesPerKey, result.peakRssKb);
+    }
+}
+
+void printJson(const std::vector<Result> &results, uint64_t seed) {
+    std::printf("{\n  \"seed\": %llu,\n  \"results\": [\n", static_cast<unsigned long long>(seed));
+    for (size_t i = 0; i < results.size(); ++i) {
+        const auto &result = results[i];
+        std::printf("    {\"dataset\": \"%s\", \"container\": \"%s\", \"workload\": \"%s\", \"keys\": %zu, "
+                "\"ns_per_op\": %.2f, \"bytes_per_key\": %.2f, \"peak_rss_kb\": %ld}%s\n",
+                result.dataset.c_str(), result.container.c_str(), result.workload.c_str(), result.keys,
+                result.nsPerOp, result.bytesPerKey, result.peakRssKb, i + 1 < results.size() ? "," : "");
+    }
+    std::printf("  ]\n}\n");
+}
+
+void usage() {
+    std::fprintf(stderr, "usage: radix_bench [--keys n] [--seed n] [--format csv|json] "
+            "[--dataset nickname|url|ipv4|bytes|u32|u64]...\n");
+}
+
+template <typename Key>
+void runDataset(Dataset dataset, size_t keys, uint64_t seed, std::vector<Result> &results) {
+    std::string name = Bench::datasetName(dataset);
+    auto work = prepare<Key>(dataset, keys, seed);
+    for (auto part : {isolated<RadixAdapter<Key>>(name, work), isolated<MapAdapter<Key>>(name, work),
+            isolated<SetAdapter<Key>>(name, work), isolated<UnorderedAdapter<Key>>(name, work)}) {
+        results.insert(results.end(), part.begin(), part.end());
+    }
+}
+
+}
+
+int main(int argc, char *argv[]) {
+    size_t keys = 200000;
+    uint64_t seed = 1;
+    bool json = false;
+    std::vector<Dataset> datasets;
+    const Dataset known[] = {Dataset::Nickname, Dataset::Url, Dataset::Ipv4, Dataset::Bytes,
+        Dataset::Uint32, Dataset::Uint64};
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (i + 1 >= argc) {
+            usage();
+            return 2;
+        }
+        std::string value = argv[++i];
+        if (arg == "--keys") {
+            keys = std::strtoull(value.c_str(), nullptr, 10);
+        } else if (arg == "--seed") {
+            seed = std::strtoull(value.c_str(), nullptr, 10);
+        } else if (arg == "--format" && (value == "csv" || value == "json")) {
+            json = value == "json";
+        } else if (arg == "--dataset") {
+            size_t before = datasets.size();
+            for (auto dataset : known) {
+                if (value == Bench::datasetName(dataset)) {
+                    datasets.push_back(dataset);
+                }
+            }
+            if (datasets.size() == before) {
+                usage();
+                return 2;
+            }
+        } else {
+            usage();
+            return 2;
+        }
+    }
+    if (keys == 0) {
+        usage();
+        return 2;
+    }
+    if (datasets.empty()) {
+        datasets.assign(std::begin(known), std::end(known));
+    }
+
+    std::vector<Result> results;
+    for (auto dataset : datasets) {
+        if (dataset == Dataset::Uint32) {
+            runDataset<uint32_t>(dataset, keys, seed, results);
+        } else if (dataset == Dataset::Uint64) {
+            runDataset<uint64_t>(dataset, keys, seed, results);
+        } else {
+            runDataset<std::string>(dataset, keys, seed, results);
+        }
+    }
+    if (json) {
+        printJson(results, seed);
+    } else {
+        printCsv(results);
+    }
+    return 0;
+}
@@ -1,19 +1,243 @@
 #include <iostream>
+#include <sstream>
 #include "src/radix_trie.h"
+#include "src/nickname.h"
+#include "src/nickname_io.h"
+#include <algorithm>
+#include <chrono>
 #include <string>
+#include <thread>
+#include <string_view>
+#include <utility>
+#include <vector>
+#include <unistd.h>
 
 using namespace std::string_literals;
-int main(int argc, char **argv) {
-    (void) argc;
-    (void) argv;
-    Patricia::RadixTrie<std::string, int> t;
-    for (std::string line; getline(std::cin, line);) {
-        t.insert({line, 0});
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+struct Options {
+    bool sorted = false;
+    bool check = false;
+    bool timing = false;
+    bool stats = false;
+    bool threadsSet = false;
+    unsigned threads = 0;
+    std::string freeze;
+    std::string snapshot;
+    std::vector<std::string> files;
+};
+
+// Wall time of each phase. Reading overlaps iteration when input is
+// streamed, and write is the part of iteration spent inside write(2).
+struct Timing {
+    Clock::duration read{};
+    Clock::duration build{};
+    Clock::duration iterate{};
+    Clock::duration write{};
+};
+
+int usage() {
+    std::cerr << "usage: nickname [--sorted] [--check] [--timing] [--stats] [--threads n] [--freeze out] [file...]" << std::endl
+        << "       nickname [--timing] --snapshot file" << std::endl
+        << "  --sorted    input is sorted, stream nicknames without building a trie" << std::endl
+        << "  --check     compute nicknames both ways and compare the results" << std::endl
+        << "  --timing    report read, build, iterate and write times on stderr" << std::endl
+        << "  --stats     print trie statistics instead of the tree" << std::endl
+        << "  --threads   build and write with n threads, 0 (default) for all cores on large inputs" << std::endl
+        << "  --freeze    also save the built trie as a snapshot to out" << std::endl
+        << "  --snapshot  answer from a snapshot written by --freeze instead of input" << std::endl
+        << "Files are memory mapped; with no file or \"-\" standard input is read." << std::endl;
+    return 2;
+}
+
+double milliseconds(Clock::duration duration) {
+    return std::chrono::duration<double, std::milli>(duration).count();
+}
+
+void report(const Timing &timing) {
+    std::cerr << "nickname: read " << milliseconds(timing.read) << " ms, build "
+        << milliseconds(timing.build) << " ms, iterate "
+        << milliseconds(timing.iterate) << " ms, write "
+        << milliseconds(timing.write) << " ms" << std::endl;
+}
+
+// Loads every input; the returned buffers own the bytes the line views in
+// lines point into.
+std::vector<Patricia::InputBuffer> readInputs(const Options &options,
+        std::vector<std::pair<std::string_view, int>> &lines) {
+    std::vector<Patricia::InputBuffer> inputs;
+    if (options.files.empty()) {
+        inputs.push_back(Patricia::InputBuffer::read(STDIN_FILENO));
     }
-    for (auto it = t.begin(); it != t.end(); ++it) {
-        std::cout << it->first << " ";
-        std::cout << it->first.substr(0, it->first.size() - it.node()->parent()->key().size() + 1) << std::endl;
+    for (const auto &file : options.files) {
+        inputs.push_back(file == "-" ? Patricia::InputBuffer::read(STDIN_FILENO)
+                : Patricia::InputBuffer::open(file));
     }
+    for (const auto &input : inputs) {
+        Patricia::forEachLine(input.data(), [&lines](std::string_view line) {
+            lines.emplace_back(line, 0);
+        });
+    }
+    return inputs;
+}
+
+int runTrie(const Options &options) {
+    Timing timing;
+    auto start = Clock::now();
+    std::vector<std::pair<std::string_view, int>> lines;
+    auto inputs = readInputs(options, lines);
+    auto loaded = Clock::now();
+    timing.read = loaded - start;
+
+    Patricia::RadixTrie<std::string_view, int> t;
+    t.build(lines.begin(), lines.end(), false, options.threads);
+    lines = {};
+    auto built = Clock::now();
+    timing.build = built - loaded;
+
+    unsigned threads = options.threads;
+    if (threads == 0) {
+        threads = t.size() >= t.ParallelBuildThreshold ? std::max(1u, std::thread::hardware_concurrency()) : 1;
+    }
+    Patricia::BufferedWriter out(STDOUT_FILENO);
+    Patricia::writeNicknames(t, out, threads);
+    out.flush();
+    timing.write = out.writeTime();
+    timing.iterate = Clock::now() - built - timing.write;
+    t.dump(options.stats ? Patricia::RadixDump::Summary : Patricia::RadixDump::Tree, std::cout, threads);
+    if (!options.freeze.empty()) {
+        Patricia::FrozenRadixTrie<int>::write(t, options.freeze);
+    }
+    if (options.timing) {
+        report(timing);
+    }
+    return 0;
+}
+
+// Startup is one mmap and a bounds check over the nodes, since the file may
+// come from anywhere: nothing is built, so build time is zero, and the
+// check faults in the node sections that iteration reads anyway.
+int runSnapshot(const Options &options) {
+    Timing timing;
+    auto start = Clock::now();
+    auto t = Patricia::FrozenRadixTrie<int>::open(options.snapshot);
+    t.verify();
+    auto loaded = Clock::now();
+    timing.read = loaded - start;
+
+    Patricia::BufferedWriter out(STDOUT_FILENO);
+    Patricia::writeNicknames(t, out);
+    out.flush();
+    timing.write = out.writeTime();
+    timing.iterate = Clock::now() - loaded - timing.write;
     t.dump();
+    if (options.timing) {
+        report(timing);
+    }
+    return 0;
+}
+
+int runSorted(const Options &options) {
+    Timing timing;
+    auto start = Clock::now();
+    Patricia::BufferedWriter out(STDOUT_FILENO);
+    Patricia::NicknameStream stream(out);
+    auto push = [&stream](std::string_view line) {
+        stream.push(line);
+    };
+    if (options.files.empty()) {
+        Patricia::forEachLine(STDIN_FILENO, push);
+    }
+    for (const auto &file : options.files) {
+        if (file == "-") {
+            Patricia::forEachLine(STDIN_FILENO, push);
+            continue;
+        }
+        auto mapped = Clock::now();
+        auto input = Patricia::InputBuffer::open(file);
+        timing.read += Clock::now() - mapped;
+        Patricia::forEachLine(input.data(), push);
+    }
+    stream.finish();
+    out.flush();
+    timing.write = out.writeTime();
+    timing.iterate = Clock::now() - start - timing.read - timing.write;
+    if (options.timing) {
+        report(timing);
+    }
+    return 0;
+}
+
+int runCheck(const Options &options) {
+    std::vector<std::pair<std::string_view, int>> lines;
+    auto inputs = readInputs(options, lines);
+    Patricia::RadixTrie<std::string_view, int> t;
+    std::ostringstream streamed;
+    Patricia::NicknameStream stream(streamed);
+    for (const auto &line : lines) {
+        t.insert(line);
+        stream.push(line.first);
+    }
+    stream.finish();
+    std::ostringstream built;
+    Patricia::writeNicknames(t, built);
+    if (streamed.str() != built.str()) {
+        std::cerr << "nickname: streaming and trie output differ" << std::endl;
+        return 1;
+    }
+    std::cerr << "nickname: " << t.size() << " nicknames match" << std::endl;
     return 0;
 }
+
+}
+
+int main(int argc, char **argv) {
+    Options options;
+    for (int i = 1; i < argc; ++i) {
+        std::string_view arg(argv[i]);
+        if (arg == "--sorted") {
+            options.sorted = true;
+        } else if (arg == "--check") {
+            options.check = true;
+        } else if (arg == "--timing") {
+            options.timing = true;
+        } else if (arg == "--stats") {
+            options.stats = true;
+        } else if (arg == "--threads" && i + 1 < argc) {
+            std::string_view count(argv[++i]);
+            if (count.empty() || count.size() > 4 || count.find_first_not_of("0123456789") != std::string_view::npos) {
+                return usage();
+            }
+            options.threads = static_cast<unsigned>(std::stoul(std::string(count)));
+            options.threadsSet = true;
+        } else if ((arg == "--freeze" || arg == "--snapshot") && i + 1 < argc) {
+            (arg == "--freeze" ? options.freeze : options.snapshot) = argv[++i];
+        } else if (arg == "-" || arg.substr(0, 1) != "-") {
+            options.files.emplace_back(arg);
+        } else {
+            return usage();
+        }
+    }
+    if (!options.snapshot.empty() && (options.sorted || options.check || options.stats || options.threadsSet ||
+            !options.freeze.empty() || !options.files.empty())) {
+        return usage();
+    }
+    if ((!options.freeze.empty() || options.stats || options.threadsSet) && (options.sorted || options.check)) {
+        return usage();
+    }
+    try {
+        if (!options.snapshot.empty()) {
+            return runSnapshot(options);
+        }
+        if (options.check) {
+            return runCheck(options);
+        }
+        return options.sorted ? runSorted(options) : runTrie(options);
+    } catch (const std::exception &e) {
+        std::cerr << "nickname: " << e.what() << std::endl;
+        return 1;
+    }
+}
@@ -0,0 +1,136 @@
+#pragma once
+#include "radix_trie.h"
+#include "radix_frozen.h"
+#include "nickname_io.h"
+#include <algorithm>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+namespace Patricia {
+
+// Length of the shortest prefix that tells the key stored at node apart
+// from every other key: a leaf needs its path up to the first byte of its
+// own edge, a key that is a prefix of other keys needs all of itself.
+template <typename K, typename V, class C, class G>
+size_t nicknameLength(RadixNode<K, V, C, G> *node) {
+    if (node->empty()) {
+        return node->depth() + 1;
+    }
+    return node->depth() + radixSize(node->key());
+}
+
+inline size_t nicknameLength(const FrozenRadixNode *node) {
+    if (node->empty()) {
+        return node->depth() + 1;
+    }
+    return node->depth() + node->size();
+}
+
+// Writes "key nickname" lines in key order. O is any sink with operator<<
+// for string views: a std::ostream or a BufferedWriter.
+template <typename T, typename O>
+void writeNicknames(T &trie, O &out) {
+    writeNicknames(trie.begin(), trie.end(), out);
+}
+
+template <typename I, typename O>
+void writeNicknames(I first, I last, O &out) {
+    for (auto it = first; it != last; ++it) {
+        auto key = std::string_view(it->first);
+        out << key << " " << key.substr(0, nicknameLength(it.node())) << "\n";
+    }
+}
+
+// writeNicknames on threads workers, 0 picking hardware concurrency for
+// tries of ParallelBuildThreshold keys and more. Each range of split() is
+// formatted into its own buffer and the buffers are written in key order,
+// so the output is byte for byte that of the sequential pass.
+template <typename K, typename V, typename C, typename A, typename G, typename O>
+void writeNicknames(RadixTrie<K, V, C, A, G> &trie, O &out, unsigned threads) {
+    using trie_type = RadixTrie<K, V, C, A, G>;
+    if (threads == 0) {
+        threads = trie.size() >= trie_type::ParallelBuildThreshold
+            ? std::max(1u, std::thread::hardware_concurrency()) : 1;
+    }
+    if (threads <= 1) {
+        writeNicknames(trie, out);
+        return;
+    }
+    auto ranges = trie.split(threads * trie_type::TasksPerThread);
+    std::vector<std::string> buffers(ranges.size());
+    radixParallelFor(ranges.size(), threads, [&ranges, &buffers](size_t task) {
+        StringWriter writer(buffers[task]);
+        writeNicknames(ranges[task].begin(), ranges[task].end(), writer);
+    });
+    for (const auto &buffer : buffers) {
+        out << std::string_view(buffer);
+    }
+}
+
+// Single pass nickname computation for input that is already sorted. Each
+// word's nickname depends only on its longest common prefix with the two
+// neighbours, so only the previous and the current word are kept.
+template <typename O = std::ostream>
+class NicknameStream {
+public:
+    explicit NicknameStream(O &out);
+    void push(std::string_view word);
+    void finish();
+private:
+    void emit(size_t nextCommon);
+    O &mOut;
+    std::string mCurrent;
+    size_t mPreviousCommon;
+    bool mHasCurrent;
+};
+
+template <typename O>
+NicknameStream<O>::NicknameStream(O &out)
+    : mOut(out),
+    mCurrent(),
+    mPreviousCommon(0),
+    mHasCurrent(false) { }
+
+template <typename O>
+void NicknameStream<O>::push(std::string_view word) {
+    if (!mHasCurrent) {
+        mCurrent.assign(word);
+        mHasCurrent = true;
+        return;
+    }
+    int order = radixCompare(word, std::string_view(mCurrent));
+    if (order == 0) {
+        return;
+    }
+    if (order < 0) {
+        throw std::invalid_argument("Input is not sorted: \"" + std::string(word) +
+                "\" follows \"" + mCurrent + "\"");
+    }
+    size_t common = radixCommonPrefix(std::string_view(mCurrent), word);
+    emit(common);
+    mCurrent.assign(word);
+    mPreviousCommon = common;
+}
+
+template <typename O>
+void NicknameStream<O>::finish() {
+    if (mHasCurrent) {
+        emit(0);
+        mHasCurrent = false;
+        mPreviousCommon = 0;
+    }
+}
+
+template <typename O>
+void NicknameStream<O>::emit(size_t nextCommon) {
+    size_t length = (mPreviousCommon > nextCommon ? mPreviousCommon : nextCommon) + 1;
+    if (length > mCurrent.size()) {
+        length = mCurrent.size();
+    }
+    auto current = std::string_view(mCurrent);
+    mOut << current << " " << current.substr(0, length) << "\n";
+}
+
+} // namespace Patricia
@@ -0,0 +1,314 @@
+#pragma once
+#include "radix_simd.h"
+#include <cerrno>
+#include <cstring>
+#include <chrono>
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <utility>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace Patricia {
+
+// Whole input held in memory: a read-only private mapping of a regular file,
+// or the bytes read from a descriptor that cannot be mapped (pipes,
+// terminals). Views into data() stay valid for the lifetime of the buffer.
+class InputBuffer {
+public:
+    static constexpr size_t ChunkSize = 1 << 20;
+
+    InputBuffer();
+    InputBuffer(InputBuffer &&other) noexcept;
+    InputBuffer& operator=(InputBuffer &&other) noexcept;
+    ~InputBuffer();
+
+    static InputBuffer open(const std::string &path);
+    static InputBuffer read(int fd);
+    std::string_view data() const;
+    bool mapped() const;
+private:
+    InputBuffer(const InputBuffer &) = delete;
+    InputBuffer& operator=(const InputBuffer &) = delete;
+    void reset();
+private:
+    void *mMap;
+    size_t mMapSize;
+    std::vector<char> mBytes;
+};
+
+// Calls fn(line) for every '\n' terminated line of data, the last line may
+// lack the terminator. Same splitting as std::getline.
+template <typename F>
+void forEachLine(std::string_view data, F &&fn);
+
+// Streams the lines read from fd in ChunkSize reads; only the current chunk
+// and the unfinished line carried over from the previous one are kept, so
+// each view passed to fn is valid until fn returns.
+template <typename F>
+void forEachLine(int fd, F &&fn);
+
+// Output buffer over a descriptor. Nothing is flushed per line; the buffer
+// goes out with one write(2) when full, on flush() and on destruction. The
+// time spent inside write(2) is accumulated for --timing.
+class BufferedWriter {
+public:
+    static constexpr size_t DefaultCapacity = 1 << 20;
+
+    explicit BufferedWriter(int fd, size_t capacity = DefaultCapacity);
+    ~BufferedWriter();
+
+    BufferedWriter& operator<<(std::string_view text);
+    BufferedWriter& operator<<(char c);
+    void flush();
+    std::chrono::nanoseconds writeTime() const;
+private:
+    BufferedWriter(const BufferedWriter &) = delete;
+    BufferedWriter& operator=(const BufferedWriter &) = delete;
+    void writeAll(const char *data, size_t size);
+private:
+    int mFd;
+    std::vector<char> mBuffer;
+    size_t mUsed;
+    std::chrono::nanoseconds mWriteTime;
+};
+
+// Sink appending to a string, for output assembled in memory before it is
+// written, e.g. one buffer per task of a parallel pass.
+class StringWriter {
+public:
+    explicit StringWriter(std::string &text);
+
+    StringWriter& operator<<(std::string_view text);
+    StringWriter& operator<<(char c);
+private:
+    std::string &mText;
+};
+
+inline InputBuffer::InputBuffer()
+    : mMap(nullptr),
+    mMapSize(0),
+    mBytes() { }
+
+inline InputBuffer::InputBuffer(InputBuffer &&other) noexcept
+    : mMap(std::exchange(other.mMap, nullptr)),
+    mMapSize(std::exchange(other.mMapSize, 0)),
+    mBytes(std::move(other.mBytes)) { }
+
+inline InputBuffer& InputBuffer::operator=(InputBuffer &&other) noexcept {
+    if (this != &other) {
+        reset();
+        mMap = std::exchange(other.mMap, nullptr);
+        mMapSize = std::exchange(other.mMapSize, 0);
+        mBytes = std::move(other.mBytes);
+    }
+    return *this;
+}
+
+inline InputBuffer::~InputBuffer() {
+    reset();
+}
+
+inline void InputBuffer::reset() {
+    if (mMap != nullptr) {
+        ::munmap(mMap, mMapSize);
+        mMap = nullptr;
+        mMapSize = 0;
+    }
+    mBytes.clear();
+}
+
+// Maps path when it is a non-empty regular file and falls back to reading
+// it otherwise.
+inline InputBuffer InputBuffer::open(const std::string &path) {
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        throw std::system_error(errno, std::generic_category(), path);
+    }
+    InputBuffer result;
+    struct stat info;
+    if (::fstat(fd, &info) == 0 && S_ISREG(info.st_mode) && info.st_size > 0) {
+        size_t size = static_cast<size_t>(info.st_size);
+        void *map = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (map != MAP_FAILED) {
+            ::madvise(map, size, MADV_SEQUENTIAL);
+            ::close(fd);
+            result.mMap = map;
+            result.mMapSize = size;
+            return result;
+        }
+    }
+    try {
+        result = read(fd);
+    } catch (...) {
+        ::close(fd);
+        throw;
+    }
+    ::close(fd);
+    return result;
+}
+
+inline InputBuffer InputBuffer::read(int fd) {
+    InputBuffer result;
+    size_t used = 0;
+    for (;;) {
+        if (result.mBytes.size() - used < ChunkSize) {
+            result.mBytes.resize(used + ChunkSize);
+        }
+        ssize_t count = ::read(fd, result.mBytes.data() + used, ChunkSize);
+        if (count < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            throw std::system_error(errno, std::generic_category(), "read");
+        }
+        if (count == 0) {
+            break;
+        }
+        used += static_cast<size_t>(count);
+    }
+    result.mBytes.resize(used);
+    return result;
+}
+
+inline std::string_view InputBuffer::data() const {
+    if (mMap != nullptr) {
+        return std::string_view(static_cast<const char *>(mMap), mMapSize);
+    }
+    return std::string_view(mBytes.data(), mBytes.size());
+}
+
+inline bool InputBuffer::mapped() const {
+    return mMap != nullptr;
+}
+
+template <typename F>
+void forEachLine(std::string_view data, F &&fn) {
+    const char *cursor = data.data();
+    size_t left = data.size();
+    while (left > 0) {
+        size_t length = simd::findByte(cursor, left, '\n');
+        fn(std::string_view(cursor, length));
+        if (length == left) {
+            break;
+        }
+        cursor += length + 1;
+        left -= length + 1;
+    }
+}
+
+template <typename F>
+void forEachLine(int fd, F &&fn) {
+    std::vector<char> buffer(InputBuffer::ChunkSize);
+    size_t carried = 0;
+    for (;;) {
+        if (buffer.size() - carried < InputBuffer::ChunkSize / 2) {
+            buffer.resize(buffer.size() * 2);
+        }
+        ssize_t count = ::read(fd, buffer.data() + carried, buffer.size() - carried);
+        if (count < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            throw std::system_error(errno, std::generic_category(), "read");
+        }
+        if (count == 0) {
+            break;
+        }
+        const char *begin = buffer.data();
+        size_t left = carried + static_cast<size_t>(count);
+        for (;;) {
+            size_t length = simd::findByte(begin, left, '\n');
+            if (length == left) {
+                break;
+            }
+            fn(std::string_view(begin, length));
+            begin += length + 1;
+            left -= length + 1;
+        }
+        std::memmove(buffer.data(), begin, left);
+        carried = left;
+    }
+    if (carried > 0) {
+        fn(std::string_view(buffer.data(), carried));
+    }
+}
+
+inline BufferedWriter::BufferedWriter(int fd, size_t capacity)
+    : mFd(fd),
+    mBuffer(capacity),
+    mUsed(0),
+    mWriteTime(0) { }
+
+inline BufferedWriter::~BufferedWriter() {
+    try {
+        flush();
+    } catch (...) {
+    }
+}
+
+inline BufferedWriter& BufferedWriter::operator<<(std::string_view text) {
+    if (text.size() > mBuffer.size() - mUsed) {
+        flush();
+        if (text.size() >= mBuffer.size()) {
+            writeAll(text.data(), text.size());
+            return *this;
+        }
+    }
+    std::memcpy(mBuffer.data() + mUsed, text.data(), text.size());
+    mUsed += text.size();
+    return *this;
+}
+
+inline BufferedWriter& BufferedWriter::operator<<(char c) {
+    if (mUsed == mBuffer.size()) {
+        flush();
+    }
+    mBuffer[mUsed++] = c;
+    return *this;
+}
+
+inline void BufferedWriter::flush() {
+    size_t used = std::exchange(mUsed, 0);
+    writeAll(mBuffer.data(), used);
+}
+
+inline std::chrono::nanoseconds BufferedWriter::writeTime() const {
+    return mWriteTime;
+}
+
+inline void BufferedWriter::writeAll(const char *data, size_t size) {
+    auto start = std::chrono::steady_clock::now();
+    while (size > 0) {
+        ssize_t count = ::write(mFd, data, size);
+        if (count < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            throw std::system_error(errno, std::generic_category(), "write");
+        }
+        data += count;
+        size -= static_cast<size_t>(count);
+    }
+    mWriteTime += std::chrono::steady_clock::now() - start;
+}
+
+inline StringWriter::StringWriter(std::string &text)
+    : mText(text) { }
+
+inline StringWriter& StringWriter::operator<<(std::string_view text) {
+    mText.append(text);
+    return *this;
+}
+
+inline StringWriter& StringWriter::operator<<(char c) {
+    mText.push_back(c);
+    return *this;
+}
+
+} // namespace Patricia
@@ -0,0 +1,120 @@
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <limits>
+#include <type_traits>
+#include <utility>
+
+namespace Patricia {
+
+// Augmentation policies keep a summary of its subtree in every node of a
+// RadixTrie, current through every insert and erase. A policy G provides:
+//   data                the per-node summary, default constructed
+//   enabled             false only for RadixNoAugment
+//   refresh(node)       recomputes the data of node from its own value and
+//                       the data of its children
+//   added(node, value)  value was just stored somewhere below node
+// Nodes expose their data through augment().
+struct RadixNoAugment {
+    struct data { };
+    static constexpr bool enabled = false;
+
+    template <typename N>
+    static void refresh(N *) { }
+    template <typename N, typename T>
+    static void added(N *, const T &) { }
+};
+
+// Score of a stored pair: its mapped value.
+struct RadixMappedScore {
+    template <typename T>
+    auto operator()(const T &value) const {
+        return value.second;
+    }
+};
+
+// Best score of each subtree, the bound topK() searches by. F maps a stored
+// pair to its score of type S; subtrees without keys hold the lowest S.
+// Scores changed in place must be announced with RadixTrie::refresh().
+template <typename S, typename F = RadixMappedScore>
+struct RadixScoreAugment {
+    using score_type = S;
+    struct data {
+        S best = std::numeric_limits<S>::lowest();
+    };
+    static constexpr bool enabled = true;
+
+    template <typename T>
+    static S score(const T &value) {
+        return static_cast<S>(F()(value));
+    }
+    template <typename N>
+    static void refresh(N *node) {
+        S best = node->isTerminal() ? score(node->value()) : std::numeric_limits<S>::lowest();
+        for (auto child : node->children()) {
+            best = std::max(best, child->augment().best);
+        }
+        node->augment().best = best;
+    }
+    template <typename N, typename T>
+    static void added(N *node, const T &value) {
+        node->augment().best = std::max(node->augment().best, score(value));
+    }
+};
+
+// Number of keys in each subtree: count_prefix() in one descent, rank(),
+// select() and RadixIter::advance() in one pass along a path that sums the
+// counts of the siblings it passes.
+struct RadixCountAugment {
+    struct data {
+        size_t count = 0;
+    };
+    static constexpr bool enabled = true;
+
+    template <typename N>
+    static void refresh(N *node) {
+        size_t count = node->isTerminal();
+        for (auto child : node->children()) {
+            count += child->augment().count;
+        }
+        node->augment().count = count;
+    }
+    template <typename N, typename T>
+    static void added(N *node, const T &) {
+        ++node->augment().count;
+    }
+};
+
+// Several policies at once, e.g. RadixAugments<RadixScoreAugment<int>,
+// RadixCountAugment>. Their data and static members are inherited, so the
+// parts must not share member names.
+template <typename... Gs>
+struct RadixAugments : Gs... {
+    struct data : Gs::data... { };
+    static constexpr bool enabled = (Gs::enabled || ...);
+
+    template <typename N>
+    static void refresh(N *node) {
+        (Gs::refresh(node), ...);
+    }
+    template <typename N, typename T>
+    static void added(N *node, const T &value) {
+        (Gs::added(node, value), ...);
+    }
+};
+
+// Whether the nodes of policy G know the key count of their subtree.
+template <typename G, typename = void>
+struct RadixCounted : std::false_type { };
+
+template <typename G>
+struct RadixCounted<G, std::void_t<decltype(std::declval<typename G::data &>().count)>> : std::true_type { };
+
+// Whether the nodes of policy G know the best score of their subtree.
+template <typename G, typename = void>
+struct RadixScored : std::false_type { };
+
+template <typename G>
+struct RadixScored<G, std::void_t<typename G::score_type, decltype(std::declval<typename G::data &>().best)>> : std::true_type { };
+
+} // namespace Patricia
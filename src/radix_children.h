@@ -0,0 +1,391 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include "radix_simd.h"
+
+namespace Patricia {
+
+// Read prefetch hint; a no-op where the builtin is missing.
+inline void radixPrefetch(const void *address) {
+#if defined(__GNUC__)
+    __builtin_prefetch(address);
+#else
+    (void)address;
+#endif
+}
+
+// Child index of a radix node keyed by the first byte of each edge. Up to
+// SmallCapacity children live in a sorted byte array next to their pointers,
+// larger fan-outs switch to a 256 slot direct table. The byte array is
+// padded to SmallCapacity so a probe is one 16 byte compare, which the 16
+// byte arena granularity makes free. Tables grow and shrink through the trie
+// allocator policy; iteration is always in byte order.
+template <typename N>
+class RadixChildren {
+public:
+    static constexpr size_t MinCapacity = 2;
+    static constexpr size_t SmallCapacity = 16;
+    static constexpr size_t DirectCapacity = 256;
+    static constexpr size_t DemoteSize = SmallCapacity / 2;
+
+    class const_iterator {
+    public:
+        const_iterator(const RadixChildren *owner, size_t pos);
+        N* operator*() const;
+        unsigned char byte() const;
+        const_iterator& operator++();
+        bool operator!=(const const_iterator &other) const;
+        bool operator==(const const_iterator &other) const;
+    private:
+        void skip();
+        const RadixChildren *mOwner;
+        size_t mPos;
+    };
+
+    RadixChildren();
+    ~RadixChildren() = default;
+
+    N* find(unsigned char byte) const;
+    N* first() const;
+    N* last() const;
+    N* next(unsigned char byte) const;
+    N* prev(unsigned char byte) const;
+    size_t size() const;
+    bool empty() const;
+    bool direct() const;
+    size_t capacity() const;
+    size_t bytesAllocated() const;
+    void prefetch(unsigned char byte) const;
+    const_iterator begin() const;
+    const_iterator end() const;
+
+    template <class A>
+    void insert(unsigned char byte, N *child, A &alloc);
+    template <class A>
+    void erase(unsigned char byte, A &alloc);
+    template <class A>
+    void release(A &alloc);
+private:
+    RadixChildren(const RadixChildren &) = delete;
+    RadixChildren& operator=(const RadixChildren &) = delete;
+    unsigned char* bytes() const;
+    size_t lowerBound(unsigned char byte) const;
+    template <class A>
+    void resize(size_t capacity, A &alloc);
+    template <class A>
+    void shrink(size_t capacity, A &alloc);
+    static size_t blockSize(size_t capacity);
+private:
+    N **mSlots;
+    uint16_t mSize;
+    uint16_t mCapacity;
+};
+
+template <typename N>
+RadixChildren<N>::RadixChildren()
+    : mSlots(nullptr),
+    mSize(0),
+    mCapacity(0) { }
+
+template <typename N>
+size_t RadixChildren<N>::blockSize(size_t capacity) {
+    if (capacity == DirectCapacity) {
+        return DirectCapacity * sizeof(N *);
+    }
+    return capacity * sizeof(N *) + SmallCapacity;
+}
+
+template <typename N>
+unsigned char* RadixChildren<N>::bytes() const {
+    return reinterpret_cast<unsigned char *>(mSlots + mCapacity);
+}
+
+// Pulls in the part of the table a later find(byte) reads: the slot itself
+// in a direct table, the byte array and the front of the slots otherwise.
+template <typename N>
+void RadixChildren<N>::prefetch(unsigned char byte) const {
+    if (mSlots == nullptr) {
+        return;
+    }
+    if (direct()) {
+        radixPrefetch(mSlots + byte);
+        return;
+    }
+    radixPrefetch(mSlots);
+    radixPrefetch(bytes());
+}
+
+template <typename N>
+size_t RadixChildren<N>::lowerBound(unsigned char byte) const {
+    if (mSize == 0) {
+        return 0;
+    }
+    return simd::lowerBound16(bytes(), mSize, byte);
+}
+
+template <typename N>
+N* RadixChildren<N>::find(unsigned char byte) const {
+    if (direct()) {
+        return mSlots[byte];
+    }
+    if (mSize == 0) {
+        return nullptr;
+    }
+    size_t pos = simd::findKey16(bytes(), mSize, byte);
+    return pos < mSize ? mSlots[pos] : nullptr;
+}
+
+template <typename N>
+N* RadixChildren<N>::first() const {
+    if (mSize == 0) {
+        return nullptr;
+    }
+    if (!direct()) {
+        return mSlots[0];
+    }
+    for (size_t i = 0; i < DirectCapacity; ++i) {
+        if (mSlots[i] != nullptr) {
+            return mSlots[i];
+        }
+    }
+    return nullptr;
+}
+
+template <typename N>
+N* RadixChildren<N>::last() const {
+    if (mSize == 0) {
+        return nullptr;
+    }
+    if (!direct()) {
+        return mSlots[mSize - 1];
+    }
+    for (size_t i = DirectCapacity; i-- > 0;) {
+        if (mSlots[i] != nullptr) {
+            return mSlots[i];
+        }
+    }
+    return nullptr;
+}
+
+template <typename N>
+N* RadixChildren<N>::next(unsigned char byte) const {
+    if (direct()) {
+        for (size_t i = byte + 1; i < DirectCapacity; ++i) {
+            if (mSlots[i] != nullptr) {
+                return mSlots[i];
+            }
+        }
+        return nullptr;
+    }
+    size_t pos = lowerBound(byte);
+    if (pos < mSize && bytes()[pos] == byte) {
+        ++pos;
+    }
+    return pos < mSize ? mSlots[pos] : nullptr;
+}
+
+template <typename N>
+N* RadixChildren<N>::prev(unsigned char byte) const {
+    if (direct()) {
+        for (size_t i = byte; i-- > 0;) {
+            if (mSlots[i] != nullptr) {
+                return mSlots[i];
+            }
+        }
+        return nullptr;
+    }
+    size_t pos = lowerBound(byte);
+    return pos == 0 ? nullptr : mSlots[pos - 1];
+}
+
+template <typename N>
+size_t RadixChildren<N>::size() const {
+    return mSize;
+}
+
+template <typename N>
+bool RadixChildren<N>::empty() const {
+    return mSize == 0;
+}
+
+template <typename N>
+bool RadixChildren<N>::direct() const {
+    return mCapacity == DirectCapacity;
+}
+
+template <typename N>
+size_t RadixChildren<N>::capacity() const {
+    return mCapacity;
+}
+
+template <typename N>
+size_t RadixChildren<N>::bytesAllocated() const {
+    return mCapacity == 0 ? 0 : blockSize(mCapacity);
+}
+
+template <typename N>
+template <class A>
+void RadixChildren<N>::resize(size_t capacity, A &alloc) {
+    N **slots = nullptr;
+    if (capacity != 0) {
+        slots = static_cast<N **>(alloc.allocate(blockSize(capacity)));
+        std::memset(static_cast<void *>(slots), 0, blockSize(capacity));
+    }
+    size_t count = 0;
+    auto copy = [&](unsigned char byte, N *child) {
+        if (capacity == DirectCapacity) {
+            slots[byte] = child;
+        } else {
+            slots[count] = child;
+            reinterpret_cast<unsigned char *>(slots + capacity)[count] = byte;
+        }
+        ++count;
+    };
+    for (auto it = begin(); it != end(); ++it) {
+        copy(it.byte(), *it);
+    }
+    if (mSlots != nullptr) {
+        alloc.deallocate(mSlots, blockSize(mCapacity));
+    }
+    mSlots = slots;
+    mCapacity = static_cast<uint16_t>(capacity);
+}
+
+// Moves to a smaller table after an erase. That only saves memory, so a
+// failed allocation keeps the larger table instead of failing the erase.
+template <typename N>
+template <class A>
+void RadixChildren<N>::shrink(size_t capacity, A &alloc) {
+    try {
+        resize(capacity, alloc);
+    } catch (...) {
+    }
+}
+
+template <typename N>
+template <class A>
+void RadixChildren<N>::insert(unsigned char byte, N *child, A &alloc) {
+    if (direct()) {
+        if (mSlots[byte] == nullptr) {
+            ++mSize;
+        }
+        mSlots[byte] = child;
+        return;
+    }
+    size_t pos = lowerBound(byte);
+    if (pos < mSize && bytes()[pos] == byte) {
+        mSlots[pos] = child;
+        return;
+    }
+    if (mSize == mCapacity) {
+        if (mCapacity == SmallCapacity) {
+            resize(DirectCapacity, alloc);
+            mSlots[byte] = child;
+            ++mSize;
+            return;
+        }
+        resize(mCapacity == 0 ? MinCapacity : mCapacity * 2, alloc);
+    }
+    auto keys = bytes();
+    std::memmove(mSlots + pos + 1, mSlots + pos, (mSize - pos) * sizeof(N *));
+    std::memmove(keys + pos + 1, keys + pos, mSize - pos);
+    mSlots[pos] = child;
+    keys[pos] = byte;
+    ++mSize;
+}
+
+template <typename N>
+template <class A>
+void RadixChildren<N>::erase(unsigned char byte, A &alloc) {
+    if (direct()) {
+        if (mSlots[byte] == nullptr) {
+            return;
+        }
+        mSlots[byte] = nullptr;
+        --mSize;
+        if (mSize <= DemoteSize) {
+            shrink(SmallCapacity, alloc);
+        }
+        return;
+    }
+    size_t pos = lowerBound(byte);
+    if (pos == mSize || bytes()[pos] != byte) {
+        return;
+    }
+    auto keys = bytes();
+    std::memmove(mSlots + pos, mSlots + pos + 1, (mSize - pos - 1) * sizeof(N *));
+    std::memmove(keys + pos, keys + pos + 1, mSize - pos - 1);
+    --mSize;
+    if (mSize == 0) {
+        resize(0, alloc);
+    } else if (mCapacity > MinCapacity && mSize <= mCapacity / 4) {
+        shrink(mCapacity / 2, alloc);
+    }
+}
+
+template <typename N>
+template <class A>
+void RadixChildren<N>::release(A &alloc) {
+    if (mSlots != nullptr) {
+        alloc.deallocate(mSlots, blockSize(mCapacity));
+    }
+    mSlots = nullptr;
+    mSize = 0;
+    mCapacity = 0;
+}
+
+template <typename N>
+auto RadixChildren<N>::begin() const -> const_iterator {
+    return const_iterator(this, 0);
+}
+
+template <typename N>
+auto RadixChildren<N>::end() const -> const_iterator {
+    return const_iterator(this, direct() ? DirectCapacity : mSize);
+}
+
+template <typename N>
+RadixChildren<N>::const_iterator::const_iterator(const RadixChildren *owner, size_t pos)
+    : mOwner(owner),
+    mPos(pos) {
+    skip();
+}
+
+template <typename N>
+void RadixChildren<N>::const_iterator::skip() {
+    if (mOwner->direct()) {
+        while (mPos < DirectCapacity && mOwner->mSlots[mPos] == nullptr) {
+            ++mPos;
+        }
+    }
+}
+
+template <typename N>
+N* RadixChildren<N>::const_iterator::operator*() const {
+    return mOwner->mSlots[mPos];
+}
+
+template <typename N>
+unsigned char RadixChildren<N>::const_iterator::byte() const {
+    return mOwner->direct() ? static_cast<unsigned char>(mPos) : mOwner->bytes()[mPos];
+}
+
+template <typename N>
+auto RadixChildren<N>::const_iterator::operator++() -> const_iterator& {
+    ++mPos;
+    skip();
+    return *this;
+}
+
+template <typename N>
+bool RadixChildren<N>::const_iterator::operator!=(const const_iterator &other) const {
+    return mPos != other.mPos || mOwner != other.mOwner;
+}
+
+template <typename N>
+bool RadixChildren<N>::const_iterator::operator==(const const_iterator &other) const {
+    return !(*this != other);
+}
+
+} // namespace Patricia
@@ -0,0 +1,728 @@
+#pragma once
+
+#include "radix_children.h"
+#include "radix_helpers.h"
+#include "radix_iter.h"
+#include "radix_pool.h"
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace Patricia {
+
+// Epoch based reclamation for one writer and many readers. A reader pins
+// the current epoch in a slot for as long as it may hold node pointers. The
+// writer tags what it unlinks with the epoch at the time, then advances the
+// epoch; a block tagged r is freed once every pinned epoch is above r, i.e.
+// once every reader that could have reached it has left. Slots come in
+// chunks of ChunkReaders; when all are pinned the reader links another
+// chunk, so the number of readers is not capped. Chunks are kept until the
+// domain goes away.
+class RadixEpoch {
+    struct Slot;
+public:
+    static constexpr size_t ChunkReaders = 128;
+
+    class Guard {
+    public:
+        explicit Guard(const RadixEpoch &domain);
+        Guard(Guard &&other) noexcept;
+        ~Guard();
+    private:
+        Guard(const Guard &) = delete;
+        Guard& operator=(const Guard &) = delete;
+        Guard& operator=(Guard &&) = delete;
+        const RadixEpoch *mDomain;
+        Slot *mSlot;
+    };
+
+    RadixEpoch();
+    ~RadixEpoch();
+    uint64_t current() const;
+    void advance();
+    uint64_t oldestActive() const;
+private:
+    RadixEpoch(const RadixEpoch &) = delete;
+    RadixEpoch& operator=(const RadixEpoch &) = delete;
+    Slot* pin() const;
+    void unpin(Slot *slot) const;
+private:
+    struct alignas(64) Slot {
+        std::atomic<uint64_t> epoch{0};
+    };
+    struct Chunk {
+        Slot slots[ChunkReaders];
+        std::atomic<Chunk *> next{nullptr};
+    };
+    std::atomic<uint64_t> mEpoch;
+    mutable Chunk mSlots;
+};
+
+// Node of a ConcurrentRadixTrie. Nodes are immutable once reachable from a
+// published root: the writer copies the path it changes and shares every
+// untouched subtree and value between versions, so no parent pointers.
+template <typename K, typename V>
+class ConcurrentRadixNode {
+public:
+    using value_type = std::pair<const K, V>;
+    using children_type = RadixChildren<ConcurrentRadixNode<K, V>>;
+
+    ConcurrentRadixNode(const K &key, size_t depth, value_type *value);
+    const K& key() const;
+    size_t depth() const;
+    value_type& value() const;
+    value_type* valuePtr() const;
+    bool isTerminal() const;
+    size_t size() const;
+    bool empty() const;
+    const children_type& children() const;
+
+    template <typename K_, typename V_, typename A_>
+    friend class ConcurrentRadixTrie;
+private:
+    ConcurrentRadixNode(const ConcurrentRadixNode &) = delete;
+    ConcurrentRadixNode& operator=(const ConcurrentRadixNode &) = delete;
+private:
+    children_type mChildren;
+    K mKey;
+    value_type *mValue;
+    size_t mDepth;
+};
+
+// Forward iterator over one version of a ConcurrentRadixTrie. Without
+// parent pointers the path from the range root is kept on a stack.
+template <typename K, typename V>
+class ConcurrentRadixIter {
+public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = typename ConcurrentRadixNode<K, V>::value_type;
+    using difference_type = std::ptrdiff_t;
+    using pointer = const value_type*;
+    using reference = const value_type&;
+
+    ConcurrentRadixIter();
+    explicit ConcurrentRadixIter(std::vector<const ConcurrentRadixNode<K, V> *> path);
+
+    reference operator*() const;
+    pointer operator->() const;
+    ConcurrentRadixIter& operator++(); // prefix
+    ConcurrentRadixIter operator++(int); // postfix
+    bool operator!=(const ConcurrentRadixIter &other) const;
+    bool operator==(const ConcurrentRadixIter &other) const;
+    const ConcurrentRadixNode<K, V>* node() const;
+private:
+    void descend();
+    std::vector<const ConcurrentRadixNode<K, V> *> mPath;
+};
+
+// Radix trie with lock-free readers and a single writer. Readers take a
+// Snapshot, which pins an epoch and one published root, and see exactly
+// that version however long they iterate. insert() and erase() copy the
+// nodes on the path they change, including the nodes created or merged by
+// an edge split or a recompression, then publish the new root with one
+// atomic store and retire the old path through the epoch. Writers are
+// serialized by a mutex, so a write costs O(depth * fan-out) copying and
+// readers never wait.
+template <typename K, typename V, typename A = RadixArena>
+class ConcurrentRadixTrie {
+public:
+    using key_type = K;
+    using key_view = typename RadixView<K>::type;
+    using mapped_type = V;
+    using node_type = ConcurrentRadixNode<K, V>;
+    using value_type = typename node_type::value_type;
+    using iterator = ConcurrentRadixIter<K, V>;
+    using size_type = std::size_t;
+    using allocator_type = A;
+
+    class Snapshot {
+    public:
+        Snapshot(const RadixEpoch &epoch, const std::atomic<node_type *> &root);
+        Snapshot(Snapshot &&other) noexcept = default;
+        iterator begin() const;
+        iterator end() const;
+        iterator find(const key_view &key) const;
+        RadixRange<iterator> prefixMatch(const key_view &prefix) const;
+    private:
+        RadixEpoch::Guard mGuard;
+        const node_type *mRoot;
+    };
+
+    ConcurrentRadixTrie();
+    ~ConcurrentRadixTrie();
+    size_type size() const;
+    bool empty() const;
+
+    Snapshot snapshot() const;
+    std::optional<V> find(const key_view &key) const;
+    bool contains(const key_view &key) const;
+
+    bool insert(const key_view &key, const V &value);
+    bool erase(const key_view &key);
+    size_type retired() const;
+private:
+    ConcurrentRadixTrie(const ConcurrentRadixTrie &) = delete;
+    ConcurrentRadixTrie& operator=(const ConcurrentRadixTrie &) = delete;
+    node_type* createNode(const K &key, size_t depth, value_type *value);
+    node_type* copy(const node_type *node);
+    K joinEdges(const node_type *upper, const node_type *lower) const;
+    void publish(const std::vector<node_type *> &path, size_t level, node_type *replacement);
+    void reclaim(bool everything);
+    void destroyTree(node_type *node);
+private:
+    std::atomic<node_type *> mRoot;
+    std::atomic<size_type> mSize;
+    RadixEpoch mEpoch;
+    std::mutex mWriter;
+    A mAlloc;
+    std::vector<node_type *> mUnlinked;
+    std::vector<value_type *> mUnlinkedValues;
+    std::vector<std::pair<uint64_t, node_type *>> mRetired;
+    std::vector<std::pair<uint64_t, value_type *>> mRetiredValues;
+};
+
+inline RadixEpoch::RadixEpoch()
+    : mEpoch(1) { }
+
+inline RadixEpoch::~RadixEpoch() {
+    for (auto chunk = mSlots.next.load(); chunk != nullptr;) {
+        auto next = chunk->next.load();
+        delete chunk;
+        chunk = next;
+    }
+}
+
+inline uint64_t RadixEpoch::current() const {
+    return mEpoch.load();
+}
+
+inline void RadixEpoch::advance() {
+    mEpoch.fetch_add(1);
+}
+
+// Smallest epoch pinned by a reader, current() when no reader is active.
+inline uint64_t RadixEpoch::oldestActive() const {
+    uint64_t oldest = mEpoch.load();
+    for (const Chunk *chunk = &mSlots; chunk != nullptr; chunk = chunk->next.load()) {
+        for (const auto &slot : chunk->slots) {
+            uint64_t epoch = slot.epoch.load();
+            if (epoch != 0 && epoch < oldest) {
+                oldest = epoch;
+            }
+        }
+    }
+    return oldest;
+}
+
+// Claims a free slot with the current epoch. The claim is sequentially
+// consistent, so the root a reader loads afterwards is at least as new as
+// any unlink the writer made before it last scanned the slots. A chunk that
+// is full sends the reader on to the next one, linked here if missing; the
+// writer scans the chain with the same ordering, so it sees the new chunk
+// before any slot claimed in it.
+inline auto RadixEpoch::pin() const -> Slot* {
+    thread_local size_t hint = std::hash<std::thread::id>()(std::this_thread::get_id());
+    uint64_t epoch = mEpoch.load();
+    for (Chunk *chunk = &mSlots;;) {
+        for (size_t i = 0; i < ChunkReaders; ++i) {
+            size_t slot = (hint + i) % ChunkReaders;
+            uint64_t expected = 0;
+            if (chunk->slots[slot].epoch.compare_exchange_strong(expected, epoch)) {
+                hint = slot;
+                return &chunk->slots[slot];
+            }
+        }
+        auto next = chunk->next.load();
+        if (next == nullptr) {
+            auto grown = new Chunk();
+            if (chunk->next.compare_exchange_strong(next, grown)) {
+                next = grown;
+            } else {
+                delete grown;
+            }
+        }
+        chunk = next;
+    }
+}
+
+inline void RadixEpoch::unpin(Slot *slot) const {
+    slot->epoch.store(0, std::memory_order_release);
+}
+
+inline RadixEpoch::Guard::Guard(const RadixEpoch &domain)
+    : mDomain(&domain),
+    mSlot(domain.pin()) { }
+
+inline RadixEpoch::Guard::Guard(Guard &&other) noexcept
+    : mDomain(std::exchange(other.mDomain, nullptr)),
+    mSlot(other.mSlot) { }
+
+inline RadixEpoch::Guard::~Guard() {
+    if (mDomain != nullptr) {
+        mDomain->unpin(mSlot);
+    }
+}
+
+template <typename K, typename V>
+ConcurrentRadixNode<K, V>::ConcurrentRadixNode(const K &key, size_t depth, value_type *value)
+    : mChildren(),
+    mKey(key),
+    mValue(value),
+    mDepth(depth) { }
+
+template <typename K, typename V>
+const K& ConcurrentRadixNode<K, V>::key() const {
+    return mKey;
+}
+
+template <typename K, typename V>
+size_t ConcurrentRadixNode<K, V>::depth() const {
+    return mDepth;
+}
+
+template <typename K, typename V>
+auto ConcurrentRadixNode<K, V>::value() const -> value_type& {
+    return *mValue;
+}
+
+template <typename K, typename V>
+auto ConcurrentRadixNode<K, V>::valuePtr() const -> value_type* {
+    return mValue;
+}
+
+template <typename K, typename V>
+bool ConcurrentRadixNode<K, V>::isTerminal() const {
+    return mValue != nullptr;
+}
+
+template <typename K, typename V>
+size_t ConcurrentRadixNode<K, V>::size() const {
+    return mChildren.size();
+}
+
+template <typename K, typename V>
+bool ConcurrentRadixNode<K, V>::empty() const {
+    return mChildren.empty();
+}
+
+template <typename K, typename V>
+auto ConcurrentRadixNode<K, V>::children() const -> const children_type& {
+    return mChildren;
+}
+
+template <typename K, typename V>
+ConcurrentRadixIter<K, V>::ConcurrentRadixIter()
+    : mPath() { }
+
+// path runs from the range root to a terminal node, or is empty for end().
+template <typename K, typename V>
+ConcurrentRadixIter<K, V>::ConcurrentRadixIter(std::vector<const ConcurrentRadixNode<K, V> *> path)
+    : mPath(std::move(path)) { }
+
+template <typename K, typename V>
+auto ConcurrentRadixIter<K, V>::operator*() const -> reference {
+    return mPath.back()->value();
+}
+
+template <typename K, typename V>
+auto ConcurrentRadixIter<K, V>::operator->() const -> pointer {
+    return mPath.back()->valuePtr();
+}
+
+// Follows first children down to the first terminal below mPath.back().
+template <typename K, typename V>
+void ConcurrentRadixIter<K, V>::descend() {
+    while (!mPath.back()->isTerminal()) {
+        auto child = mPath.back()->children().first();
+        if (child == nullptr) {
+            mPath.clear();
+            return;
+        }
+        mPath.push_back(child);
+    }
+}
+
+template <typename K, typename V>
+ConcurrentRadixIter<K, V>& ConcurrentRadixIter<K, V>::operator++() { // prefix
+    if (mPath.empty()) {
+        return *this;
+    }
+    if (auto child = mPath.back()->children().first(); child != nullptr) {
+        mPath.push_back(child);
+        descend();
+        return *this;
+    }
+    while (mPath.size() > 1) {
+        auto node = mPath.back();
+        mPath.pop_back();
+        if (auto next = mPath.back()->children().next(radixByte(node->key(), 0)); next != nullptr) {
+            mPath.push_back(next);
+            descend();
+            return *this;
+        }
+    }
+    mPath.clear();
+    return *this;
+}
+
+template <typename K, typename V>
+ConcurrentRadixIter<K, V> ConcurrentRadixIter<K, V>::operator++(int) { // postfix
+    ConcurrentRadixIter copy(*this);
+    ++(*this);
+    return copy;
+}
+
+template <typename K, typename V>
+bool ConcurrentRadixIter<K, V>::operator!=(const ConcurrentRadixIter &other) const {
+    return node() != other.node();
+}
+
+template <typename K, typename V>
+bool ConcurrentRadixIter<K, V>::operator==(const ConcurrentRadixIter &other) const {
+    return node() == other.node();
+}
+
+template <typename K, typename V>
+const ConcurrentRadixNode<K, V>* ConcurrentRadixIter<K, V>::node() const {
+    return mPath.empty() ? nullptr : mPath.back();
+}
+
+template <typename K, typename V, typename A>
+ConcurrentRadixTrie<K, V, A>::Snapshot::Snapshot(const RadixEpoch &epoch, const std::atomic<node_type *> &root)
+    : mGuard(epoch),
+    mRoot(root.load()) { }
+
+template <typename K, typename V, typename A>
+auto ConcurrentRadixTrie<K, V, A>::Snapshot::begin() const -> iterator {
+    std::vector<const node_type *> path{mRoot};
+    if (mRoot->isTerminal()) {
+        return iterator(std::move(path));
+    }
+    return ++iterator(std::move(path));
+}
+
+template <typename K, typename V, typename A>
+auto ConcurrentRadixTrie<K, V, A>::Snapshot::end() const -> iterator {
+    return iterator();
+}
+
+template <typename K, typename V, typename A>
+auto ConcurrentRadixTrie<K, V, A>::Snapshot::find(const key_view &key) const -> iterator {
+    std::vector<const node_type *> path{mRoot};
+    size_t depth = 0;
+    while (depth < radixSize(key)) {
+        auto child = path.back()->children().find(radixByte(key, depth));
+        if (child == nullptr) {
+            return end();
+        }
+        auto edge = radixSlice(child->key(), 0, radixSize(child->key()));
+        auto rest = radixSlice(key, depth, radixSize(key) - depth);
+        if (radixSize(rest) < radixSize(edge) || radixCommonPrefix(edge, rest) != radixSize(edge)) {
+            return end();
+        }
+        depth += radixSize(edge);
+        path.push_back(child);
+    }
+    return path.back()->isTerminal() ? iterator(std::move(path)) : end();
+}
+
+// Keys starting with prefix in this version. The range iterators walk only
+// the subtree under the node reached by prefix.
+template <typename K, typename V, typename A>
+auto ConcurrentRadixTrie<K, V, A>::Snapshot::prefixMatch(const key_view &prefix) const -> RadixRange<iterator> {
+    const node_type *node = mRoot;
+    size_t depth = 0;
+    while (depth < radixSize(prefix)) {
+        node = node->children().find(radixByte(prefix, depth));
+        if (node == nullptr) {
+            return RadixRange<iterator>(end(), end());
+        }
+        auto edge = radixSlice(node->key(), 0, radixSize(node->key()));
+        auto rest = radixSlice(prefix, depth, radixSize(prefix) - depth);
+        size_t common = radixCommonPrefix(edge, rest);
+        if (common < radixSize(edge) && common < radixSize(rest)) {
+            return RadixRange<iterator>(end(), end());
+        }
+        depth += radixSize(edge);
+    }
+    iterator first(std::vector<const node_type *>{node});
+    if (!node->isTerminal()) {
+        ++first;
+    }
+    return RadixRange<iterator>(first, end());
+}
+
+template <typename K, typename V, typename A>
+ConcurrentRadixTrie<K, V, A>::ConcurrentRadixTrie()
+    : mRoot(nullptr),
+    mSize(0),
+    mEpoch(),
+    mWriter(),
+    mAlloc() {
+    mRoot.store(createNode(K(), 0, nullptr));
+}
+
+// Readers must be gone: every version and everything still retired is
+// freed here.
+template <typename K, typename V, typename A>
+ConcurrentRadixTrie<K, V, A>::~ConcurrentRadixTrie() {
+    reclaim(true);
+    destroyTree(mRoot.load());
+    mAlloc.release();
+}
+
+template <typename K, typename V, typename A>
+auto ConcurrentRadixTrie<K, V, A>::size() const -> size_type {
+    return mSize.load(std::memory_order_relaxed);
+}
+
+template <typename K, typename V, typename A>
+bool ConcurrentRadixTrie<K, V, A>::empty() const {
+    return size() == 0;
+}
+
+template <typename K, typename V, typename A>
+auto ConcurrentRadixTrie<K, V, A>::snapshot() const -> Snapshot {
+    return Snapshot(mEpoch, mRoot);
+}
+
+template <typename K, typename V, typename A>
+std::optional<V> ConcurrentRadixTrie<K, V, A>::find(const key_view &key) const {
+    auto current = snapshot();
+    auto it = current.find(key);
+    if (it == current.end()) {
+        return std::nullopt;
+    }
+    return it->second;
+}
+
+template <typename K, typename V, typename A>
+bool ConcurrentRadixTrie<K, V, A>::contains(const key_view &key) const {
+    auto current = snapshot();
+    return current.find(key) != current.end();
+}
+
+// Number of unlinked nodes and values still waiting for readers to leave.
+template <typename K, typename V, typename A>
+auto ConcurrentRadixTrie<K, V, A>::retired() const -> size_type {
+    return mRetired.size() + mRetiredValues.size();
+}
+
+template <typename K, typename V, typename A>
+auto ConcurrentRadixTrie<K, V, A>::createNode(const K &key, size_t depth, value_type *value) -> node_type* {
+    return mAlloc.template create<node_type>(key, depth, value);
+}
+
+// Private copy of node sharing its children and value.
+template <typename K, typename V, typename A>
+auto ConcurrentRadixTrie<K, V, A>::copy(const node_type *node) -> node_type* {
+    auto result = createNode(node->mKey, node->mDepth, node->mValue);
+    for (auto it = node->mChildren.begin(); it != node->mChildren.end(); ++it) {
+        result->mChildren.insert(it.byte(), *it, mAlloc);
+    }
+    return result;
+}
+
+// Edge of upper followed by the edge of its only child lower, cut from the
+// key of a terminal below them like compress() does.
+template <typename K, typename V, typename A>
+K ConcurrentRadixTrie<K, V, A>::joinEdges(const node_type *upper, const node_type *lower) const {
+    const node_type *terminal = lower;
+    while (!terminal->isTerminal()) {
+        terminal = terminal->mChildren.first();
+    }
+    return radixSubstr(terminal->mValue->first, upper->mDepth,
+            radixSize(upper->mKey) + radixSize(lower->mKey));
+}
+
+// Replaces path[level] by replacement: every ancestor on path is copied with
+// the new child, the new root is published, and the old path nodes and
+// everything else unlinked by this write are retired.
+template <typename K, typename V, typename A>
+void ConcurrentRadixTrie<K, V, A>::publish(const std::vector<node_type *> &path, size_t level, node_type *replacement) {
+    auto current = replacement;
+    mUnlinked.push_back(path[level]);
+    for (size_t i = level; i-- > 0;) {
+        auto parent = copy(path[i]);
+        parent->mChildren.insert(radixByte(current->mKey, 0), current, mAlloc);
+        mUnlinked.push_back(path[i]);
+        current = parent;
+    }
+    mRoot.store(current);
+
+    uint64_t epoch = mEpoch.current();
+    for (auto node : mUnlinked) {
+        mRetired.emplace_back(epoch, node);
+    }
+    for (auto value : mUnlinkedValues) {
+        mRetiredValues.emplace_back(epoch, value);
+    }
+    mUnlinked.clear();
+    mUnlinkedValues.clear();
+    mEpoch.advance();
+    reclaim(false);
+}
+
+template <typename K, typename V, typename A>
+void ConcurrentRadixTrie<K, V, A>::reclaim(bool everything) {
+    uint64_t oldest = everything ? UINT64_MAX : mEpoch.oldestActive();
+    auto keep = std::remove_if(mRetired.begin(), mRetired.end(), [this, oldest](const auto &item) {
+        if (item.first >= oldest) {
+            return false;
+        }
+        item.second->mChildren.release(mAlloc);
+        mAlloc.destroy(item.second);
+        return true;
+    });
+    mRetired.erase(keep, mRetired.end());
+    auto keepValues = std::remove_if(mRetiredValues.begin(), mRetiredValues.end(), [this, oldest](const auto &item) {
+        if (item.first >= oldest) {
+            return false;
+        }
+        mAlloc.destroy(item.second);
+        return true;
+    });
+    mRetiredValues.erase(keepValues, mRetiredValues.end());
+}
+
+template <typename K, typename V, typename A>
+void ConcurrentRadixTrie<K, V, A>::destroyTree(node_type *node) {
+    std::vector<node_type *> stack{node};
+    while (!stack.empty()) {
+        node = stack.back();
+        stack.pop_back();
+        for (auto child : node->mChildren) {
+            stack.push_back(child);
+        }
+        mAlloc.destroy(node->mValue);
+        node->mChildren.release(mAlloc);
+        mAlloc.destroy(node);
+    }
+}
+
+template <typename K, typename V, typename A>
+bool ConcurrentRadixTrie<K, V, A>::insert(const key_view &key, const V &value) {
+    std::lock_guard<std::mutex> lock(mWriter);
+    std::vector<node_type *> path{mRoot.load(std::memory_order_relaxed)};
+    size_t depth = 0;
+    size_t size = radixSize(key);
+    for (;;) {
+        auto node = path.back();
+        if (depth == size) {
+            if (node->isTerminal()) {
+                return false;
+            }
+            auto replacement = copy(node);
+            replacement->mValue = mAlloc.template create<value_type>(K(key), value);
+            publish(path, path.size() - 1, replacement);
+            break;
+        }
+        auto child = node->mChildren.find(radixByte(key, depth));
+        if (child == nullptr) {
+            auto stored = mAlloc.template create<value_type>(K(key), value);
+            auto leaf = createNode(radixSubstr(stored->first, depth, size - depth), depth, stored);
+            auto replacement = copy(node);
+            replacement->mChildren.insert(radixByte(key, depth), leaf, mAlloc);
+            publish(path, path.size() - 1, replacement);
+            break;
+        }
+        auto edge = radixSlice(child->mKey, 0, radixSize(child->mKey));
+        auto rest = radixSlice(key, depth, size - depth);
+        size_t common = radixCommonPrefix(edge, rest);
+        if (common == radixSize(edge)) {
+            depth += common;
+            path.push_back(child);
+            continue;
+        }
+        // Edge split: the middle node takes the common part, the old child
+        // is copied with the remainder of its edge.
+        auto middle = createNode(radixSubstr(child->mKey, 0, common), depth, nullptr);
+        auto lower = copy(child);
+        lower->mKey = radixSubstr(child->mKey, common, radixSize(edge) - common);
+        lower->mDepth = depth + common;
+        middle->mChildren.insert(radixByte(lower->mKey, 0), lower, mAlloc);
+        auto stored = mAlloc.template create<value_type>(K(key), value);
+        if (common == radixSize(rest)) {
+            middle->mValue = stored;
+        } else {
+            auto leaf = createNode(radixSubstr(stored->first, depth + common, size - depth - common),
+                    depth + common, stored);
+            middle->mChildren.insert(radixByte(leaf->mKey, 0), leaf, mAlloc);
+        }
+        path.push_back(child);
+        publish(path, path.size() - 1, middle);
+        break;
+    }
+    mSize.fetch_add(1, std::memory_order_relaxed);
+    return true;
+}
+
+// Removes key and keeps the trie compressed: a node left with one child and
+// no value is merged into that child, in the same published version.
+template <typename K, typename V, typename A>
+bool ConcurrentRadixTrie<K, V, A>::erase(const key_view &key) {
+    std::lock_guard<std::mutex> lock(mWriter);
+    std::vector<node_type *> path{mRoot.load(std::memory_order_relaxed)};
+    size_t depth = 0;
+    size_t size = radixSize(key);
+    while (depth < size) {
+        auto child = path.back()->mChildren.find(radixByte(key, depth));
+        if (child == nullptr) {
+            return false;
+        }
+        auto edge = radixSlice(child->mKey, 0, radixSize(child->mKey));
+        auto rest = radixSlice(key, depth, size - depth);
+        if (radixSize(rest) < radixSize(edge) || radixCommonPrefix(edge, rest) != radixSize(edge)) {
+            return false;
+        }
+        depth += radixSize(edge);
+        path.push_back(child);
+    }
+    auto node = path.back();
+    if (!node->isTerminal()) {
+        return false;
+    }
+    mUnlinkedValues.push_back(node->mValue);
+    size_t level = path.size() - 1;
+    if (level == 0 || node->mChildren.size() >= 2) {
+        auto replacement = copy(node);
+        replacement->mValue = nullptr;
+        publish(path, level, replacement);
+    } else if (node->mChildren.size() == 1) {
+        auto only = node->mChildren.first();
+        auto merged = copy(only);
+        merged->mKey = joinEdges(node, only);
+        merged->mDepth = node->mDepth;
+        mUnlinked.push_back(only);
+        publish(path, level, merged);
+    } else {
+        auto parent = path[level - 1];
+        mUnlinked.push_back(node);
+        if (level > 1 && !parent->isTerminal() && parent->mChildren.size() == 2) {
+            auto other = parent->mChildren.first();
+            if (other == node) {
+                other = parent->mChildren.last();
+            }
+            auto merged = copy(other);
+            merged->mKey = joinEdges(parent, other);
+            merged->mDepth = parent->mDepth;
+            mUnlinked.push_back(other);
+            publish(path, level - 1, merged);
+        } else {
+            auto replacement = copy(parent);
+            replacement->mChildren.erase(radixByte(node->mKey, 0), mAlloc);
+            publish(path, level - 1, replacement);
+        }
+    }
+    mSize.fetch_sub(1, std::memory_order_relaxed);
+    return true;
+}
+
+} // namespace Patricia
@@ -0,0 +1,526 @@
+#pragma once
+#include "radix_iter.h"
+#include "radix_pool.h"
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace Patricia {
+
+template <typename K, typename V, typename C, typename A, typename G> class RadixTrie;
+
+__extension__ typedef unsigned __int128 RadixUint128;
+
+// Bit access for the fixed width key types a crit-bit tree can branch on.
+// Bits are numbered from the most significant one, so that numeric order
+// and bit string order agree.
+template <typename K>
+struct RadixIntegerTraits;
+
+template <>
+struct RadixIntegerTraits<uint32_t> {
+    static constexpr unsigned Bits = 32;
+    static unsigned leadingZeros(uint32_t value) {
+        return static_cast<unsigned>(__builtin_clz(value));
+    }
+};
+
+template <>
+struct RadixIntegerTraits<uint64_t> {
+    static constexpr unsigned Bits = 64;
+    static unsigned leadingZeros(uint64_t value) {
+        return static_cast<unsigned>(__builtin_clzll(value));
+    }
+};
+
+template <>
+struct RadixIntegerTraits<RadixUint128> {
+    static constexpr unsigned Bits = 128;
+    static unsigned leadingZeros(RadixUint128 value) {
+        auto high = static_cast<uint64_t>(value >> 64);
+        if (high != 0) {
+            return static_cast<unsigned>(__builtin_clzll(high));
+        }
+        return 64 + static_cast<unsigned>(__builtin_clzll(static_cast<uint64_t>(value)));
+    }
+};
+
+// Inner node of a crit-bit tree: branches on one bit of the key. Leaves
+// extend it with the stored pair and have no children; both are fixed
+// size and keys live inline, so nothing is allocated besides the nodes.
+template <typename K, typename V>
+struct CritBitNode {
+    CritBitNode *parent = nullptr;
+    CritBitNode *child[2] = {nullptr, nullptr};
+    unsigned bit = 0;
+
+    bool isLeaf() const {
+        return child[0] == nullptr;
+    }
+};
+
+template <typename K, typename V>
+struct CritBitLeaf : CritBitNode<K, V> {
+    template <typename... Args>
+    explicit CritBitLeaf(Args&&... args)
+        : CritBitNode<K, V>(),
+        value(std::forward<Args>(args)...) { }
+
+    std::pair<const K, V> value;
+};
+
+// Bidirectional iterator over the leaves in key order, stepping through
+// parent pointers like RadixIter.
+template <typename K, typename V>
+class CritBitIter {
+public:
+    using iterator_category = std::bidirectional_iterator_tag;
+    using value_type = std::pair<const K, V>;
+    using difference_type = std::ptrdiff_t;
+    using pointer = value_type*;
+    using reference = value_type&;
+    using node_type = CritBitNode<K, V>;
+
+    CritBitIter();
+    CritBitIter(node_type *node, node_type *root);
+
+    reference operator*() const;
+    pointer operator->() const;
+    CritBitIter& operator++(); // prefix
+    CritBitIter operator++(int); // postfix
+    CritBitIter& operator--(); // prefix
+    CritBitIter operator--(int); // postfix
+    bool operator!=(const CritBitIter &other) const;
+    bool operator==(const CritBitIter &other) const;
+    node_type* node() const;
+
+    static node_type* edge(node_type *node, int side);
+    static node_type* step(node_type *node, int side);
+private:
+    node_type *mPointed;
+    node_type *mRoot;
+};
+
+// PATRICIA / crit-bit tree for unsigned integer keys. Each inner node
+// tests the first bit at which the keys of its two subtrees differ, so a
+// lookup is at most one branch per distinct bit and a single key compare
+// at the leaf. Keys are ordered numerically; there is no comparator.
+template <typename K, typename V, typename A = RadixArena>
+class CritBitTrie {
+public:
+    using key_type = K;
+    using key_view = K;
+    using mapped_type = V;
+    using value_type = std::pair<const K, V>;
+    using iterator = CritBitIter<K, V>;
+    using size_type = std::size_t;
+    using allocator_type = A;
+
+    static constexpr unsigned Bits = RadixIntegerTraits<K>::Bits;
+
+    CritBitTrie();
+    ~CritBitTrie();
+    size_type size() const;
+    bool empty() const;
+    void clear();
+
+    iterator find(K key);
+    iterator begin();
+    iterator end();
+    iterator lower_bound(K key);
+    iterator upper_bound(K key);
+    RadixRange<iterator> prefixMatch(K key, unsigned bits);
+
+    std::pair<iterator, bool> insert(const value_type &value);
+    std::pair<iterator, bool> insert(K key, const V &value);
+    template <typename... Args>
+    std::pair<iterator, bool> try_emplace(K key, Args&&... args);
+    V& operator[](K key);
+    bool erase(K key);
+    void erase(iterator it);
+    const allocator_type& allocator() const;
+private:
+    using node_type = CritBitNode<K, V>;
+    using leaf_type = CritBitLeaf<K, V>;
+    CritBitTrie(const CritBitTrie &) = delete;
+    CritBitTrie& operator=(const CritBitTrie &) = delete;
+    static bool bitOf(K key, unsigned bit);
+    static unsigned critBit(K left, K right);
+    static leaf_type* leaf(node_type *node);
+    node_type* closest(K key) const;
+    node_type* divergence(K key, unsigned crit) const;
+    template <typename F>
+    std::pair<iterator, bool> insertWith(K key, F &&make);
+    void unlink(node_type *node);
+    void destroyAll(bool reclaim);
+    node_type *mRoot;
+    size_type mSize;
+    A mAlloc;
+};
+
+// The integer keys get RadixTrie's name through these specializations.
+// Crit-bit nodes carry no augmentation, so G is accepted and ignored.
+template <typename V, typename C, typename A, typename G>
+class RadixTrie<uint32_t, V, C, A, G> : public CritBitTrie<uint32_t, V, A> {
+};
+
+template <typename V, typename C, typename A, typename G>
+class RadixTrie<uint64_t, V, C, A, G> : public CritBitTrie<uint64_t, V, A> {
+};
+
+template <typename V, typename C, typename A, typename G>
+class RadixTrie<RadixUint128, V, C, A, G> : public CritBitTrie<RadixUint128, V, A> {
+};
+
+template <typename K, typename V>
+CritBitIter<K, V>::CritBitIter()
+    : mPointed(nullptr),
+    mRoot(nullptr) { }
+
+template <typename K, typename V>
+CritBitIter<K, V>::CritBitIter(node_type *node, node_type *root)
+    : mPointed(node),
+    mRoot(root) { }
+
+// Outermost leaf of the subtree of node on side (0 left, 1 right).
+template <typename K, typename V>
+auto CritBitIter<K, V>::edge(node_type *node, int side) -> node_type* {
+    while (!node->isLeaf()) {
+        node = node->child[side];
+    }
+    return node;
+}
+
+// Next leaf after the subtree of node in direction side, or nullptr.
+template <typename K, typename V>
+auto CritBitIter<K, V>::step(node_type *node, int side) -> node_type* {
+    for (auto parent = node->parent; parent != nullptr; node = parent, parent = parent->parent) {
+        if (parent->child[1 - side] == node) {
+            return edge(parent->child[side], 1 - side);
+        }
+    }
+    return nullptr;
+}
+
+template <typename K, typename V>
+auto CritBitIter<K, V>::operator*() const -> reference {
+    return static_cast<CritBitLeaf<K, V> *>(mPointed)->value;
+}
+
+template <typename K, typename V>
+auto CritBitIter<K, V>::operator->() const -> pointer {
+    return &static_cast<CritBitLeaf<K, V> *>(mPointed)->value;
+}
+
+template <typename K, typename V>
+CritBitIter<K, V>& CritBitIter<K, V>::operator++() { // prefix
+    mPointed = step(mPointed, 1);
+    return *this;
+}
+
+template <typename K, typename V>
+CritBitIter<K, V> CritBitIter<K, V>::operator++(int) { // postfix
+    CritBitIter copy(*this);
+    ++(*this);
+    return copy;
+}
+
+template <typename K, typename V>
+CritBitIter<K, V>& CritBitIter<K, V>::operator--() { // prefix
+    mPointed = mPointed == nullptr ? edge(mRoot, 1) : step(mPointed, 0);
+    return *this;
+}
+
+template <typename K, typename V>
+CritBitIter<K, V> CritBitIter<K, V>::operator--(int) { // postfix
+    CritBitIter copy(*this);
+    --(*this);
+    return copy;
+}
+
+template <typename K, typename V>
+bool CritBitIter<K, V>::operator!=(const CritBitIter &other) const {
+    return mPointed != other.mPointed;
+}
+
+template <typename K, typename V>
+bool CritBitIter<K, V>::operator==(const CritBitIter &other) const {
+    return mPointed == other.mPointed;
+}
+
+template <typename K, typename V>
+auto CritBitIter<K, V>::node() const -> node_type* {
+    return mPointed;
+}
+
+template <typename K, typename V, typename A>
+CritBitTrie<K, V, A>::CritBitTrie()
+    : mRoot(nullptr),
+    mSize(0),
+    mAlloc() { }
+
+template <typename K, typename V, typename A>
+CritBitTrie<K, V, A>::~CritBitTrie() {
+    clear();
+}
+
+template <typename K, typename V, typename A>
+auto CritBitTrie<K, V, A>::size() const -> size_type {
+    return mSize;
+}
+
+template <typename K, typename V, typename A>
+bool CritBitTrie<K, V, A>::empty() const {
+    return mSize == 0;
+}
+
+template <typename K, typename V, typename A>
+void CritBitTrie<K, V, A>::clear() {
+    if constexpr (!A::bulkRelease) {
+        destroyAll(true);
+    } else if constexpr (!std::is_trivially_destructible_v<value_type>) {
+        destroyAll(false);
+    }
+    mAlloc.release();
+    mRoot = nullptr;
+    mSize = 0;
+}
+
+template <typename K, typename V, typename A>
+bool CritBitTrie<K, V, A>::bitOf(K key, unsigned bit) {
+    return (key >> (Bits - 1 - bit)) & 1;
+}
+
+// Index of the first bit where two different keys disagree.
+template <typename K, typename V, typename A>
+unsigned CritBitTrie<K, V, A>::critBit(K left, K right) {
+    return RadixIntegerTraits<K>::leadingZeros(left ^ right);
+}
+
+template <typename K, typename V, typename A>
+auto CritBitTrie<K, V, A>::leaf(node_type *node) -> leaf_type* {
+    return static_cast<leaf_type *>(node);
+}
+
+// The leaf reached by following key's bits; the only candidate for a match.
+template <typename K, typename V, typename A>
+auto CritBitTrie<K, V, A>::closest(K key) const -> node_type* {
+    auto node = mRoot;
+    while (!node->isLeaf()) {
+        node = node->child[bitOf(key, node->bit)];
+    }
+    return node;
+}
+
+// Highest node on key's path whose keys all differ from key at crit: the
+// point where key would branch off.
+template <typename K, typename V, typename A>
+auto CritBitTrie<K, V, A>::divergence(K key, unsigned crit) const -> node_type* {
+    auto node = mRoot;
+    while (!node->isLeaf() && node->bit < crit) {
+        node = node->child[bitOf(key, node->bit)];
+    }
+    return node;
+}
+
+template <typename K, typename V, typename A>
+auto CritBitTrie<K, V, A>::find(K key) -> iterator {
+    if (mRoot == nullptr) {
+        return end();
+    }
+    auto node = closest(key);
+    return iterator(leaf(node)->value.first == key ? node : nullptr, mRoot);
+}
+
+template <typename K, typename V, typename A>
+auto CritBitTrie<K, V, A>::begin() -> iterator {
+    return iterator(mRoot == nullptr ? nullptr : iterator::edge(mRoot, 0), mRoot);
+}
+
+template <typename K, typename V, typename A>
+auto CritBitTrie<K, V, A>::end() -> iterator {
+    return iterator(nullptr, mRoot);
+}
+
+// Below the divergence point every key agrees with key up to crit and
+// differs at crit, so the whole subtree is either above key or below it.
+template <typename K, typename V, typename A>
+auto CritBitTrie<K, V, A>::lower_bound(K key) -> iterator {
+    if (mRoot == nullptr) {
+        return end();
+    }
+    auto best = leaf(closest(key));
+    if (best->value.first == key) {
+        return iterator(best, mRoot);
+    }
+    unsigned crit = critBit(key, best->value.first);
+    auto node = divergence(key, crit);
+    if (!bitOf(key, crit)) {
+        return iterator(iterator::edge(node, 0), mRoot);
+    }
+    return iterator(iterator::step(node, 1), mRoot);
+}
+
+template <typename K, typename V, typename A>
+auto CritBitTrie<K, V, A>::upper_bound(K key) -> iterator {
+    auto it = lower_bound(key);
+    if (it != end() && it->first == key) {
+        ++it;
+    }
+    return it;
+}
+
+// Keys whose top bits agree with key's, e.g. the addresses of a CIDR block.
+template <typename K, typename V, typename A>
+auto CritBitTrie<K, V, A>::prefixMatch(K key, unsigned bits) -> RadixRange<iterator> {
+    if (bits == 0) {
+        return RadixRange<iterator>(begin(), end());
+    }
+    K low = bits >= Bits ? key : key & ~(~K(0) >> bits);
+    K high = bits >= Bits ? key : key | (~K(0) >> bits);
+    return RadixRange<iterator>(lower_bound(low), upper_bound(high));
+}
+
+template <typename K, typename V, typename A>
+auto CritBitTrie<K, V, A>::insert(const value_type &value) -> std::pair<iterator, bool> {
+    return insertWith(value.first, [&]() {
+        return mAlloc.template create<leaf_type>(value);
+    });
+}
+
+template <typename K, typename V, typename A>
+auto CritBitTrie<K, V, A>::insert(K key, const V &value) -> std::pair<iterator, bool> {
+    return insertWith(key, [&]() {
+        return mAlloc.template create<leaf_type>(key, value);
+    });
+}
+
+template <typename K, typename V, typename A>
+template <typename... Args>
+auto CritBitTrie<K, V, A>::try_emplace(K key, Args&&... args) -> std::pair<iterator, bool> {
+    return insertWith(key, [&]() {
+        return mAlloc.template create<leaf_type>(std::piecewise_construct,
+                std::forward_as_tuple(key), std::forward_as_tuple(std::forward<Args>(args)...));
+    });
+}
+
+template <typename K, typename V, typename A>
+V& CritBitTrie<K, V, A>::operator[](K key) {
+    return try_emplace(key).first->second;
+}
+
+// A new key hangs off a new inner node placed where its path leaves the
+// tree: one leaf and one inner node per insert, no existing node moves.
+template <typename K, typename V, typename A>
+template <typename F>
+auto CritBitTrie<K, V, A>::insertWith(K key, F &&make) -> std::pair<iterator, bool> {
+    if (mRoot == nullptr) {
+        mRoot = make();
+        mSize = 1;
+        return {iterator(mRoot, mRoot), true};
+    }
+    auto best = leaf(closest(key));
+    if (best->value.first == key) {
+        return {iterator(best, mRoot), false};
+    }
+    unsigned crit = critBit(key, best->value.first);
+    auto node = divergence(key, crit);
+    node_type *created = make();
+    node_type *inner;
+    try {
+        inner = mAlloc.template create<node_type>();
+    } catch (...) {
+        mAlloc.destroy(leaf(created));
+        throw;
+    }
+    bool side = bitOf(key, crit);
+    auto parent = node->parent;
+    inner->bit = crit;
+    inner->parent = parent;
+    inner->child[side] = created;
+    inner->child[!side] = node;
+    created->parent = inner;
+    node->parent = inner;
+    if (parent == nullptr) {
+        mRoot = inner;
+    } else {
+        parent->child[parent->child[1] == node] = inner;
+    }
+    ++mSize;
+    return {iterator(created, mRoot), true};
+}
+
+template <typename K, typename V, typename A>
+bool CritBitTrie<K, V, A>::erase(K key) {
+    auto it = find(key);
+    if (it == end()) {
+        return false;
+    }
+    unlink(it.node());
+    return true;
+}
+
+template <typename K, typename V, typename A>
+void CritBitTrie<K, V, A>::erase(iterator it) {
+    unlink(it.node());
+}
+
+// Removes a leaf together with its parent; the sibling takes the parent's
+// place.
+template <typename K, typename V, typename A>
+void CritBitTrie<K, V, A>::unlink(node_type *node) {
+    auto parent = node->parent;
+    if (parent == nullptr) {
+        mRoot = nullptr;
+    } else {
+        auto sibling = parent->child[parent->child[0] == node];
+        auto grand = parent->parent;
+        sibling->parent = grand;
+        if (grand == nullptr) {
+            mRoot = sibling;
+        } else {
+            grand->child[grand->child[1] == parent] = sibling;
+        }
+        mAlloc.destroy(parent);
+    }
+    mAlloc.destroy(leaf(node));
+    --mSize;
+}
+
+// Runs the destructors of every node, and frees them too when reclaim is
+// set; without it the memory is left for release().
+template <typename K, typename V, typename A>
+void CritBitTrie<K, V, A>::destroyAll(bool reclaim) {
+    if (mRoot == nullptr) {
+        return;
+    }
+    std::vector<node_type *> pending{mRoot};
+    while (!pending.empty()) {
+        auto node = pending.back();
+        pending.pop_back();
+        if (node->isLeaf()) {
+            if (reclaim) {
+                mAlloc.destroy(leaf(node));
+            } else {
+                leaf(node)->~leaf_type();
+            }
+            continue;
+        }
+        pending.push_back(node->child[0]);
+        pending.push_back(node->child[1]);
+        if (reclaim) {
+            mAlloc.destroy(node);
+        }
+    }
+}
+
+template <typename K, typename V, typename A>
+auto CritBitTrie<K, V, A>::allocator() const -> const allocator_type& {
+    return mAlloc;
+}
+
+} // namespace Patricia
@@ -0,0 +1,553 @@
+#pragma once
+
+#include "radix_helpers.h"
+#include "radix_simd.h"
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace Patricia {
+
+// State of a minimized trie. A node no longer has one path from the root:
+// everything about it is its right language, the keys that continue from
+// it. count is the number of those keys, terminal says whether the empty
+// continuation is one of them.
+struct RadixDawgNode {
+    uint32_t edges;
+    uint32_t edgeCount;
+    uint32_t count;
+    uint32_t terminal;
+
+    bool empty() const;
+    bool isTerminal() const;
+};
+
+// Labelled edge: the label is a slice of the pool, and before is the number
+// of keys of the source node that sort before the ones taking this edge
+// (its own key, if terminal, and those of the edges to the left), so the
+// sum of before along a path is the rank of the key.
+struct RadixDawgEdge {
+    uint32_t label;
+    uint32_t length;
+    uint32_t target;
+    uint32_t before;
+};
+
+template <typename V> class RadixDawg;
+
+// Forward iterator in key order. The path from the root is kept as a stack
+// of nodes with the next edge to try at each, since a shared node has no
+// parent to climb back to; the key is rebuilt in a buffer along the path.
+template <typename V>
+class RadixDawgIter {
+public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = std::pair<std::string_view, const V&>;
+    using difference_type = std::ptrdiff_t;
+    using reference = value_type;
+
+    class pointer {
+    public:
+        explicit pointer(value_type value);
+        const value_type* operator->() const;
+    private:
+        value_type mValue;
+    };
+
+    RadixDawgIter();
+
+    reference operator*() const;
+    pointer operator->() const;
+    RadixDawgIter& operator++(); // prefix
+    RadixDawgIter operator++(int); // postfix
+    bool operator!=(const RadixDawgIter &other) const;
+    bool operator==(const RadixDawgIter &other) const;
+    std::string_view key() const;
+    const V& value() const;
+    size_t index() const;
+    size_t uniquePrefix() const;
+private:
+    friend class RadixDawg<V>;
+    struct Frame {
+        uint32_t node;
+        uint32_t next;
+        size_t depth;
+    };
+    explicit RadixDawgIter(const RadixDawg<V> *dawg);
+    void advance();
+private:
+    const RadixDawg<V> *mDawg;
+    std::vector<Frame> mPath;
+    std::string mKey;
+    size_t mIndex;
+};
+
+// Read-only directed acyclic word graph built once from a RadixTrie with
+// byte string keys. Subtrees with the same labelled edges and terminal flag
+// are merged bottom-up by hash-consing, so shared endings such as "_tv" or
+// "123" are stored once however many keys end in them. Edge labels live in
+// one pool where a label that is a suffix of another one points into it.
+// Values are kept in key order and found by the rank of the key, which the
+// per-edge counts give in the same descent: a minimal perfect hash from the
+// keys to [0, size()).
+template <typename V>
+class RadixDawg {
+public:
+    using key_type = std::string_view;
+    using key_view = std::string_view;
+    using mapped_type = V;
+    using value_type = typename RadixDawgIter<V>::value_type;
+    using iterator = RadixDawgIter<V>;
+    using size_type = std::size_t;
+
+    static constexpr size_type npos = static_cast<size_type>(-1);
+
+    RadixDawg();
+    template <typename T>
+    explicit RadixDawg(T &trie);
+
+    size_type size() const;
+    bool empty() const;
+    size_type bytes() const;
+    size_type nodeCount() const;
+    size_type edgeCount() const;
+    size_type poolSize() const;
+    iterator find(const key_view &key) const;
+    iterator find(const char *key) const;
+    size_type index(const key_view &key) const;
+    size_type uniquePrefix(const key_view &key) const;
+    iterator begin() const;
+    iterator end() const;
+    const V& value(size_type index) const;
+
+    const RadixDawgNode& node(size_t index) const;
+    const RadixDawgEdge& edge(size_t index) const;
+    std::string_view label(const RadixDawgEdge &edge) const;
+private:
+    size_t child(size_t index, unsigned char byte) const;
+    template <typename F>
+    bool descend(const key_view &key, F &&step) const;
+    void buildPool(const std::vector<std::string> &labels, std::vector<uint32_t> &offsets);
+private:
+    std::vector<RadixDawgNode> mNodes;
+    std::vector<RadixDawgEdge> mEdges;
+    std::vector<unsigned char> mEdgeBytes;
+    std::vector<V> mValues;
+    std::string mPool;
+    uint32_t mRoot;
+};
+
+inline bool RadixDawgNode::empty() const {
+    return edgeCount == 0;
+}
+
+inline bool RadixDawgNode::isTerminal() const {
+    return terminal != 0;
+}
+
+template <typename V>
+RadixDawgIter<V>::pointer::pointer(value_type value)
+    : mValue(value) { }
+
+template <typename V>
+auto RadixDawgIter<V>::pointer::operator->() const -> const value_type* {
+    return &mValue;
+}
+
+template <typename V>
+RadixDawgIter<V>::RadixDawgIter()
+    : mDawg(nullptr),
+    mPath(),
+    mKey(),
+    mIndex(0) { }
+
+template <typename V>
+RadixDawgIter<V>::RadixDawgIter(const RadixDawg<V> *dawg)
+    : mDawg(dawg),
+    mPath(),
+    mKey(),
+    mIndex(0) { }
+
+template <typename V>
+auto RadixDawgIter<V>::operator*() const -> reference {
+    return value_type(key(), value());
+}
+
+template <typename V>
+auto RadixDawgIter<V>::operator->() const -> pointer {
+    return pointer(**this);
+}
+
+// Next terminal in preorder: the first untried edge of the deepest frame
+// that has one, with frames popped as they run out.
+template <typename V>
+void RadixDawgIter<V>::advance() {
+    while (!mPath.empty()) {
+        auto &frame = mPath.back();
+        const auto &node = mDawg->node(frame.node);
+        if (frame.next == node.edgeCount) {
+            mPath.pop_back();
+            continue;
+        }
+        const auto &edge = mDawg->edge(node.edges + frame.next++);
+        mKey.resize(frame.depth);
+        mKey.append(mDawg->label(edge));
+        mPath.push_back({edge.target, 0, mKey.size()});
+        if (mDawg->node(edge.target).isTerminal()) {
+            return;
+        }
+    }
+    mKey.clear();
+}
+
+template <typename V>
+RadixDawgIter<V>& RadixDawgIter<V>::operator++() { // prefix
+    if (!mPath.empty()) {
+        ++mIndex;
+        advance();
+    }
+    return *this;
+}
+
+template <typename V>
+RadixDawgIter<V> RadixDawgIter<V>::operator++(int) { // postfix
+    RadixDawgIter<V> copy(*this);
+    ++(*this);
+    return copy;
+}
+
+template <typename V>
+bool RadixDawgIter<V>::operator!=(const RadixDawgIter &other) const {
+    return !(*this == other);
+}
+
+// The key order is total, so two iterators over one graph are at the same
+// key exactly when they have passed the same number of keys.
+template <typename V>
+bool RadixDawgIter<V>::operator==(const RadixDawgIter &other) const {
+    return mPath.empty() == other.mPath.empty() && (mPath.empty() || mIndex == other.mIndex);
+}
+
+template <typename V>
+std::string_view RadixDawgIter<V>::key() const {
+    return mKey;
+}
+
+template <typename V>
+const V& RadixDawgIter<V>::value() const {
+    return mDawg->value(mIndex);
+}
+
+// Position of the key in key order, the index of its value.
+template <typename V>
+size_t RadixDawgIter<V>::index() const {
+    return mIndex;
+}
+
+// Same rule as nicknameLength(): a key without continuations is told apart
+// by the first byte of the edge into its node, any other key needs all of
+// itself.
+template <typename V>
+size_t RadixDawgIter<V>::uniquePrefix() const {
+    if (mPath.size() < 2 || !mDawg->node(mPath.back().node).empty()) {
+        return mKey.size();
+    }
+    return std::min(mKey.size(), mPath[mPath.size() - 2].depth + 1);
+}
+
+template <typename V>
+RadixDawg<V>::RadixDawg()
+    : mNodes(),
+    mEdges(),
+    mEdgeBytes(),
+    mValues(),
+    mPool(),
+    mRoot(0) { }
+
+// Minimizes trie bottom-up without recursion. A node's signature is its
+// terminal flag and the (label, target id) list of its edges, where the
+// targets are already minimized; equal signatures mean equal right
+// languages, so the node is replaced by the one registered first.
+template <typename V>
+template <typename T>
+RadixDawg<V>::RadixDawg(T &trie)
+    : RadixDawg() {
+    using node_type = std::remove_pointer_t<decltype(trie.root())>;
+    if (trie.empty()) {
+        return;
+    }
+    for (const auto &entry : trie) {
+        mValues.push_back(entry.second);
+    }
+    if (mValues.size() >= UINT32_MAX) {
+        throw std::length_error("dawg: too many keys");
+    }
+    std::unordered_map<node_type *, uint32_t> ids;
+    std::unordered_map<std::string, uint32_t> registry;
+    std::unordered_map<std::string, uint32_t> labelIds;
+    std::vector<std::string> labels;
+    std::vector<uint32_t> edgeLabels;
+    std::vector<std::pair<node_type *, bool>> stack{{trie.root(), false}};
+    std::vector<node_type *> children;
+    std::string signature;
+    auto put = [&signature](uint32_t number) {
+        signature.append(reinterpret_cast<const char *>(&number), sizeof(number));
+    };
+    while (!stack.empty()) {
+        auto [node, visited] = stack.back();
+        stack.pop_back();
+        if (!visited) {
+            stack.emplace_back(node, true);
+            for (auto child : node->children()) {
+                stack.emplace_back(child, false);
+            }
+            continue;
+        }
+        children.clear();
+        for (auto child : node->children()) {
+            children.push_back(child);
+        }
+        signature.assign(1, node->isTerminal() ? '$' : '.');
+        for (auto child : children) {
+            auto edge = radixSlice(child->key(), 0, radixSize(child->key()));
+            put(static_cast<uint32_t>(edge.size()));
+            signature.append(edge.data(), edge.size());
+            put(ids.at(child));
+        }
+        auto [known, added] = registry.emplace(signature, static_cast<uint32_t>(mNodes.size()));
+        ids.emplace(node, known->second);
+        if (!added) {
+            continue;
+        }
+        if (mNodes.size() >= UINT32_MAX || mEdges.size() + children.size() >= UINT32_MAX) {
+            throw std::length_error("dawg: too many nodes");
+        }
+        RadixDawgNode minimized = RadixDawgNode();
+        minimized.edges = static_cast<uint32_t>(mEdges.size());
+        minimized.edgeCount = static_cast<uint32_t>(children.size());
+        minimized.terminal = node->isTerminal() ? 1 : 0;
+        minimized.count = minimized.terminal;
+        for (auto child : children) {
+            auto edge = radixSlice(child->key(), 0, radixSize(child->key()));
+            auto [label, fresh] = labelIds.emplace(std::string(edge), static_cast<uint32_t>(labels.size()));
+            if (fresh) {
+                labels.emplace_back(edge);
+            }
+            RadixDawgEdge frozen = RadixDawgEdge();
+            frozen.length = static_cast<uint32_t>(edge.size());
+            frozen.target = ids.at(child);
+            frozen.before = minimized.count;
+            minimized.count += mNodes[frozen.target].count;
+            mEdges.push_back(frozen);
+            mEdgeBytes.push_back(radixByte(edge, 0));
+            edgeLabels.push_back(label->second);
+        }
+        mNodes.push_back(minimized);
+    }
+    mRoot = ids.at(trie.root());
+    std::vector<uint32_t> offsets;
+    buildPool(labels, offsets);
+    for (size_t i = 0; i < mEdges.size(); ++i) {
+        mEdges[i].label = offsets[edgeLabels[i]];
+    }
+}
+
+// Lays the distinct labels out in one pool. Sorted by their reversed bytes,
+// a label that is a suffix of another one comes right before a label it is
+// a suffix of, so walking that order backwards each label either ends the
+// label stored after it or gets bytes of its own.
+template <typename V>
+void RadixDawg<V>::buildPool(const std::vector<std::string> &labels, std::vector<uint32_t> &offsets) {
+    std::vector<uint32_t> order(labels.size());
+    for (size_t i = 0; i < order.size(); ++i) {
+        order[i] = static_cast<uint32_t>(i);
+    }
+    std::sort(order.begin(), order.end(), [&labels](uint32_t left, uint32_t right) {
+        return std::lexicographical_compare(labels[left].rbegin(), labels[left].rend(),
+                labels[right].rbegin(), labels[right].rend());
+    });
+    offsets.assign(labels.size(), 0);
+    for (size_t i = order.size(); i-- > 0;) {
+        const auto &label = labels[order[i]];
+        if (i + 1 < order.size()) {
+            const auto &next = labels[order[i + 1]];
+            if (next.size() >= label.size() &&
+                    next.compare(next.size() - label.size(), label.size(), label) == 0) {
+                offsets[order[i]] = static_cast<uint32_t>(offsets[order[i + 1]] + next.size() - label.size());
+                continue;
+            }
+        }
+        if (mPool.size() + label.size() >= UINT32_MAX) {
+            throw std::length_error("dawg: edge labels too long");
+        }
+        offsets[order[i]] = static_cast<uint32_t>(mPool.size());
+        mPool.append(label);
+    }
+}
+
+template <typename V>
+auto RadixDawg<V>::size() const -> size_type {
+    return mValues.size();
+}
+
+template <typename V>
+bool RadixDawg<V>::empty() const {
+    return mValues.empty();
+}
+
+// Bytes held by the graph, the labels and the values.
+template <typename V>
+auto RadixDawg<V>::bytes() const -> size_type {
+    return mNodes.size() * sizeof(RadixDawgNode) + mEdges.size() * (sizeof(RadixDawgEdge) + 1) +
+        mPool.size() + mValues.size() * sizeof(V);
+}
+
+template <typename V>
+auto RadixDawg<V>::nodeCount() const -> size_type {
+    return mNodes.size();
+}
+
+template <typename V>
+auto RadixDawg<V>::edgeCount() const -> size_type {
+    return mEdges.size();
+}
+
+template <typename V>
+auto RadixDawg<V>::poolSize() const -> size_type {
+    return mPool.size();
+}
+
+template <typename V>
+const RadixDawgNode& RadixDawg<V>::node(size_t index) const {
+    return mNodes[index];
+}
+
+template <typename V>
+const RadixDawgEdge& RadixDawg<V>::edge(size_t index) const {
+    return mEdges[index];
+}
+
+template <typename V>
+std::string_view RadixDawg<V>::label(const RadixDawgEdge &edge) const {
+    return std::string_view(mPool.data() + edge.label, edge.length);
+}
+
+template <typename V>
+const V& RadixDawg<V>::value(size_type index) const {
+    return mValues[index];
+}
+
+// Edge of node index whose label starts with byte, edgeCount() if none.
+template <typename V>
+size_t RadixDawg<V>::child(size_t index, unsigned char byte) const {
+    const auto &node = mNodes[index];
+    auto bytes = reinterpret_cast<const char *>(mEdgeBytes.data() + node.edges);
+    size_t pos = simd::findByte(bytes, node.edgeCount, static_cast<char>(byte));
+    return pos == node.edgeCount ? mEdges.size() : node.edges + pos;
+}
+
+// Follows key from the root, calling step(node, edge) for every edge taken.
+// Returns whether key is stored.
+template <typename V>
+template <typename F>
+bool RadixDawg<V>::descend(const key_view &key, F &&step) const {
+    if (mValues.empty()) {
+        return false;
+    }
+    size_t index = mRoot;
+    size_t depth = 0;
+    while (depth < key.size()) {
+        size_t next = child(index, radixByte(key, depth));
+        if (next == mEdges.size()) {
+            return false;
+        }
+        const auto &edge = mEdges[next];
+        auto rest = key.substr(depth);
+        if (rest.size() < edge.length || radixCommonPrefix(label(edge), rest) != edge.length) {
+            return false;
+        }
+        step(index, next, depth);
+        index = edge.target;
+        depth += edge.length;
+    }
+    return mNodes[index].isTerminal();
+}
+
+template <typename V>
+auto RadixDawg<V>::find(const key_view &key) const -> iterator {
+    iterator it(this);
+    it.mPath.push_back({mRoot, 0, 0});
+    bool found = descend(key, [this, &it](size_t index, size_t edge, size_t depth) {
+        it.mPath.back().next = static_cast<uint32_t>(edge - mNodes[index].edges + 1);
+        it.mIndex += mEdges[edge].before;
+        it.mPath.push_back({mEdges[edge].target, 0, depth + mEdges[edge].length});
+    });
+    if (!found) {
+        return end();
+    }
+    it.mKey.assign(key);
+    return it;
+}
+
+template <typename V>
+auto RadixDawg<V>::find(const char *key) const -> iterator {
+    return find(key_view(key));
+}
+
+// Rank of key among the stored keys, the index of its value; npos if key
+// is not stored. One descent, no iterator state.
+template <typename V>
+auto RadixDawg<V>::index(const key_view &key) const -> size_type {
+    size_type rank = 0;
+    bool found = descend(key, [this, &rank](size_t, size_t edge, size_t) {
+        rank += mEdges[edge].before;
+    });
+    return found ? rank : npos;
+}
+
+// Length of the shortest prefix telling key apart from every other stored
+// key, the nickname of key; npos if key is not stored.
+template <typename V>
+auto RadixDawg<V>::uniquePrefix(const key_view &key) const -> size_type {
+    size_t above = npos;
+    size_t target = mRoot;
+    bool found = descend(key, [this, &above, &target](size_t, size_t edge, size_t depth) {
+        above = depth;
+        target = mEdges[edge].target;
+    });
+    if (!found) {
+        return npos;
+    }
+    if (above == npos || !mNodes[target].empty()) {
+        return key.size();
+    }
+    return std::min(key.size(), above + 1);
+}
+
+template <typename V>
+auto RadixDawg<V>::begin() const -> iterator {
+    if (mValues.empty()) {
+        return end();
+    }
+    iterator it(this);
+    it.mPath.push_back({mRoot, 0, 0});
+    if (!mNodes[mRoot].isTerminal()) {
+        it.advance();
+    }
+    return it;
+}
+
+template <typename V>
+auto RadixDawg<V>::end() const -> iterator {
+    return iterator(this);
+}
+
+} // namespace Patricia
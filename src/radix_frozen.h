@@ -0,0 +1,768 @@
+#pragma once
+
+#include "radix_iter.h"
+#include "radix_helpers.h"
+#include "radix_simd.h"
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace Patricia {
+
+// On-disk layout of a frozen trie. Every section starts at a multiple of
+// Alignment from the beginning of the file:
+//   header | nodes | child bytes | child indexes | values | edge pool
+// Nodes are stored in depth-first preorder, so a subtree is the contiguous
+// index range [i, end) and terminals appear in key order.
+struct FrozenRadixHeader {
+    static constexpr char Magic[8] = {'R', 'A', 'D', 'I', 'X', 'F', 'R', 'Z'};
+    static constexpr uint32_t Version = 1;
+    static constexpr uint32_t ByteOrder = 0x01020304;
+    static constexpr uint64_t Alignment = 16;
+
+    static uint64_t align(uint64_t offset);
+
+    char magic[8];
+    uint32_t version;
+    uint32_t byteOrder;
+    uint32_t nodeSize;
+    uint32_t valueSize;
+    uint64_t nodeCount;
+    uint64_t keyCount;
+    uint64_t childCount;
+    uint64_t poolSize;
+    uint64_t nodesOffset;
+    uint64_t childBytesOffset;
+    uint64_t childNodesOffset;
+    uint64_t valuesOffset;
+    uint64_t poolOffset;
+    uint64_t fileSize;
+};
+
+// Pointer-free node: the edge is a slice of the pool, children are a run of
+// first bytes and node indexes in the child tables, and rank counts the
+// terminals before this node so it indexes the values array.
+struct FrozenRadixNode {
+    uint64_t edgeOffset;
+    uint32_t edgeLength;
+    uint32_t nodeDepth;
+    uint32_t end;
+    uint32_t rank;
+    uint32_t children;
+    uint16_t childCount;
+    uint16_t terminal;
+
+    size_t depth() const;
+    size_t size() const;
+    bool empty() const;
+    bool isTerminal() const;
+};
+
+template <typename V> class FrozenRadixTrie;
+
+// Forward iterator over the terminals of a frozen trie. The key is rebuilt
+// in a buffer as the iterator moves: the next node in preorder hangs below a
+// prefix of the current path, so each node passed truncates the buffer to
+// its depth and appends its edge.
+template <typename V>
+class FrozenRadixIter {
+public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = std::pair<std::string_view, const V&>;
+    using difference_type = std::ptrdiff_t;
+    using reference = value_type;
+
+    class pointer {
+    public:
+        explicit pointer(value_type value);
+        const value_type* operator->() const;
+    private:
+        value_type mValue;
+    };
+
+    FrozenRadixIter();
+    FrozenRadixIter(const FrozenRadixTrie<V> *trie, size_t index, std::string key);
+
+    reference operator*() const;
+    pointer operator->() const;
+    FrozenRadixIter& operator++(); // prefix
+    FrozenRadixIter operator++(int); // postfix
+    bool operator!=(const FrozenRadixIter &other) const;
+    bool operator==(const FrozenRadixIter &other) const;
+    const FrozenRadixNode* node() const;
+    std::string_view key() const;
+    const V& value() const;
+private:
+    const FrozenRadixTrie<V> *mTrie;
+    size_t mIndex;
+    std::string mKey;
+};
+
+// Read-only radix trie over std::string_view keys that lives in one
+// contiguous block, typically a shared read-only mapping of a file written
+// by write(). Opening costs a header check; everything else is demand paged,
+// and processes mapping the same file share its page cache copy. Node fields
+// are trusted unless verify() accepted them. Values are stored raw, so V
+// must be trivially copyable.
+template <typename V>
+class FrozenRadixTrie {
+public:
+    using key_type = std::string_view;
+    using key_view = std::string_view;
+    using mapped_type = V;
+    using value_type = typename FrozenRadixIter<V>::value_type;
+    using iterator = FrozenRadixIter<V>;
+    using size_type = std::size_t;
+
+    static_assert(std::is_trivially_copyable_v<V>, "frozen values are stored as raw bytes");
+    static_assert(alignof(V) <= FrozenRadixHeader::Alignment, "frozen sections are 16 byte aligned");
+
+    FrozenRadixTrie();
+    FrozenRadixTrie(const void *data, size_t size);
+    FrozenRadixTrie(FrozenRadixTrie &&other) noexcept;
+    FrozenRadixTrie& operator=(FrozenRadixTrie &&other) noexcept;
+    ~FrozenRadixTrie();
+
+    static FrozenRadixTrie open(const std::string &path);
+    template <typename T>
+    static void write(T &trie, std::ostream &out);
+    template <typename T>
+    static void write(T &trie, const std::string &path);
+
+    size_type size() const;
+    bool empty() const;
+    size_type bytes() const;
+    iterator find(const key_view &key) const;
+    iterator find(const char *key) const;
+    iterator begin() const;
+    iterator end() const;
+    RadixRange<iterator> prefixMatch(const key_view &prefix) const;
+    std::vector<iterator> prefixMatch(const key_view &prefix, size_type limit) const;
+    size_type count_prefix(const key_view &prefix) const;
+    void dump(std::ostream &out = std::cout) const;
+    void verify() const;
+
+    size_t nodeCount() const;
+    const FrozenRadixNode& node(size_t index) const;
+    std::string_view edge(size_t index) const;
+    const V& value(size_t index) const;
+    size_t nextTerminal(size_t index) const;
+private:
+    FrozenRadixTrie(const FrozenRadixTrie &) = delete;
+    FrozenRadixTrie& operator=(const FrozenRadixTrie &) = delete;
+    void attach(const char *data, size_t size);
+    void unmap();
+    size_t child(size_t index, unsigned char byte) const;
+    size_t locatePrefix(const key_view &prefix) const;
+    size_t rankBefore(size_t index) const;
+    iterator at(size_t index) const;
+    void dump(size_t index, std::ostream &out, const std::string &prefix, bool last) const;
+private:
+    const FrozenRadixNode *mNodes;
+    const unsigned char *mChildBytes;
+    const uint32_t *mChildNodes;
+    const V *mValues;
+    const char *mPool;
+    size_t mNodeCount;
+    size_t mChildCount;
+    size_t mPoolSize;
+    size_t mSize;
+    size_t mBytes;
+    void *mMap;
+    size_t mMapSize;
+};
+
+inline size_t FrozenRadixNode::depth() const {
+    return nodeDepth;
+}
+
+inline size_t FrozenRadixNode::size() const {
+    return edgeLength;
+}
+
+inline bool FrozenRadixNode::empty() const {
+    return childCount == 0;
+}
+
+inline bool FrozenRadixNode::isTerminal() const {
+    return terminal != 0;
+}
+
+template <typename V>
+FrozenRadixIter<V>::pointer::pointer(value_type value)
+    : mValue(value) { }
+
+template <typename V>
+auto FrozenRadixIter<V>::pointer::operator->() const -> const value_type* {
+    return &mValue;
+}
+
+template <typename V>
+FrozenRadixIter<V>::FrozenRadixIter()
+    : mTrie(nullptr),
+    mIndex(0),
+    mKey() { }
+
+template <typename V>
+FrozenRadixIter<V>::FrozenRadixIter(const FrozenRadixTrie<V> *trie, size_t index, std::string key)
+    : mTrie(trie),
+    mIndex(index),
+    mKey(std::move(key)) { }
+
+template <typename V>
+auto FrozenRadixIter<V>::operator*() const -> reference {
+    return reference(std::string_view(mKey), value());
+}
+
+template <typename V>
+auto FrozenRadixIter<V>::operator->() const -> pointer {
+    return pointer(**this);
+}
+
+template <typename V>
+FrozenRadixIter<V>& FrozenRadixIter<V>::operator++() { // prefix
+    size_t count = mTrie->nodeCount();
+    while (++mIndex < count) {
+        const auto &next = mTrie->node(mIndex);
+        mKey.resize(next.depth());
+        mKey.append(mTrie->edge(mIndex));
+        if (next.isTerminal()) {
+            return *this;
+        }
+    }
+    mKey.clear();
+    return *this;
+}
+
+template <typename V>
+FrozenRadixIter<V> FrozenRadixIter<V>::operator++(int) { // postfix
+    FrozenRadixIter copy(*this);
+    ++(*this);
+    return copy;
+}
+
+template <typename V>
+bool FrozenRadixIter<V>::operator!=(const FrozenRadixIter &other) const {
+    return mIndex != other.mIndex || mTrie != other.mTrie;
+}
+
+template <typename V>
+bool FrozenRadixIter<V>::operator==(const FrozenRadixIter &other) const {
+    return !(*this != other);
+}
+
+// Node the iterator points at, nullptr for end().
+template <typename V>
+const FrozenRadixNode* FrozenRadixIter<V>::node() const {
+    return mTrie != nullptr && mIndex < mTrie->nodeCount() ? &mTrie->node(mIndex) : nullptr;
+}
+
+template <typename V>
+std::string_view FrozenRadixIter<V>::key() const {
+    return mKey;
+}
+
+template <typename V>
+const V& FrozenRadixIter<V>::value() const {
+    return mTrie->value(mIndex);
+}
+
+inline uint64_t FrozenRadixHeader::align(uint64_t offset) {
+    return (offset + Alignment - 1) / Alignment * Alignment;
+}
+
+template <typename V>
+FrozenRadixTrie<V>::FrozenRadixTrie()
+    : mNodes(nullptr),
+    mChildBytes(nullptr),
+    mChildNodes(nullptr),
+    mValues(nullptr),
+    mPool(nullptr),
+    mNodeCount(0),
+    mChildCount(0),
+    mPoolSize(0),
+    mSize(0),
+    mBytes(0),
+    mMap(nullptr),
+    mMapSize(0) { }
+
+// Views a snapshot already in memory; data must stay alive and unchanged
+// while the trie is used.
+template <typename V>
+FrozenRadixTrie<V>::FrozenRadixTrie(const void *data, size_t size)
+    : FrozenRadixTrie() {
+    attach(static_cast<const char *>(data), size);
+}
+
+template <typename V>
+FrozenRadixTrie<V>::FrozenRadixTrie(FrozenRadixTrie &&other) noexcept
+    : FrozenRadixTrie() {
+    *this = std::move(other);
+}
+
+template <typename V>
+FrozenRadixTrie<V>& FrozenRadixTrie<V>::operator=(FrozenRadixTrie &&other) noexcept {
+    if (this != &other) {
+        unmap();
+        mNodes = std::exchange(other.mNodes, nullptr);
+        mChildBytes = std::exchange(other.mChildBytes, nullptr);
+        mChildNodes = std::exchange(other.mChildNodes, nullptr);
+        mValues = std::exchange(other.mValues, nullptr);
+        mPool = std::exchange(other.mPool, nullptr);
+        mNodeCount = std::exchange(other.mNodeCount, 0);
+        mChildCount = std::exchange(other.mChildCount, 0);
+        mPoolSize = std::exchange(other.mPoolSize, 0);
+        mSize = std::exchange(other.mSize, 0);
+        mBytes = std::exchange(other.mBytes, 0);
+        mMap = std::exchange(other.mMap, nullptr);
+        mMapSize = std::exchange(other.mMapSize, 0);
+    }
+    return *this;
+}
+
+template <typename V>
+FrozenRadixTrie<V>::~FrozenRadixTrie() {
+    unmap();
+}
+
+template <typename V>
+void FrozenRadixTrie<V>::unmap() {
+    if (mMap != nullptr) {
+        ::munmap(mMap, mMapSize);
+        mMap = nullptr;
+        mMapSize = 0;
+    }
+}
+
+// Maps a file written by write() read-only and shared. Only the header is
+// read here; nodes, values and edges are faulted in by the queries that
+// touch them. The file is trusted: a corrupt node sends queries out of
+// bounds, so call verify() on files from elsewhere.
+template <typename V>
+FrozenRadixTrie<V> FrozenRadixTrie<V>::open(const std::string &path) {
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        throw std::runtime_error("cannot open frozen trie " + path);
+    }
+    struct stat info;
+    if (::fstat(fd, &info) != 0 || info.st_size <= 0) {
+        ::close(fd);
+        throw std::runtime_error("empty frozen trie " + path);
+    }
+    size_t size = static_cast<size_t>(info.st_size);
+    void *map = ::mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (map == MAP_FAILED) {
+        throw std::runtime_error("cannot map frozen trie " + path);
+    }
+    FrozenRadixTrie result;
+    result.mMap = map;
+    result.mMapSize = size;
+    result.attach(static_cast<const char *>(map), size);
+    return result;
+}
+
+template <typename V>
+void FrozenRadixTrie<V>::attach(const char *data, size_t size) {
+    FrozenRadixHeader header;
+    if (size < sizeof(header)) {
+        throw std::runtime_error("frozen trie: truncated header");
+    }
+    std::memcpy(&header, data, sizeof(header));
+    if (std::memcmp(header.magic, FrozenRadixHeader::Magic, sizeof(header.magic)) != 0) {
+        throw std::runtime_error("frozen trie: bad magic");
+    }
+    if (header.version != FrozenRadixHeader::Version) {
+        throw std::runtime_error("frozen trie: unsupported version " + std::to_string(header.version));
+    }
+    if (header.byteOrder != FrozenRadixHeader::ByteOrder || header.nodeSize != sizeof(FrozenRadixNode) ||
+            header.valueSize != sizeof(V)) {
+        throw std::runtime_error("frozen trie: written for another byte order or value type");
+    }
+    auto fits = [&header](uint64_t offset, uint64_t count, uint64_t width) {
+        return offset % FrozenRadixHeader::Alignment == 0 && offset <= header.fileSize &&
+            count <= (header.fileSize - offset) / width;
+    };
+    if (header.fileSize > size || header.nodeCount == 0 ||
+            reinterpret_cast<uintptr_t>(data) % FrozenRadixHeader::Alignment != 0 ||
+            !fits(header.nodesOffset, header.nodeCount, sizeof(FrozenRadixNode)) ||
+            !fits(header.childBytesOffset, header.childCount, 1) ||
+            !fits(header.childNodesOffset, header.childCount, sizeof(uint32_t)) ||
+            !fits(header.valuesOffset, header.keyCount, sizeof(V)) ||
+            !fits(header.poolOffset, header.poolSize, 1)) {
+        throw std::runtime_error("frozen trie: corrupt section table");
+    }
+    mNodes = reinterpret_cast<const FrozenRadixNode *>(data + header.nodesOffset);
+    mChildBytes = reinterpret_cast<const unsigned char *>(data + header.childBytesOffset);
+    mChildNodes = reinterpret_cast<const uint32_t *>(data + header.childNodesOffset);
+    mValues = reinterpret_cast<const V *>(data + header.valuesOffset);
+    mPool = data + header.poolOffset;
+    mNodeCount = header.nodeCount;
+    mChildCount = header.childCount;
+    mPoolSize = header.poolSize;
+    mSize = header.keyCount;
+    mBytes = header.fileSize;
+}
+
+// Serializes trie, any RadixTrie with byte string keys, in preorder. The
+// child tables of a node are reserved when it is emitted and filled in as
+// its children get their indexes.
+template <typename V>
+template <typename T>
+void FrozenRadixTrie<V>::write(T &trie, std::ostream &out) {
+    using node_type = std::remove_pointer_t<decltype(trie.root())>;
+    constexpr size_t NoSlot = static_cast<size_t>(-1);
+    std::vector<FrozenRadixNode> nodes;
+    std::vector<unsigned char> childBytes;
+    std::vector<uint32_t> childNodes;
+    std::vector<V> values;
+    std::string pool;
+    std::vector<std::pair<node_type *, size_t>> stack;
+    std::vector<node_type *> children;
+    if (trie.root() != nullptr) {
+        stack.emplace_back(trie.root(), NoSlot);
+    } else {
+        nodes.push_back(FrozenRadixNode());
+    }
+    while (!stack.empty()) {
+        auto [node, slot] = stack.back();
+        stack.pop_back();
+        if (nodes.size() >= UINT32_MAX || node->depth() >= UINT32_MAX) {
+            throw std::length_error("frozen trie: too many nodes or too long keys");
+        }
+        if (slot != NoSlot) {
+            childNodes[slot] = static_cast<uint32_t>(nodes.size());
+        }
+        auto edge = radixSlice(node->key(), 0, radixSize(node->key()));
+        FrozenRadixNode frozen = FrozenRadixNode();
+        frozen.edgeOffset = pool.size();
+        frozen.edgeLength = static_cast<uint32_t>(edge.size());
+        frozen.nodeDepth = static_cast<uint32_t>(node->depth());
+        frozen.rank = static_cast<uint32_t>(values.size());
+        frozen.children = static_cast<uint32_t>(childNodes.size());
+        frozen.childCount = static_cast<uint16_t>(node->size());
+        frozen.terminal = node->isTerminal() ? 1 : 0;
+        pool.append(edge.data(), edge.size());
+        if (node->isTerminal()) {
+            values.push_back(node->value().second);
+        }
+        for (auto it = node->children().begin(); it != node->children().end(); ++it) {
+            childBytes.push_back(it.byte());
+            children.push_back(*it);
+        }
+        childNodes.resize(childNodes.size() + children.size());
+        for (size_t i = children.size(); i-- > 0;) {
+            stack.emplace_back(children[i], frozen.children + i);
+        }
+        children.clear();
+        nodes.push_back(frozen);
+    }
+    for (size_t i = nodes.size(); i-- > 0;) {
+        auto &node = nodes[i];
+        node.end = node.childCount == 0 ? static_cast<uint32_t>(i + 1)
+            : nodes[childNodes[node.children + node.childCount - 1]].end;
+    }
+
+    FrozenRadixHeader header = FrozenRadixHeader();
+    std::memcpy(header.magic, FrozenRadixHeader::Magic, sizeof(header.magic));
+    header.version = FrozenRadixHeader::Version;
+    header.byteOrder = FrozenRadixHeader::ByteOrder;
+    header.nodeSize = sizeof(FrozenRadixNode);
+    header.valueSize = sizeof(V);
+    header.nodeCount = nodes.size();
+    header.keyCount = values.size();
+    header.childCount = childNodes.size();
+    header.poolSize = pool.size();
+    header.nodesOffset = FrozenRadixHeader::align(sizeof(header));
+    header.childBytesOffset = FrozenRadixHeader::align(header.nodesOffset + nodes.size() * sizeof(FrozenRadixNode));
+    header.childNodesOffset = FrozenRadixHeader::align(header.childBytesOffset + childBytes.size());
+    header.valuesOffset = FrozenRadixHeader::align(header.childNodesOffset + childNodes.size() * sizeof(uint32_t));
+    header.poolOffset = FrozenRadixHeader::align(header.valuesOffset + values.size() * sizeof(V));
+    header.fileSize = header.poolOffset + pool.size();
+
+    uint64_t written = 0;
+    auto section = [&out, &written](uint64_t offset, const void *data, size_t size) {
+        static const char padding[FrozenRadixHeader::Alignment] = {};
+        out.write(padding, static_cast<std::streamsize>(offset - written));
+        out.write(static_cast<const char *>(data), static_cast<std::streamsize>(size));
+        written = offset + size;
+    };
+    section(0, &header, sizeof(header));
+    section(header.nodesOffset, nodes.data(), nodes.size() * sizeof(FrozenRadixNode));
+    section(header.childBytesOffset, childBytes.data(), childBytes.size());
+    section(header.childNodesOffset, childNodes.data(), childNodes.size() * sizeof(uint32_t));
+    section(header.valuesOffset, values.data(), values.size() * sizeof(V));
+    section(header.poolOffset, pool.data(), pool.size());
+    if (!out) {
+        throw std::runtime_error("frozen trie: write failed");
+    }
+}
+
+template <typename V>
+template <typename T>
+void FrozenRadixTrie<V>::write(T &trie, const std::string &path) {
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    if (!out) {
+        throw std::runtime_error("cannot create frozen trie " + path);
+    }
+    write(trie, out);
+    out.close();
+    if (!out) {
+        throw std::runtime_error("frozen trie: write failed");
+    }
+}
+
+template <typename V>
+auto FrozenRadixTrie<V>::size() const -> size_type {
+    return mSize;
+}
+
+template <typename V>
+bool FrozenRadixTrie<V>::empty() const {
+    return mSize == 0;
+}
+
+// Size of the snapshot, header and padding included.
+template <typename V>
+auto FrozenRadixTrie<V>::bytes() const -> size_type {
+    return mBytes;
+}
+
+template <typename V>
+size_t FrozenRadixTrie<V>::nodeCount() const {
+    return mNodeCount;
+}
+
+template <typename V>
+const FrozenRadixNode& FrozenRadixTrie<V>::node(size_t index) const {
+    return mNodes[index];
+}
+
+template <typename V>
+std::string_view FrozenRadixTrie<V>::edge(size_t index) const {
+    return std::string_view(mPool + mNodes[index].edgeOffset, mNodes[index].edgeLength);
+}
+
+template <typename V>
+const V& FrozenRadixTrie<V>::value(size_t index) const {
+    return mValues[mNodes[index].rank];
+}
+
+// First terminal at or after index in preorder, nodeCount() if none.
+// Non-terminal nodes always have a child right after them, so this stops
+// within a few steps.
+template <typename V>
+size_t FrozenRadixTrie<V>::nextTerminal(size_t index) const {
+    while (index < mNodeCount && !mNodes[index].isTerminal()) {
+        ++index;
+    }
+    return index;
+}
+
+template <typename V>
+size_t FrozenRadixTrie<V>::rankBefore(size_t index) const {
+    return index < mNodeCount ? mNodes[index].rank : mSize;
+}
+
+// Child of index whose edge starts with byte, nodeCount() if none.
+template <typename V>
+size_t FrozenRadixTrie<V>::child(size_t index, unsigned char byte) const {
+    const auto &node = mNodes[index];
+    auto bytes = reinterpret_cast<const char *>(mChildBytes + node.children);
+    size_t pos = simd::findByte(bytes, node.childCount, static_cast<char>(byte));
+    return pos == node.childCount ? mNodeCount : mChildNodes[node.children + pos];
+}
+
+template <typename V>
+auto FrozenRadixTrie<V>::find(const key_view &key) const -> iterator {
+    if (mNodeCount == 0) {
+        return end();
+    }
+    size_t index = 0;
+    size_t depth = 0;
+    while (depth < key.size()) {
+        index = child(index, radixByte(key, depth));
+        if (index == mNodeCount) {
+            return end();
+        }
+        auto label = edge(index);
+        auto rest = key.substr(depth);
+        if (rest.size() < label.size() || radixCommonPrefix(label, rest) != label.size()) {
+            return end();
+        }
+        depth += label.size();
+    }
+    return mNodes[index].isTerminal() ? iterator(this, index, std::string(key)) : end();
+}
+
+template <typename V>
+auto FrozenRadixTrie<V>::find(const char *key) const -> iterator {
+    return find(key_view(key));
+}
+
+template <typename V>
+auto FrozenRadixTrie<V>::begin() const -> iterator {
+    return at(nextTerminal(0));
+}
+
+template <typename V>
+auto FrozenRadixTrie<V>::end() const -> iterator {
+    return iterator(this, mNodeCount, std::string());
+}
+
+// Iterator at node index; the key is rebuilt by descending from the root
+// through the children whose preorder ranges contain index.
+template <typename V>
+auto FrozenRadixTrie<V>::at(size_t index) const -> iterator {
+    if (index >= mNodeCount) {
+        return end();
+    }
+    std::string key;
+    size_t current = 0;
+    while (current != index) {
+        const auto &node = mNodes[current];
+        auto first = mChildNodes + node.children;
+        auto last = first + node.childCount;
+        current = *(std::upper_bound(first, last, static_cast<uint32_t>(index)) - 1);
+        key.append(edge(current));
+    }
+    return iterator(this, index, std::move(key));
+}
+
+// Topmost node whose path starts with prefix, nodeCount() if no key does.
+template <typename V>
+size_t FrozenRadixTrie<V>::locatePrefix(const key_view &prefix) const {
+    if (mNodeCount == 0) {
+        return 0;
+    }
+    size_t index = 0;
+    size_t depth = 0;
+    while (depth < prefix.size()) {
+        index = child(index, radixByte(prefix, depth));
+        if (index == mNodeCount) {
+            return index;
+        }
+        auto label = edge(index);
+        auto rest = prefix.substr(depth);
+        if (radixCommonPrefix(label, rest) < std::min(label.size(), rest.size())) {
+            return mNodeCount;
+        }
+        depth += label.size();
+    }
+    return index;
+}
+
+template <typename V>
+auto FrozenRadixTrie<V>::prefixMatch(const key_view &prefix) const -> RadixRange<iterator> {
+    size_t index = locatePrefix(prefix);
+    if (index == mNodeCount) {
+        return RadixRange<iterator>(end(), end());
+    }
+    return RadixRange<iterator>(at(nextTerminal(index)), at(nextTerminal(mNodes[index].end)));
+}
+
+template <typename V>
+auto FrozenRadixTrie<V>::prefixMatch(const key_view &prefix, size_type limit) const -> std::vector<iterator> {
+    std::vector<iterator> result;
+    auto range = prefixMatch(prefix);
+    for (auto it = range.begin(); it != range.end() && result.size() < limit; ++it) {
+        result.push_back(it);
+    }
+    return result;
+}
+
+// Terminal ranks grow in preorder, so the keys below a node are counted by
+// two rank lookups.
+template <typename V>
+auto FrozenRadixTrie<V>::count_prefix(const key_view &prefix) const -> size_type {
+    size_t index = locatePrefix(prefix);
+    if (index == mNodeCount) {
+        return 0;
+    }
+    return rankBefore(mNodes[index].end) - mNodes[index].rank;
+}
+
+// Checks every node against the sections and the preorder layout in one
+// pass, so that no query reads outside the snapshot or loops: edges lie in
+// the pool and start with their child byte, children follow their parent
+// and each other subtree by subtree, and ranks count the terminals before
+// each node. Throws std::runtime_error naming the first bad node.
+template <typename V>
+void FrozenRadixTrie<V>::verify() const {
+    auto fail = [](size_t index) {
+        throw std::runtime_error("frozen trie: corrupt node " + std::to_string(index));
+    };
+    size_t rank = 0;
+    for (size_t i = 0; i < mNodeCount; ++i) {
+        const auto &node = mNodes[i];
+        if (node.edgeOffset > mPoolSize || node.edgeLength > mPoolSize - node.edgeOffset ||
+                node.children > mChildCount || node.childCount > mChildCount - node.children ||
+                node.end <= i || node.end > mNodeCount || node.rank != rank ||
+                (node.isTerminal() && rank >= mSize) || (node.empty() && node.end != i + 1)) {
+            fail(i);
+        }
+        size_t next = i + 1;
+        for (size_t j = 0; j < node.childCount; ++j) {
+            size_t index = mChildNodes[node.children + j];
+            if (index != next || index >= node.end) {
+                fail(i);
+            }
+            const auto &child = mNodes[index];
+            if (child.edgeOffset >= mPoolSize || child.edgeLength == 0 ||
+                    static_cast<unsigned char>(mPool[child.edgeOffset]) != mChildBytes[node.children + j] ||
+                    child.nodeDepth != static_cast<uint64_t>(node.nodeDepth) + node.edgeLength) {
+                fail(index);
+            }
+            next = child.end;
+        }
+        if (!node.empty() && next != node.end) {
+            fail(i);
+        }
+        rank += node.isTerminal();
+    }
+    if (rank != mSize || mNodes[0].end != mNodeCount) {
+        fail(0);
+    }
+}
+
+template <typename V>
+void FrozenRadixTrie<V>::dump(std::ostream &out) const {
+    if (mNodeCount != 0) {
+        dump(0, out, std::string(), true);
+    }
+}
+
+template <typename V>
+void FrozenRadixTrie<V>::dump(size_t index, std::ostream &out, const std::string &prefix, bool last) const {
+    std::string pref = prefix;
+    if (index != 0) {
+        pref += last ? "  " : "| ";
+        out << prefix << "+ ";
+    }
+    out << edge(index);
+    if (mNodes[index].isTerminal()) {
+        out << "$";
+    }
+    out << "\n";
+
+    const auto &node = mNodes[index];
+    for (size_t i = 0; i < node.childCount; ++i) {
+        dump(mChildNodes[node.children + i], out, pref, i + 1 == node.childCount);
+    }
+}
+
+} // namespace Patricia
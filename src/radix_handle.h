@@ -0,0 +1,118 @@
+#pragma once
+#include <memory>
+#include <utility>
+
+namespace Patricia {
+
+template <typename K, typename V, typename C, typename A, typename G> class RadixTrie;
+
+// Allocator that the pairs of outstanding node handles live in: the trie's
+// own while it lives. clear() and the destructor of a trie with handles
+// still out merge its blocks into orphaned, so the handles stay valid and
+// the memory goes with the last of them.
+template <typename A>
+struct RadixHandleSource {
+    A *alloc;
+    A orphaned;
+};
+
+// Owns one key/value pair taken out of a RadixTrie by extract(), like the
+// node handles of std::map. The pair stays in the allocator of the trie it
+// came from, which the handle keeps alive: reinserting into that trie reuses
+// the pair as is, as does any trie whose policy can take over single blocks
+// (RadixHeap). Arena tries move the pair into their own slabs.
+template <typename K, typename V, typename A>
+class RadixNodeHandle {
+public:
+    using key_type = K;
+    using mapped_type = V;
+    using value_type = std::pair<const K, V>;
+    using allocator_type = A;
+
+    RadixNodeHandle();
+    RadixNodeHandle(RadixNodeHandle &&other) noexcept;
+    RadixNodeHandle& operator=(RadixNodeHandle &&other) noexcept;
+    ~RadixNodeHandle();
+
+    bool empty() const;
+    explicit operator bool() const;
+    const key_type& key() const;
+    mapped_type& mapped() const;
+    value_type& value() const;
+private:
+    template <typename K_, typename V_, typename C_, typename A_, typename G_>
+    friend class RadixTrie;
+    RadixNodeHandle(value_type *value, std::shared_ptr<RadixHandleSource<A>> source);
+    RadixNodeHandle(const RadixNodeHandle &) = delete;
+    RadixNodeHandle& operator=(const RadixNodeHandle &) = delete;
+    void reset();
+private:
+    value_type *mValue;
+    std::shared_ptr<RadixHandleSource<A>> mSource;
+};
+
+template <typename K, typename V, typename A>
+RadixNodeHandle<K, V, A>::RadixNodeHandle()
+    : mValue(nullptr),
+    mSource() { }
+
+template <typename K, typename V, typename A>
+RadixNodeHandle<K, V, A>::RadixNodeHandle(value_type *value, std::shared_ptr<RadixHandleSource<A>> source)
+    : mValue(value),
+    mSource(std::move(source)) { }
+
+template <typename K, typename V, typename A>
+RadixNodeHandle<K, V, A>::RadixNodeHandle(RadixNodeHandle &&other) noexcept
+    : mValue(std::exchange(other.mValue, nullptr)),
+    mSource(std::move(other.mSource)) { }
+
+template <typename K, typename V, typename A>
+RadixNodeHandle<K, V, A>& RadixNodeHandle<K, V, A>::operator=(RadixNodeHandle &&other) noexcept {
+    if (this != &other) {
+        reset();
+        mValue = std::exchange(other.mValue, nullptr);
+        mSource = std::move(other.mSource);
+    }
+    return *this;
+}
+
+template <typename K, typename V, typename A>
+RadixNodeHandle<K, V, A>::~RadixNodeHandle() {
+    reset();
+}
+
+template <typename K, typename V, typename A>
+void RadixNodeHandle<K, V, A>::reset() {
+    if (mValue != nullptr) {
+        mSource->alloc->destroy(mValue);
+        mValue = nullptr;
+    }
+    mSource.reset();
+}
+
+template <typename K, typename V, typename A>
+bool RadixNodeHandle<K, V, A>::empty() const {
+    return mValue == nullptr;
+}
+
+template <typename K, typename V, typename A>
+RadixNodeHandle<K, V, A>::operator bool() const {
+    return mValue != nullptr;
+}
+
+template <typename K, typename V, typename A>
+auto RadixNodeHandle<K, V, A>::key() const -> const key_type& {
+    return mValue->first;
+}
+
+template <typename K, typename V, typename A>
+auto RadixNodeHandle<K, V, A>::mapped() const -> mapped_type& {
+    return mValue->second;
+}
+
+template <typename K, typename V, typename A>
+auto RadixNodeHandle<K, V, A>::value() const -> value_type& {
+    return *mValue;
+}
+
+} // namespace Patricia
@@ -1,14 +1,35 @@
 #pragma once
 #include <string>
+#include <string_view>
+#include "radix_simd.h"
 
 namespace Patricia {
 
+// Non-owning counterpart of a key type, used on the lookup path so that
+// slicing a key never allocates.
+template <typename T>
+struct RadixView {
+    using type = T;
+};
+template <>
+struct RadixView<std::string> {
+    using type = std::string_view;
+};
+template <>
+struct RadixView<std::string_view> {
+    using type = std::string_view;
+};
+
 template <typename T>
 T radixSubstr(const T &value, size_t begin, size_t num);
 template <>
 inline std::string radixSubstr(const std::string &value, size_t begin, size_t num) {
     return value.substr(begin, num);
 }
+template <>
+inline std::string_view radixSubstr(const std::string_view &value, size_t begin, size_t num) {
+    return value.substr(begin, num);
+}
 
 template <typename T>
 T radixJoin(const T &value1, const T &value2);
@@ -20,8 +41,51 @@ inline std::string radixJoin(const std::string &value1, const std::string &value
 template <typename T>
 size_t radixSize(const T &value);
 template <>
-size_t radixSize(const std::string &value) {
+inline size_t radixSize(const std::string &value) {
+    return value.size();
+}
+template <>
+inline size_t radixSize(const std::string_view &value) {
     return value.size();
 }
 
+template <typename T>
+unsigned char radixByte(const T &value, size_t pos);
+template <>
+inline unsigned char radixByte(const std::string &value, size_t pos) {
+    return static_cast<unsigned char>(value[pos]);
+}
+template <>
+inline unsigned char radixByte(const std::string_view &value, size_t pos) {
+    return static_cast<unsigned char>(value[pos]);
+}
+
+template <typename T>
+typename RadixView<T>::type radixSlice(const T &value, size_t begin, size_t num);
+template <>
+inline std::string_view radixSlice(const std::string &value, size_t begin, size_t num) {
+    return std::string_view(value).substr(begin, num);
+}
+template <>
+inline std::string_view radixSlice(const std::string_view &value, size_t begin, size_t num) {
+    return value.substr(begin, num);
+}
+
+// Length of the longest common prefix of two views.
+template <typename T>
+size_t radixCommonPrefix(const T &value1, const T &value2);
+template <>
+inline size_t radixCommonPrefix(const std::string_view &value1, const std::string_view &value2) {
+    size_t size = value1.size() < value2.size() ? value1.size() : value2.size();
+    return simd::mismatch(value1.data(), value2.data(), size);
+}
+
+// Three way byte order comparison of two views.
+template <typename T>
+int radixCompare(const T &value1, const T &value2);
+template <>
+inline int radixCompare(const std::string_view &value1, const std::string_view &value2) {
+    return value1.compare(value2);
+}
+
 } // namespace Patricia
@@ -2,88 +2,187 @@
 
 #include <iterator>
 #include <functional>
+#include <cstddef>
+#include "radix_augment.h"
 
 namespace Patricia {
-template <typename K, typename V, class C = std::less<K> > class RadixNode;
+template <typename K, typename V, class C = std::less<K>, class G = RadixNoAugment> class RadixNode;
 
-template <typename K, typename V, class C = std::less<K> >
-class RadixIter : public std::iterator<std::forward_iterator_tag, std::pair<K, V>> {
-    using value_type = typename RadixNode<K, V, C>::value_type;
+// Bidirectional iterator over terminal nodes in key order. Stepping follows
+// parent pointers and sibling lookups in the child index, so a full scan
+// touches every edge twice and never recurses. The root is kept so that
+// end() can be decremented.
+template <typename K, typename V, class C = std::less<K>, class G = RadixNoAugment>
+class RadixIter {
 public:
+    using iterator_category = std::bidirectional_iterator_tag;
+    using value_type = typename RadixNode<K, V, C, G>::value_type;
+    using difference_type = std::ptrdiff_t;
+    using pointer = value_type*;
+    using reference = value_type&;
+
     RadixIter();
-    RadixIter(RadixNode<K, V, C> *node);
+    RadixIter(RadixNode<K, V, C, G> *node);
+    RadixIter(RadixNode<K, V, C, G> *node, RadixNode<K, V, C, G> *root);
     RadixIter(const RadixIter &it);
     RadixIter &operator=(const RadixIter &it);
     ~RadixIter() = default;
 
     value_type& operator*() const;
     value_type* operator->() const;
-    const RadixIter<K, V, C>& operator++(); // prefix
-    RadixIter<K, V, C>& operator++(int); // postfix
-    bool operator!=(const RadixIter<K, V, C> &other) const;
-    bool operator==(const RadixIter<K, V, C> &other) const;
-    RadixNode<K, V, C> *node();
+    RadixIter<K, V, C, G>& operator++(); // prefix
+    RadixIter<K, V, C, G> operator++(int); // postfix
+    RadixIter<K, V, C, G>& operator--(); // prefix
+    RadixIter<K, V, C, G> operator--(int); // postfix
+    RadixIter<K, V, C, G>& advance(difference_type n);
+    bool operator!=(const RadixIter<K, V, C, G> &other) const;
+    bool operator==(const RadixIter<K, V, C, G> &other) const;
+    RadixNode<K, V, C, G> *node() const;
 private:
-    RadixNode<K, V, C> *mPointed;
+    RadixNode<K, V, C, G> *mPointed;
+    RadixNode<K, V, C, G> *mRoot;
 };
 
-template <typename K, typename V, class C>
-RadixIter<K, V, C>::RadixIter()
-    : mPointed(nullptr)
+template <typename K, typename V, class C, class G>
+RadixIter<K, V, C, G>::RadixIter()
+    : mPointed(nullptr),
+    mRoot(nullptr)
 { }
 
-template <typename K, typename V, class C>
-RadixIter<K, V, C>::RadixIter(const RadixIter &it)
-    : mPointed(it.mPointed)
+template <typename K, typename V, class C, class G>
+RadixIter<K, V, C, G>::RadixIter(const RadixIter &it)
+    : mPointed(it.mPointed),
+    mRoot(it.mRoot)
 { }
 
-template <typename K, typename V, class C>
-RadixIter<K, V, C>& RadixIter<K, V, C>::operator=(const RadixIter &it) {
-    mPointed = it.mPoined;
+template <typename K, typename V, class C, class G>
+RadixIter<K, V, C, G>& RadixIter<K, V, C, G>::operator=(const RadixIter &it) {
+    mPointed = it.mPointed;
+    mRoot = it.mRoot;
+    return *this;
 }
 
-template <typename K, typename V, class C>
-RadixIter<K, V, C>::RadixIter(RadixNode<K, V, C> *node)
-    : mPointed(node)
+template <typename K, typename V, class C, class G>
+RadixIter<K, V, C, G>::RadixIter(RadixNode<K, V, C, G> *node)
+    : mPointed(node),
+    mRoot(nullptr)
+{ }
+
+template <typename K, typename V, class C, class G>
+RadixIter<K, V, C, G>::RadixIter(RadixNode<K, V, C, G> *node, RadixNode<K, V, C, G> *root)
+    : mPointed(node),
+    mRoot(root)
 { }
 
-template <typename K, typename V, class C>
-auto RadixIter<K, V, C>::operator*() const -> value_type& {
+template <typename K, typename V, class C, class G>
+auto RadixIter<K, V, C, G>::operator*() const -> value_type& {
     return mPointed->value();
 }
 
-template <typename K, typename V, class C>
-auto RadixIter<K, V, C>::operator->() const -> value_type* {
+template <typename K, typename V, class C, class G>
+auto RadixIter<K, V, C, G>::operator->() const -> value_type* {
     return mPointed->valuePtr();
 }
 
-template <typename K, typename V, class C>
-const RadixIter<K, V, C>& RadixIter<K, V, C>::operator++() { // prefix
+template <typename K, typename V, class C, class G>
+RadixIter<K, V, C, G>& RadixIter<K, V, C, G>::operator++() { // prefix
     if (mPointed != nullptr) {
-        mPointed = ascend(mPointed);
+        mPointed = successor(mPointed);
     }
     return *this;
 }
 
-template <typename K, typename V, class C>
-RadixIter<K, V, C>& RadixIter<K, V, C>::operator++(int) { // postfix
-    RadixIter<K, V, C> copy(*this);
+template <typename K, typename V, class C, class G>
+RadixIter<K, V, C, G> RadixIter<K, V, C, G>::operator++(int) { // postfix
+    RadixIter<K, V, C, G> copy(*this);
     ++(*this);
     return copy;
 }
 
-template <typename K, typename V, class C>
-RadixNode<K, V, C>* RadixIter<K, V, C>::node() {
+template <typename K, typename V, class C, class G>
+RadixIter<K, V, C, G>& RadixIter<K, V, C, G>::operator--() { // prefix
+    if (mPointed != nullptr) {
+        mPointed = predecessor(mPointed);
+    } else if (mRoot != nullptr) {
+        mPointed = rightmost(mRoot);
+    }
+    return *this;
+}
+
+template <typename K, typename V, class C, class G>
+RadixIter<K, V, C, G> RadixIter<K, V, C, G>::operator--(int) { // postfix
+    RadixIter<K, V, C, G> copy(*this);
+    --(*this);
+    return copy;
+}
+
+// Moves n keys forward, or back for negative n. With subtree counts and a
+// known root this is rankOf() and selectNode(), O(depth * fan-out) with up
+// to 256 children summed per level of a direct table; otherwise it steps.
+template <typename K, typename V, class C, class G>
+RadixIter<K, V, C, G>& RadixIter<K, V, C, G>::advance(difference_type n) {
+    if constexpr (RadixCounted<G>::value) {
+        if (mRoot != nullptr) {
+            size_t index = mPointed != nullptr ? rankOf(mPointed) : mRoot->augment().count;
+            mPointed = selectNode(mRoot, index + n);
+            return *this;
+        }
+    }
+    for (; n > 0; --n) {
+        ++(*this);
+    }
+    for (; n < 0; ++n) {
+        --(*this);
+    }
+    return *this;
+}
+
+template <typename K, typename V, class C, class G>
+RadixNode<K, V, C, G>* RadixIter<K, V, C, G>::node() const {
     return mPointed;
 }
 
-template <typename K, typename V, class C>
-bool RadixIter<K, V, C>::operator!=(const RadixIter<K, V, C> &other) const {
+template <typename K, typename V, class C, class G>
+bool RadixIter<K, V, C, G>::operator!=(const RadixIter<K, V, C, G> &other) const {
     return mPointed != other.mPointed;
 }
 
-template <typename K, typename V, class C>
-bool RadixIter<K, V, C>::operator==(const RadixIter<K, V, C> &other) const {
+template <typename K, typename V, class C, class G>
+bool RadixIter<K, V, C, G>::operator==(const RadixIter<K, V, C, G> &other) const {
     return mPointed == other.mPointed;
 }
+
+// Lazy [begin, end) pair of iterators, e.g. the keys sharing a prefix.
+template <typename I>
+class RadixRange {
+public:
+    RadixRange(I first, I last);
+    I begin() const;
+    I end() const;
+    bool empty() const;
+private:
+    I mBegin;
+    I mEnd;
+};
+
+template <typename I>
+RadixRange<I>::RadixRange(I first, I last)
+    : mBegin(first),
+    mEnd(last)
+{ }
+
+template <typename I>
+I RadixRange<I>::begin() const {
+    return mBegin;
+}
+
+template <typename I>
+I RadixRange<I>::end() const {
+    return mEnd;
+}
+
+template <typename I>
+bool RadixRange<I>::empty() const {
+    return mBegin == mEnd;
+}
 }
@@ -1,326 +1,536 @@
 #pragma once
 #include <stdexcept>
-#include <map>
 #include <functional>
+#include <utility>
+#include <vector>
 #include "radix_helpers.h"
+#include "radix_children.h"
 
 namespace Patricia {
 
-template <typename K, typename V, class C> class RadixNode;
+template <typename K, typename V, class C, class G> class RadixNode;
 
-template <typename K, typename V, typename C>
-RadixNode<K, V, C>* ascend(RadixNode<K, V, C> *node);
+template <typename K, typename V, typename C, typename G>
+RadixNode<K, V, C, G>* ascend(RadixNode<K, V, C, G> *node);
 
-template <typename K, typename V, typename C>
-RadixNode<K, V, C>* descend(RadixNode<K, V, C> *node);
+template <typename K, typename V, typename C, typename G>
+RadixNode<K, V, C, G>* descend(RadixNode<K, V, C, G> *node);
 
-template <typename K, typename V, class C>
-RadixNode<K, V, C>* begin(RadixNode<K, V, C> *node);
+template <typename K, typename V, class C, class G>
+RadixNode<K, V, C, G>* begin(RadixNode<K, V, C, G> *node);
 
-template <typename K, typename V, class C>
-RadixNode<K, V, C>* findNode(const K &key, RadixNode<K, V, C> *node, size_t depth);
+template <typename K, typename V, class C, class G>
+RadixNode<K, V, C, G>* rightmost(RadixNode<K, V, C, G> *node);
 
-template <typename K, typename V, class C>
-RadixNode<K, V, C>* append(RadixNode<K, V, C> *node, const typename RadixNode<K, V, C>::value_type &value);
+template <typename K, typename V, class C, class G>
+RadixNode<K, V, C, G>* successor(RadixNode<K, V, C, G> *node);
 
-template <typename K, typename V, class C>
-RadixNode<K, V, C>* prepend(RadixNode<K, V, C> *node, const typename RadixNode<K, V, C>::value_type &value);
+template <typename K, typename V, class C, class G>
+RadixNode<K, V, C, G>* predecessor(RadixNode<K, V, C, G> *node);
 
-template <typename K, typename V, typename C>
-class RadixNode {
+template <typename K, typename V, class C, class G>
+RadixNode<K, V, C, G>* findNode(const typename RadixView<K>::type &key, RadixNode<K, V, C, G> *node, size_t depth);
+
+template <typename K, typename V, class C, class G, class A>
+RadixNode<K, V, C, G>* append(RadixNode<K, V, C, G> *node, typename RadixNode<K, V, C, G>::value_type *value, A &alloc);
+
+template <typename K, typename V, class C, class G, class A>
+RadixNode<K, V, C, G>* prepend(RadixNode<K, V, C, G> *node, typename RadixNode<K, V, C, G>::value_type *value, A &alloc);
+
+template <typename K, typename V, class C, class G, class A>
+RadixNode<K, V, C, G>* compress(RadixNode<K, V, C, G> *node, A &alloc);
+
+template <typename K, typename V, class C, class G, class A>
+RadixNode<K, V, C, G>* createNode(typename RadixNode<K, V, C, G>::value_type *value, A &alloc);
+
+template <typename K, typename V, class C, class G, class A>
+size_t destroy(RadixNode<K, V, C, G> *node, A &alloc, bool reclaim = true);
+
+template <typename K, typename V, class C, class G>
+void augmentAdded(RadixNode<K, V, C, G> *node, const typename RadixNode<K, V, C, G>::value_type &value);
+
+template <typename K, typename V, class C, class G>
+void augmentRefresh(RadixNode<K, V, C, G> *node);
+
+template <typename K, typename V, class C, class G>
+size_t rankOf(RadixNode<K, V, C, G> *node);
+
+template <typename K, typename V, class C, class G>
+RadixNode<K, V, C, G>* selectNode(RadixNode<K, V, C, G> *node, size_t index);
+
+// Node of a path-compressed trie. mKey holds the edge leading into the node,
+// mDepth the length of the path above that edge. A node stores a key exactly
+// when mValue is set; every other node has at least two children. The data
+// of the augmentation policy G is an empty base unless G is enabled.
+template <typename K, typename V, typename C, typename G>
+class RadixNode : private G::data {
 public:
     using value_type = std::pair<const K, V>;
-    using children_type = std::map<K, RadixNode<K, V, C> *, C>;
+    using augment_type = typename G::data;
+    using children_type = RadixChildren<RadixNode<K, V, C, G>>;
+    using key_view = typename RadixView<K>::type;
 
-    explicit RadixNode(C &predicate);
-    RadixNode(const value_type &value, C &predicate);
-    ~RadixNode();
+    RadixNode();
+    explicit RadixNode(value_type *value);
+    ~RadixNode() = default;
     K& key();
     void setKey(const K &key);
     value_type& value() const;
     value_type* valuePtr() const;
-    bool isLeaf() const;
+    void setValue(value_type *value);
+    bool isTerminal() const;
     size_t depth() const;
     void setDepth(size_t depth);
     RadixNode* parent();
     void setParent(RadixNode *node);
-    void erase(const K &key);
+    template <class A>
+    void erase(const K &key, A &alloc);
     size_t size() const;
     bool empty() const;
     const children_type& children() const;
-    void setChild(const K &key, RadixNode *node);
-
-    template <typename K_, typename V_, class C_>
-    friend RadixNode<K_, V_, C_>* ascend(RadixNode<K_, V_, C_> *node);
-    template <typename K_, typename V_, class C_>
-    friend RadixNode<K_, V_, C_>* descend(RadixNode<K_, V_, C_> *node);
-
-    template <typename K_, typename V_, class C_>
-    friend RadixNode<K_, V_, C_>* begin(RadixNode<K_, V_, C_> *node);
-    template <typename K_, typename V_, class C_>
-    friend RadixNode<K_, V_, C_>* findNode(const K_ &key, RadixNode<K_, V_, C_> *node, size_t depth);
-    template <typename K_, typename V_, class C_>
-    friend RadixNode<K_, V_, C_>* append(RadixNode<K_, V_, C_> *node, const typename RadixNode<K_, V_, C_>::value_type &value);
-    template <typename K_, typename V_, class C_>
-    friend RadixNode<K_, V_, C_>* prepend(RadixNode<K_, V_, C_> *node, const typename RadixNode<K_, V_, C_>::value_type &value);
+    template <class A>
+    void setChild(const K &key, RadixNode *node, A &alloc);
+    RadixNode* firstChild() const;
+    RadixNode* lastChild() const;
+    augment_type& augment();
+    const augment_type& augment() const;
+
+    template <typename K_, typename V_, class C_, class G_>
+    friend RadixNode<K_, V_, C_, G_>* ascend(RadixNode<K_, V_, C_, G_> *node);
+    template <typename K_, typename V_, class C_, class G_>
+    friend RadixNode<K_, V_, C_, G_>* descend(RadixNode<K_, V_, C_, G_> *node);
+
+    template <typename K_, typename V_, class C_, class G_>
+    friend RadixNode<K_, V_, C_, G_>* begin(RadixNode<K_, V_, C_, G_> *node);
+    template <typename K_, typename V_, class C_, class G_>
+    friend RadixNode<K_, V_, C_, G_>* findNode(const typename RadixView<K_>::type &key, RadixNode<K_, V_, C_, G_> *node, size_t depth);
+    template <typename K_, typename V_, class C_, class G_, class A_>
+    friend RadixNode<K_, V_, C_, G_>* append(RadixNode<K_, V_, C_, G_> *node, typename RadixNode<K_, V_, C_, G_>::value_type *value, A_ &alloc);
+    template <typename K_, typename V_, class C_, class G_, class A_>
+    friend RadixNode<K_, V_, C_, G_>* prepend(RadixNode<K_, V_, C_, G_> *node, typename RadixNode<K_, V_, C_, G_>::value_type *value, A_ &alloc);
+    template <typename K_, typename V_, class C_, class G_, class A_>
+    friend RadixNode<K_, V_, C_, G_>* compress(RadixNode<K_, V_, C_, G_> *node, A_ &alloc);
+    template <typename K_, typename V_, class C_, class G_, class A_>
+    friend size_t destroy(RadixNode<K_, V_, C_, G_> *node, A_ &alloc, bool reclaim);
 private:
     RadixNode(const RadixNode &) = delete;
     RadixNode& operator=(const RadixNode &) = delete;
 private:
     children_type mChildren;
-    RadixNode<K, V, C> *mParent;
+    RadixNode<K, V, C, G> *mParent;
     K mKey;
     value_type *mValue;
-    C &mPredicate;
     size_t mDepth;
-    bool mIsLeaf;
 };
 
-template <typename K, typename V, typename C>
-RadixNode<K, V, C>::RadixNode(C &predicate) 
-    : mChildren(std::map<K,
-                RadixNode<K, V, C>*,
-                C>(predicate)),
+template <typename K, typename V, typename C, typename G>
+RadixNode<K, V, C, G>::RadixNode()
+    : mChildren(),
     mParent(nullptr),
     mKey(),
     mValue(nullptr),
-    mPredicate(predicate),
-    mDepth(0),
-    mIsLeaf(false) { }
-
-template <typename K, typename V, typename C>
-RadixNode<K, V, C>::RadixNode(const value_type &value, C &predicate) 
-    : mChildren(std::map<K,
-                RadixNode<K, V, C>*,
-                C>(predicate)),
+    mDepth(0) { }
+
+template <typename K, typename V, typename C, typename G>
+RadixNode<K, V, C, G>::RadixNode(value_type *value)
+    : mChildren(),
     mParent(nullptr),
     mKey(),
-    mValue(new value_type(value)),
-    mPredicate(predicate),
-    mDepth(0),
-    mIsLeaf(false) { }
+    mValue(value),
+    mDepth(0) { }
 
+// Creates a node owning value, which must come from the same allocator.
+template <typename K, typename V, class C, class G, class A>
+RadixNode<K, V, C, G>* createNode(typename RadixNode<K, V, C, G>::value_type *value, A &alloc) {
+    return alloc.template create<RadixNode<K, V, C, G>>(value);
+}
 
-template <typename K, typename V, typename C>
-RadixNode<K, V, C>::~RadixNode() {
-    for (auto it = mChildren.begin(); it != mChildren.end(); ++it) {
-        delete it->second;
+// Frees the whole subtree under node without recursion. With reclaim unset
+// only destructors run, the memory itself is left for a bulk release().
+// Returns the number of values the subtree held.
+template <typename K, typename V, class C, class G, class A>
+size_t destroy(RadixNode<K, V, C, G> *node, A &alloc, bool reclaim) {
+    using value_type = typename RadixNode<K, V, C, G>::value_type;
+    if (node == nullptr) {
+        return 0;
     }
-    if (mValue != nullptr) {
-        delete mValue;
+    size_t count = 0;
+    std::vector<RadixNode<K, V, C, G> *> pending{node};
+    while (!pending.empty()) {
+        auto current = pending.back();
+        pending.pop_back();
+        for (auto child : current->mChildren) {
+            pending.push_back(child);
+        }
+        count += current->mValue != nullptr;
+        if (reclaim) {
+            current->mChildren.release(alloc);
+            alloc.destroy(current->mValue);
+            alloc.destroy(current);
+        } else {
+            if (current->mValue != nullptr) {
+                current->mValue->~value_type();
+            }
+            current->~RadixNode();
+        }
     }
+    return count;
 }
 
-template <typename K, typename V, typename C>
-auto RadixNode<K, V, C>::value() const -> value_type& {
+template <typename K, typename V, typename C, typename G>
+auto RadixNode<K, V, C, G>::value() const -> value_type& {
     return *mValue;
 }
 
-template <typename K, typename V, typename C>
-auto RadixNode<K, V, C>::valuePtr() const -> value_type* {
+template <typename K, typename V, typename C, typename G>
+auto RadixNode<K, V, C, G>::valuePtr() const -> value_type* {
     return mValue;
 }
 
-template <typename K, typename V, class C>
-RadixNode<K, V, C>* ascend(RadixNode<K, V, C> *node) {
-    if (node->mParent == nullptr) {
-        return nullptr;
-    }
-    auto it = node->mParent->mChildren.find(node->mKey);
-    if (it == node->mParent->mChildren.end()) {
-        throw std::out_of_range("Calling method ascend with externall node");
-    }
-    ++it;
-    if (it == node->mParent->mChildren.end()) {
-        return ascend(node->mParent);
-    } else {
-        return descend(it->second);
-    }
+template <typename K, typename V, typename C, typename G>
+void RadixNode<K, V, C, G>::setValue(value_type *value) {
+    mValue = value;
+}
 
+// Next terminal node after the whole subtree of node.
+template <typename K, typename V, class C, class G>
+RadixNode<K, V, C, G>* ascend(RadixNode<K, V, C, G> *node) {
+    for (auto parent = node->mParent; parent != nullptr; node = parent, parent = parent->mParent) {
+        if (auto next = parent->mChildren.next(radixByte(node->mKey, 0)); next != nullptr) {
+            return descend(next);
+        }
+    }
+    return nullptr;
 }
-template <typename K, typename V, class C>
-RadixNode<K, V, C>* descend(RadixNode<K, V, C> *node) {
-    if (node->mIsLeaf) {
-        return node;
+
+// First terminal node of the subtree of node.
+template <typename K, typename V, class C, class G>
+RadixNode<K, V, C, G>* descend(RadixNode<K, V, C, G> *node) {
+    while (!node->isTerminal()) {
+        node = node->mChildren.first();
+        if (node == nullptr) {
+            throw std::length_error("Node doesn't store any child");
+        }
     }
-    auto it = node->mChildren.begin();
-    if (it == node->mChildren.end()) {
+    return node;
+}
+
+template <typename K, typename V, class C, class G>
+RadixNode<K, V, C, G>* begin(RadixNode<K, V, C, G> *node) {
+    if (!node->isTerminal() && node->empty()) {
         throw std::length_error("Node doesn't store any child");
     }
-    return descend(it->second);
+    return descend(node);
 }
 
-template <typename K, typename V, class C>
-RadixNode<K, V, C>* begin(RadixNode<K, V, C> *node) {
-    if (node->mIsLeaf) {
-        return node;
+// Last terminal node of the subtree of node, or nullptr for an empty root.
+template <typename K, typename V, class C, class G>
+RadixNode<K, V, C, G>* rightmost(RadixNode<K, V, C, G> *node) {
+    while (!node->empty()) {
+        node = node->lastChild();
     }
-    if (node->mChildren.empty()) {
-        throw std::length_error("Node doesn't store any child");
+    return node->isTerminal() ? node : nullptr;
+}
+
+// Terminal node following node in key order.
+template <typename K, typename V, class C, class G>
+RadixNode<K, V, C, G>* successor(RadixNode<K, V, C, G> *node) {
+    if (!node->empty()) {
+        return descend(node->firstChild());
     }
-    return begin(node->mChildren.begin()->second);
+    return ascend(node);
 }
 
-template <typename K, typename V, class C>
-RadixNode<K, V, C>* findNode(const K &key, RadixNode<K, V, C> *node, size_t depth) {
-    if (node->mChildren.empty()) {
-        return node;
+// Terminal node preceding node in key order.
+template <typename K, typename V, class C, class G>
+RadixNode<K, V, C, G>* predecessor(RadixNode<K, V, C, G> *node) {
+    for (auto parent = node->parent(); parent != nullptr; node = parent, parent = parent->parent()) {
+        if (auto prev = parent->children().prev(radixByte(node->key(), 0)); prev != nullptr) {
+            return rightmost(prev);
+        }
+        if (parent->isTerminal()) {
+            return parent;
+        }
     }
-    size_t size = radixSize(key) - depth;
-    for (auto it = node->mChildren.begin(); it != node->mChildren.end(); ++it) {
-        if (size == 0) {
-            if (it->second->mIsLeaf) {
-                return it->second;
-            } else {
-                continue;
-            }
+    return nullptr;
+}
+
+// Deepest node whose whole path is a prefix of key. depth is the length of
+// the path matched so far, including the edge of node.
+template <typename K, typename V, class C, class G>
+RadixNode<K, V, C, G>* findNode(const typename RadixView<K>::type &key, RadixNode<K, V, C, G> *node, size_t depth) {
+    size_t size = radixSize(key);
+    while (depth < size) {
+        auto child = node->mChildren.find(radixByte(key, depth));
+        if (child == nullptr) {
+            return node;
         }
-        if (!it->second->mIsLeaf && key[depth] == it->first[0]) {
-            size_t childSize = radixSize(it->first);
-            K childKey = radixSubstr(key, depth, childSize);
-            if (childKey == it->first) {
-                return findNode(key, it->second, depth + childSize);
-            } else {
-                return it->second;
-            }
+        size_t childSize = radixSize(child->mKey);
+        if (depth + childSize > size ||
+                radixCommonPrefix(radixSlice(key, depth, childSize), radixSlice(child->mKey, 0, childSize)) != childSize) {
+            return node;
         }
+        node = child;
+        depth += childSize;
     }
     return node;
 }
 
-template <typename K, typename V, class C>
-RadixNode<K, V, C>* append(RadixNode<K, V, C> *node, const typename RadixNode<K, V, C>::value_type &value) {
-    auto defaultKey = radixSubstr(value.first, 0, 0);
+// Stores value under node, which must be fully matched by value->first:
+// either node itself takes the value or a new leaf is hung below it.
+template <typename K, typename V, class C, class G, class A>
+RadixNode<K, V, C, G>* append(RadixNode<K, V, C, G> *node, typename RadixNode<K, V, C, G>::value_type *value, A &alloc) {
     size_t depth = node->mDepth + radixSize(node->mKey);
-    size_t size = radixSize(value.first) - depth;
+    size_t size = radixSize(value->first) - depth;
 
-    auto newNode = new RadixNode<K, V, C>(value, node->mPredicate);
+    if (size == 0) {
+        node->mValue = value;
+        augmentAdded(node, *value);
+        return node;
+    }
+    auto newNode = createNode<K, V, C, G>(value, alloc);
     newNode->mParent = node;
     newNode->mDepth = depth;
-    if (size == 0) {
-        newNode->mKey = defaultKey;
-        newNode->mIsLeaf = true;
-        node->mChildren[defaultKey] = newNode;
-        return newNode;
+    try {
+        newNode->mKey = radixSubstr(value->first, depth, size);
+        node->mChildren.insert(radixByte(newNode->mKey, 0), newNode, alloc);
+    } catch (...) {
+        // the caller still owns value
+        newNode->mValue = nullptr;
+        alloc.destroy(newNode);
+        throw;
     }
-    auto newKey = radixSubstr(value.first, depth, size);
-    newNode->mKey = newKey;
-    node->mChildren[newKey] = newNode;
-
-    auto newChildNode = new RadixNode<K, V, C>(value, node->mPredicate);
-    newChildNode->mParent = newNode;
-    newChildNode->mDepth = depth + size;
-    newChildNode->mKey = defaultKey;
-    newChildNode->mIsLeaf = true;
-    newNode->mChildren[defaultKey] = newChildNode;
-    return newChildNode;
+    G::refresh(newNode);
+    augmentAdded(node, *value);
+    return newNode;
 }
 
-template <typename K, typename V, class C>
-RadixNode<K, V, C>* prepend(RadixNode<K, V, C> *node, const typename RadixNode<K, V, C>::value_type &value) {
+// Splits the edge of node at the first byte where it differs from
+// value->first and stores value at the split point or in a new sibling leaf.
+template <typename K, typename V, class C, class G, class A>
+RadixNode<K, V, C, G>* prepend(RadixNode<K, V, C, G> *node, typename RadixNode<K, V, C, G>::value_type *value, A &alloc) {
     size_t nodeSize = radixSize(node->mKey);
-    size_t valueSize = radixSize(value.first) - node->mDepth;
-    size_t count;
-    for (count = 0; count < nodeSize && count < valueSize; ++count) {
-        if (!(node->mKey[count] == value.first[count + node->mDepth])) {
-            break;
-        }
-    }
-    if (count == 0) {
+    size_t valueSize = radixSize(value->first) - node->mDepth;
+    size_t count = radixCommonPrefix(radixSlice(node->mKey, 0, nodeSize),
+            radixSlice(value->first, node->mDepth, valueSize));
+    if (count == 0 || count == nodeSize) {
         throw std::logic_error("Trying to prepend inconsistant node");
     }
-    node->mParent->mChildren.erase(node->mKey);
-    auto newParentNode = new RadixNode<K, V, C>(node->mPredicate);
+    // Everything that allocates runs before the trie is touched: the new
+    // parent with its child table, the leaf for value unless value ends at
+    // the split, and the shortened edge of node. Relinking then only
+    // replaces the slot node held in its parent, which does not allocate.
+    size_t depth = node->mDepth + count;
+    auto newParentNode = createNode<K, V, C, G>(nullptr, alloc);
+    RadixNode<K, V, C, G> *leaf = nullptr;
+    K tail;
+    try {
+        newParentNode->mKey = radixSubstr(node->mKey, 0, count);
+        tail = radixSubstr(node->mKey, count, nodeSize - count);
+        newParentNode->mChildren.insert(radixByte(tail, 0), node, alloc);
+        if (valueSize > count) {
+            leaf = createNode<K, V, C, G>(value, alloc);
+            leaf->mKey = radixSubstr(value->first, depth, valueSize - count);
+            newParentNode->mChildren.insert(radixByte(leaf->mKey, 0), leaf, alloc);
+        }
+    } catch (...) {
+        // the caller still owns value and node is unchanged
+        if (leaf != nullptr) {
+            leaf->mValue = nullptr;
+            alloc.destroy(leaf);
+        }
+        newParentNode->mChildren.release(alloc);
+        alloc.destroy(newParentNode);
+        throw;
+    }
     newParentNode->mParent = node->mParent;
     newParentNode->mDepth = node->mDepth;
-    newParentNode->mKey = radixSubstr(node->mKey, 0, count);
-    newParentNode->mParent->mChildren[newParentNode->mKey] = newParentNode;
+    newParentNode->mParent->mChildren.insert(radixByte(newParentNode->mKey, 0), newParentNode, alloc);
 
     node->mParent = newParentNode;
-    node->mDepth += count;
-    node->mKey = radixSubstr(node->mKey, count, nodeSize - count);
-    node->mParent->mChildren[node->mKey] = node;
-
-    auto defaultKey = radixSubstr(value.first, 0, 0);
-    auto newNode = new RadixNode<K, V, C>(value, node->mPredicate);
-    newNode->mParent = newParentNode;
-    newNode->mDepth = newParentNode->mDepth + count;
-    if (count == valueSize) {
-        newNode->mKey = defaultKey;
-        newNode->mIsLeaf = true;
-        newParentNode->mChildren[defaultKey] = newNode;
-        return newNode;
+    node->mDepth = depth;
+    node->mKey = std::move(tail);
+    if (leaf != nullptr) {
+        leaf->mParent = newParentNode;
+        leaf->mDepth = depth;
+        G::refresh(leaf);
+    } else {
+        newParentNode->mValue = value;
+    }
+    G::refresh(newParentNode);
+    augmentAdded(newParentNode->mParent, *value);
+    return leaf != nullptr ? leaf : newParentNode;
+}
+
+// Folds a non-terminal node with a single child into that child and returns
+// the child, which keeps its identity so iterators to it stay valid.
+template <typename K, typename V, class C, class G, class A>
+RadixNode<K, V, C, G>* compress(RadixNode<K, V, C, G> *node, A &alloc) {
+    if (node->mParent == nullptr || node->mValue != nullptr || node->mChildren.size() != 1) {
+        return node;
+    }
+    auto child = node->mChildren.first();
+    size_t size = radixSize(node->mKey) + radixSize(child->mKey);
+    K key;
+    try {
+        key = radixSubstr(descend(child)->mValue->first, node->mDepth, size);
+    } catch (...) {
+        // merging only saves a node; lookups work through it as well
+        return node;
     }
-    auto newKey = radixSubstr(value.first, newNode->mDepth, valueSize - count);
-    newNode->mKey = newKey;
-    newParentNode->mChildren[newKey] = newNode;
+    child->mKey = std::move(key);
+    child->mDepth = node->mDepth;
+    child->mParent = node->mParent;
+    child->mParent->mChildren.insert(radixByte(child->mKey, 0), child, alloc);
+    node->mChildren.release(alloc);
+    alloc.destroy(node);
+    return child;
+}
 
-    auto newChildNode = new RadixNode<K, V, C>(value, node->mPredicate);
-    newChildNode->mDepth = radixSize(value.first);
-    newChildNode->mParent = newNode;
-    newChildNode->mKey = defaultKey;
-    newChildNode->mIsLeaf = true;
-    newNode->mChildren[defaultKey] = newChildNode;
-    return newChildNode;
+// Tells node and every node above it that value was stored below them.
+template <typename K, typename V, class C, class G>
+void augmentAdded(RadixNode<K, V, C, G> *node, const typename RadixNode<K, V, C, G>::value_type &value) {
+    if constexpr (G::enabled) {
+        for (; node != nullptr; node = node->parent()) {
+            G::added(node, value);
+        }
+    }
 }
 
-template <typename K, typename V, class C>
-void RadixNode<K, V, C>::erase(const K &key) {
-    mChildren.erase(key);
+// Recomputes the augmentation of node and every node above it, after a
+// removal below node or a change to its own value.
+template <typename K, typename V, class C, class G>
+void augmentRefresh(RadixNode<K, V, C, G> *node) {
+    if constexpr (G::enabled) {
+        for (; node != nullptr; node = node->parent()) {
+            G::refresh(node);
+        }
+    }
 }
 
-template <typename K, typename V, class C>
-size_t RadixNode<K, V, C>::size() const {
+// Number of keys before node in the whole trie: the terminal ancestors of
+// node plus the subtrees of the siblings left of the path. Counts are not
+// prefix-summed, so each level sums its left siblings: O(depth * fan-out).
+// Needs a policy with subtree counts.
+template <typename K, typename V, class C, class G>
+size_t rankOf(RadixNode<K, V, C, G> *node) {
+    size_t rank = 0;
+    for (auto parent = node->parent(); parent != nullptr; node = parent, parent = parent->parent()) {
+        rank += parent->isTerminal();
+        for (auto child : parent->children()) {
+            if (child == node) {
+                break;
+            }
+            rank += child->augment().count;
+        }
+    }
+    return rank;
+}
+
+// Terminal node holding the key at position index within the subtree of
+// node, or nullptr past its end. Each level skips children by their counts,
+// O(depth * fan-out) like rankOf(). Needs a policy with subtree counts.
+template <typename K, typename V, class C, class G>
+RadixNode<K, V, C, G>* selectNode(RadixNode<K, V, C, G> *node, size_t index) {
+    if (index >= node->augment().count) {
+        return nullptr;
+    }
+    while (true) {
+        if (node->isTerminal()) {
+            if (index == 0) {
+                return node;
+            }
+            --index;
+        }
+        for (auto child : node->children()) {
+            if (index < child->augment().count) {
+                node = child;
+                break;
+            }
+            index -= child->augment().count;
+        }
+    }
+}
+
+template <typename K, typename V, class C, class G>
+template <class A>
+void RadixNode<K, V, C, G>::erase(const K &key, A &alloc) {
+    mChildren.erase(radixByte(key, 0), alloc);
+}
+
+template <typename K, typename V, class C, class G>
+size_t RadixNode<K, V, C, G>::size() const {
     return mChildren.size();
 }
 
-template <typename K, typename V, class C>
-bool RadixNode<K, V, C>::empty() const {
+template <typename K, typename V, class C, class G>
+bool RadixNode<K, V, C, G>::empty() const {
     return mChildren.empty();
 }
 
-template <typename K, typename V, class C>
-auto RadixNode<K, V, C>::children() const -> const children_type& {
+template <typename K, typename V, class C, class G>
+auto RadixNode<K, V, C, G>::children() const -> const children_type& {
     return mChildren;
 }
 
-template <typename K, typename V, class C>
-void RadixNode<K, V, C>::setChild(const K &key, RadixNode<K, V, C> *node) {
-    mChildren[key] = node;
+template <typename K, typename V, class C, class G>
+template <class A>
+void RadixNode<K, V, C, G>::setChild(const K &key, RadixNode<K, V, C, G> *node, A &alloc) {
+    mChildren.insert(radixByte(key, 0), node, alloc);
+}
+
+template <typename K, typename V, class C, class G>
+RadixNode<K, V, C, G>* RadixNode<K, V, C, G>::firstChild() const {
+    return mChildren.first();
+}
+
+template <typename K, typename V, class C, class G>
+RadixNode<K, V, C, G>* RadixNode<K, V, C, G>::lastChild() const {
+    return mChildren.last();
+}
+
+template <typename K, typename V, class C, class G>
+auto RadixNode<K, V, C, G>::augment() -> augment_type& {
+    return *this;
+}
+
+template <typename K, typename V, class C, class G>
+auto RadixNode<K, V, C, G>::augment() const -> const augment_type& {
+    return *this;
 }
 
-template <typename K, typename V, class C>
-bool RadixNode<K, V, C>::isLeaf() const {
-    return mIsLeaf;
+template <typename K, typename V, class C, class G>
+bool RadixNode<K, V, C, G>::isTerminal() const {
+    return mValue != nullptr;
 }
 
-template <typename K, typename V, typename C>
-K& RadixNode<K, V, C>::key() {
+template <typename K, typename V, typename C, typename G>
+K& RadixNode<K, V, C, G>::key() {
     return mKey;
 }
 
-template <typename K, typename V, typename C>
-void RadixNode<K, V, C>::setKey(const K &key) {
+template <typename K, typename V, typename C, typename G>
+void RadixNode<K, V, C, G>::setKey(const K &key) {
     mKey = key;
 }
 
-template <typename K, typename V, typename C>
-size_t RadixNode<K, V, C>::depth() const {
+template <typename K, typename V, typename C, typename G>
+size_t RadixNode<K, V, C, G>::depth() const {
     return mDepth;
 }
 
-template <typename K, typename V, typename C>
-void RadixNode<K, V, C>::setDepth(size_t depth) {
+template <typename K, typename V, typename C, typename G>
+void RadixNode<K, V, C, G>::setDepth(size_t depth) {
     mDepth = depth;
 }
 
-template <typename K, typename V, typename C>
-RadixNode<K, V, C>* RadixNode<K, V, C>::parent() {
+template <typename K, typename V, typename C, typename G>
+RadixNode<K, V, C, G>* RadixNode<K, V, C, G>::parent() {
     return mParent;
 }
 
-template <typename K, typename V, typename C>
-void RadixNode<K, V, C>::setParent(RadixNode<K, V, C> *node) {
+template <typename K, typename V, typename C, typename G>
+void RadixNode<K, V, C, G>::setParent(RadixNode<K, V, C, G> *node) {
     mParent = node;
 }
 
@@ -0,0 +1,96 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace Patricia {
+
+// Runs fn(task) for every task in [0, count) on up to threads threads, the
+// calling one included. Each worker starts on its own contiguous block of
+// tasks and takes them from the front; a worker that runs dry steals from
+// the back of the block with the most tasks left, so uneven tasks still
+// keep every thread busy. The first exception thrown by fn cancels the
+// tasks not yet started and is rethrown once all workers are done.
+template <typename F>
+void radixParallelFor(size_t count, unsigned threads, F &&fn) {
+    if (threads > count) {
+        threads = static_cast<unsigned>(count);
+    }
+    if (threads <= 1) {
+        for (size_t task = 0; task < count; ++task) {
+            fn(task);
+        }
+        return;
+    }
+    struct Block {
+        std::mutex lock;
+        size_t next = 0;
+        size_t end = 0;
+    };
+    std::vector<Block> blocks(threads);
+    for (size_t worker = 0; worker < threads; ++worker) {
+        blocks[worker].next = count * worker / threads;
+        blocks[worker].end = count * (worker + 1) / threads;
+    }
+    auto take = [&blocks](size_t worker, size_t &task) {
+        {
+            std::lock_guard<std::mutex> guard(blocks[worker].lock);
+            if (blocks[worker].next < blocks[worker].end) {
+                task = blocks[worker].next++;
+                return true;
+            }
+        }
+        while (true) {
+            size_t victim = blocks.size();
+            size_t most = 0;
+            for (size_t other = 0; other < blocks.size(); ++other) {
+                std::lock_guard<std::mutex> guard(blocks[other].lock);
+                if (blocks[other].end - blocks[other].next > most) {
+                    most = blocks[other].end - blocks[other].next;
+                    victim = other;
+                }
+            }
+            if (victim == blocks.size()) {
+                return false;
+            }
+            std::lock_guard<std::mutex> guard(blocks[victim].lock);
+            if (blocks[victim].next < blocks[victim].end) {
+                task = --blocks[victim].end;
+                return true;
+            }
+        }
+    };
+    std::exception_ptr error;
+    std::mutex errorLock;
+    std::atomic<bool> failed{false};
+    auto work = [&](size_t worker) {
+        size_t task;
+        while (!failed && take(worker, task)) {
+            try {
+                fn(task);
+            } catch (...) {
+                std::lock_guard<std::mutex> guard(errorLock);
+                if (!error) {
+                    error = std::current_exception();
+                }
+                failed = true;
+            }
+        }
+    };
+    std::vector<std::thread> workers;
+    for (size_t worker = 1; worker < threads; ++worker) {
+        workers.emplace_back(work, worker);
+    }
+    work(0);
+    for (auto &worker : workers) {
+        worker.join();
+    }
+    if (error) {
+        std::rethrow_exception(error);
+    }
+}
+
+} // namespace Patricia
@@ -0,0 +1,349 @@
+#pragma once
+#include <cstddef>
+#include <new>
+#include <utility>
+#include <vector>
+
+namespace Patricia {
+
+// Allocator policies used by RadixTrie to place nodes, values and child
+// tables. A policy provides:
+//   void* allocate(size_t size);
+//   void deallocate(void *ptr, size_t size);
+//   T* create<T>(args...) / void destroy<T>(T *ptr);
+//   void release();                 // drop every allocation at once
+//   void merge(Policy &other);      // take over everything other owns
+//   bool adopt(Policy &other, void *ptr, size_t size);
+//                                   // take over one block of other, false
+//                                   // when blocks cannot change owner
+//   size_t bytesReserved() const;   // bytes taken from the system
+//   size_t bytesInUse() const;      // bytes handed out and not yet returned
+//   static constexpr bool bulkRelease; // release() frees memory without
+//                                      // per-object deallocate() calls
+
+// Slab arena: small blocks are carved from large slabs and recycled through
+// per size class free lists, big blocks go straight to operator new.
+class RadixArena {
+public:
+    static constexpr bool bulkRelease = true;
+    static constexpr size_t Granularity = 16;
+    static constexpr size_t MaxSmallSize = 4096;
+    static constexpr size_t SlabSize = 64 * 1024;
+
+    RadixArena();
+    RadixArena(RadixArena &&other) noexcept;
+    RadixArena& operator=(RadixArena &&other) noexcept;
+    ~RadixArena();
+
+    void* allocate(size_t size);
+    void deallocate(void *ptr, size_t size);
+    template <typename T, typename... Args>
+    T* create(Args&&... args);
+    template <typename T>
+    void destroy(T *ptr);
+    void release();
+    void merge(RadixArena &other);
+    bool adopt(RadixArena &other, void *ptr, size_t size);
+    size_t bytesReserved() const;
+    size_t bytesInUse() const;
+private:
+    RadixArena(const RadixArena &) = delete;
+    RadixArena& operator=(const RadixArena &) = delete;
+    static size_t sizeClass(size_t size);
+    void* refill(size_t roundedSize);
+private:
+    struct FreeBlock {
+        FreeBlock *next;
+    };
+    struct LargeBlock {
+        LargeBlock *next;
+        LargeBlock *prev;
+        size_t size;
+    };
+    static constexpr size_t ClassCount = MaxSmallSize / Granularity;
+    static constexpr size_t LargeHeader = (sizeof(LargeBlock) + Granularity - 1) / Granularity * Granularity;
+
+    std::vector<char *> mSlabs;
+    FreeBlock *mFree[ClassCount];
+    LargeBlock *mLarge;
+    char *mCursor;
+    char *mLimit;
+    size_t mReserved;
+    size_t mInUse;
+};
+
+// Plain heap policy: every block is an individual operator new.
+class RadixHeap {
+public:
+    static constexpr bool bulkRelease = false;
+
+    void* allocate(size_t size);
+    void deallocate(void *ptr, size_t size);
+    template <typename T, typename... Args>
+    T* create(Args&&... args);
+    template <typename T>
+    void destroy(T *ptr);
+    void release();
+    void merge(RadixHeap &other);
+    bool adopt(RadixHeap &other, void *ptr, size_t size);
+    size_t bytesReserved() const;
+    size_t bytesInUse() const;
+private:
+    size_t mInUse = 0;
+};
+
+inline RadixArena::RadixArena()
+    : mSlabs(),
+    mFree(),
+    mLarge(nullptr),
+    mCursor(nullptr),
+    mLimit(nullptr),
+    mReserved(0),
+    mInUse(0) { }
+
+inline RadixArena::RadixArena(RadixArena &&other) noexcept
+    : RadixArena() {
+    *this = std::move(other);
+}
+
+inline RadixArena& RadixArena::operator=(RadixArena &&other) noexcept {
+    if (this == &other) {
+        return *this;
+    }
+    release();
+    mSlabs = std::move(other.mSlabs);
+    for (size_t i = 0; i < ClassCount; ++i) {
+        mFree[i] = other.mFree[i];
+        other.mFree[i] = nullptr;
+    }
+    mLarge = std::exchange(other.mLarge, nullptr);
+    mCursor = std::exchange(other.mCursor, nullptr);
+    mLimit = std::exchange(other.mLimit, nullptr);
+    mReserved = std::exchange(other.mReserved, 0);
+    mInUse = std::exchange(other.mInUse, 0);
+    other.mSlabs.clear();
+    return *this;
+}
+
+inline RadixArena::~RadixArena() {
+    release();
+}
+
+inline size_t RadixArena::sizeClass(size_t size) {
+    return size == 0 ? 0 : (size - 1) / Granularity;
+}
+
+inline void* RadixArena::allocate(size_t size) {
+    if (size > MaxSmallSize) {
+        auto block = static_cast<LargeBlock *>(::operator new(size + LargeHeader));
+        block->next = mLarge;
+        block->prev = nullptr;
+        block->size = size;
+        if (mLarge != nullptr) {
+            mLarge->prev = block;
+        }
+        mLarge = block;
+        mReserved += size + LargeHeader;
+        mInUse += size;
+        return reinterpret_cast<char *>(block) + LargeHeader;
+    }
+    size_t index = sizeClass(size);
+    size_t rounded = (index + 1) * Granularity;
+    mInUse += rounded;
+    if (auto block = mFree[index]; block != nullptr) {
+        mFree[index] = block->next;
+        return block;
+    }
+    return refill(rounded);
+}
+
+inline void* RadixArena::refill(size_t roundedSize) {
+    if (mCursor == nullptr || static_cast<size_t>(mLimit - mCursor) < roundedSize) {
+        auto slab = static_cast<char *>(::operator new(SlabSize));
+        mSlabs.push_back(slab);
+        mReserved += SlabSize;
+        mCursor = slab;
+        mLimit = slab + SlabSize;
+    }
+    void *result = mCursor;
+    mCursor += roundedSize;
+    return result;
+}
+
+inline void RadixArena::deallocate(void *ptr, size_t size) {
+    if (ptr == nullptr) {
+        return;
+    }
+    if (size > MaxSmallSize) {
+        auto block = reinterpret_cast<LargeBlock *>(static_cast<char *>(ptr) - LargeHeader);
+        if (block->prev != nullptr) {
+            block->prev->next = block->next;
+        } else {
+            mLarge = block->next;
+        }
+        if (block->next != nullptr) {
+            block->next->prev = block->prev;
+        }
+        mReserved -= block->size + LargeHeader;
+        mInUse -= block->size;
+        ::operator delete(block);
+        return;
+    }
+    size_t index = sizeClass(size);
+    auto block = static_cast<FreeBlock *>(ptr);
+    block->next = mFree[index];
+    mFree[index] = block;
+    mInUse -= (index + 1) * Granularity;
+}
+
+template <typename T, typename... Args>
+T* RadixArena::create(Args&&... args) {
+    static_assert(alignof(T) <= Granularity, "RadixArena blocks are 16 byte aligned");
+    void *place = allocate(sizeof(T));
+    try {
+        return new (place) T(std::forward<Args>(args)...);
+    } catch (...) {
+        deallocate(place, sizeof(T));
+        throw;
+    }
+}
+
+template <typename T>
+void RadixArena::destroy(T *ptr) {
+    if (ptr == nullptr) {
+        return;
+    }
+    ptr->~T();
+    deallocate(ptr, sizeof(T));
+}
+
+inline void RadixArena::release() {
+    for (auto slab : mSlabs) {
+        ::operator delete(slab);
+    }
+    mSlabs.clear();
+    while (mLarge != nullptr) {
+        auto next = mLarge->next;
+        ::operator delete(mLarge);
+        mLarge = next;
+    }
+    for (size_t i = 0; i < ClassCount; ++i) {
+        mFree[i] = nullptr;
+    }
+    mCursor = nullptr;
+    mLimit = nullptr;
+    mReserved = 0;
+    mInUse = 0;
+}
+
+// Adopts the slabs, large blocks and free lists of other, which is left
+// empty. Blocks handed out by other stay valid and now belong to this arena.
+inline void RadixArena::merge(RadixArena &other) {
+    if (this == &other) {
+        return;
+    }
+    mSlabs.insert(mSlabs.end(), other.mSlabs.begin(), other.mSlabs.end());
+    other.mSlabs.clear();
+    for (size_t i = 0; i < ClassCount; ++i) {
+        if (other.mFree[i] == nullptr) {
+            continue;
+        }
+        auto tail = other.mFree[i];
+        while (tail->next != nullptr) {
+            tail = tail->next;
+        }
+        tail->next = mFree[i];
+        mFree[i] = other.mFree[i];
+        other.mFree[i] = nullptr;
+    }
+    if (other.mLarge != nullptr) {
+        auto tail = other.mLarge;
+        while (tail->next != nullptr) {
+            tail = tail->next;
+        }
+        tail->next = mLarge;
+        if (mLarge != nullptr) {
+            mLarge->prev = tail;
+        }
+        mLarge = other.mLarge;
+        other.mLarge = nullptr;
+    }
+    mReserved += std::exchange(other.mReserved, 0);
+    mInUse += std::exchange(other.mInUse, 0);
+    other.mCursor = nullptr;
+    other.mLimit = nullptr;
+}
+
+// Blocks are carved from the slabs of their arena and cannot move alone.
+inline bool RadixArena::adopt(RadixArena &other, void *, size_t) {
+    return this == &other;
+}
+
+inline size_t RadixArena::bytesReserved() const {
+    return mReserved;
+}
+
+inline size_t RadixArena::bytesInUse() const {
+    return mInUse;
+}
+
+inline void* RadixHeap::allocate(size_t size) {
+    mInUse += size;
+    return ::operator new(size);
+}
+
+inline void RadixHeap::deallocate(void *ptr, size_t size) {
+    if (ptr == nullptr) {
+        return;
+    }
+    mInUse -= size;
+    ::operator delete(ptr);
+}
+
+template <typename T, typename... Args>
+T* RadixHeap::create(Args&&... args) {
+    void *place = allocate(sizeof(T));
+    try {
+        return new (place) T(std::forward<Args>(args)...);
+    } catch (...) {
+        deallocate(place, sizeof(T));
+        throw;
+    }
+}
+
+template <typename T>
+void RadixHeap::destroy(T *ptr) {
+    if (ptr == nullptr) {
+        return;
+    }
+    ptr->~T();
+    deallocate(ptr, sizeof(T));
+}
+
+inline void RadixHeap::release() {
+    mInUse = 0;
+}
+
+inline void RadixHeap::merge(RadixHeap &other) {
+    if (this != &other) {
+        mInUse += std::exchange(other.mInUse, 0);
+    }
+}
+
+inline bool RadixHeap::adopt(RadixHeap &other, void *, size_t size) {
+    if (this != &other) {
+        other.mInUse -= size;
+        mInUse += size;
+    }
+    return true;
+}
+
+inline size_t RadixHeap::bytesReserved() const {
+    return mInUse;
+}
+
+inline size_t RadixHeap::bytesInUse() const {
+    return mInUse;
+}
+
+} // namespace Patricia
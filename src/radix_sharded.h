@@ -0,0 +1,324 @@
+#pragma once
+
+#include "radix_trie.h"
+#include <array>
+#include <cstddef>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+namespace Patricia {
+
+template <typename K, typename V, typename C, typename A> class ShardedRadixTrie;
+
+// Forward iterator over every shard in turn. Shards own contiguous leading
+// byte ranges in increasing order, so the concatenation is sorted.
+template <typename K, typename V, typename C, typename A>
+class ShardedRadixIter {
+public:
+    using inner_type = typename RadixTrie<K, V, C, A>::iterator;
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = typename inner_type::value_type;
+    using difference_type = std::ptrdiff_t;
+    using pointer = value_type*;
+    using reference = value_type&;
+
+    ShardedRadixIter();
+    ShardedRadixIter(const ShardedRadixTrie<K, V, C, A> *owner, size_t shard, inner_type inner);
+
+    reference operator*() const;
+    pointer operator->() const;
+    ShardedRadixIter& operator++(); // prefix
+    ShardedRadixIter operator++(int); // postfix
+    bool operator!=(const ShardedRadixIter &other) const;
+    bool operator==(const ShardedRadixIter &other) const;
+    size_t shard() const;
+private:
+    void skipEmpty();
+    const ShardedRadixTrie<K, V, C, A> *mOwner;
+    size_t mShard;
+    inner_type mInner;
+};
+
+// RadixTrie split into independent shards by the leading byte of the key.
+// Each shard has its own mutex and its own allocator, so producers writing
+// to different byte ranges never contend; the empty key lives in shard 0.
+// Single key operations are thread-safe. Iteration, clear() and the shard
+// accessors take no locks and need writers to be quiescent.
+template <typename K, typename V, typename C = std::less<K>, typename A = RadixArena>
+class ShardedRadixTrie {
+public:
+    using trie_type = RadixTrie<K, V, C, A>;
+    using key_type = K;
+    using key_view = typename RadixView<K>::type;
+    using mapped_type = V;
+    using value_type = typename trie_type::value_type;
+    using iterator = ShardedRadixIter<K, V, C, A>;
+    using size_type = std::size_t;
+
+    static constexpr size_type MaxShards = 256;
+
+    explicit ShardedRadixTrie(size_type shards = std::thread::hardware_concurrency());
+    explicit ShardedRadixTrie(const std::vector<unsigned char> &splits);
+    template <typename It>
+    static std::vector<unsigned char> splitsFor(It first, It last, size_type shards);
+
+    size_type size() const;
+    bool empty() const;
+    void clear();
+    size_type shardCount() const;
+    size_type shardOf(const key_view &key) const;
+    trie_type& shard(size_type index);
+    const trie_type& shard(size_type index) const;
+
+    bool insert(const value_type &value);
+    bool insert(const key_view &key, const V &value);
+    bool erase(const key_view &key);
+    std::optional<V> find(const key_view &key) const;
+    bool contains(const key_view &key) const;
+
+    iterator begin() const;
+    iterator end() const;
+private:
+    friend class ShardedRadixIter<K, V, C, A>;
+    ShardedRadixTrie(const ShardedRadixTrie &) = delete;
+    ShardedRadixTrie& operator=(const ShardedRadixTrie &) = delete;
+    struct alignas(64) Shard {
+        mutable std::mutex mutex;
+        trie_type trie;
+    };
+    std::vector<std::unique_ptr<Shard>> mShards;
+    std::array<unsigned char, 256> mRoute;
+};
+
+template <typename K, typename V, typename C, typename A>
+ShardedRadixIter<K, V, C, A>::ShardedRadixIter()
+    : mOwner(nullptr),
+    mShard(0),
+    mInner() { }
+
+template <typename K, typename V, typename C, typename A>
+ShardedRadixIter<K, V, C, A>::ShardedRadixIter(const ShardedRadixTrie<K, V, C, A> *owner, size_t shard, inner_type inner)
+    : mOwner(owner),
+    mShard(shard),
+    mInner(inner) {
+    skipEmpty();
+}
+
+// Moves past exhausted shards; the end position is shardCount() with a
+// null inner iterator.
+template <typename K, typename V, typename C, typename A>
+void ShardedRadixIter<K, V, C, A>::skipEmpty() {
+    auto count = mOwner->shardCount();
+    while (mShard < count && mInner == mOwner->mShards[mShard]->trie.end()) {
+        if (++mShard < count) {
+            mInner = mOwner->mShards[mShard]->trie.begin();
+        } else {
+            mInner = inner_type();
+        }
+    }
+}
+
+template <typename K, typename V, typename C, typename A>
+auto ShardedRadixIter<K, V, C, A>::operator*() const -> reference {
+    return *mInner;
+}
+
+template <typename K, typename V, typename C, typename A>
+auto ShardedRadixIter<K, V, C, A>::operator->() const -> pointer {
+    return mInner.operator->();
+}
+
+template <typename K, typename V, typename C, typename A>
+ShardedRadixIter<K, V, C, A>& ShardedRadixIter<K, V, C, A>::operator++() { // prefix
+    ++mInner;
+    skipEmpty();
+    return *this;
+}
+
+template <typename K, typename V, typename C, typename A>
+ShardedRadixIter<K, V, C, A> ShardedRadixIter<K, V, C, A>::operator++(int) { // postfix
+    ShardedRadixIter copy(*this);
+    ++(*this);
+    return copy;
+}
+
+template <typename K, typename V, typename C, typename A>
+bool ShardedRadixIter<K, V, C, A>::operator!=(const ShardedRadixIter &other) const {
+    return mShard != other.mShard || mInner != other.mInner;
+}
+
+template <typename K, typename V, typename C, typename A>
+bool ShardedRadixIter<K, V, C, A>::operator==(const ShardedRadixIter &other) const {
+    return !(*this != other);
+}
+
+template <typename K, typename V, typename C, typename A>
+size_t ShardedRadixIter<K, V, C, A>::shard() const {
+    return mShard;
+}
+
+// Splits the byte range evenly, which suits keys with well spread leading
+// bytes (hashes, binary ids). Text keys are better served by splitsFor().
+template <typename K, typename V, typename C, typename A>
+ShardedRadixTrie<K, V, C, A>::ShardedRadixTrie(size_type shards)
+    : mShards(),
+    mRoute() {
+    if (shards == 0) {
+        shards = 1;
+    }
+    if (shards > MaxShards) {
+        shards = MaxShards;
+    }
+    for (size_type i = 0; i < shards; ++i) {
+        mShards.push_back(std::make_unique<Shard>());
+    }
+    for (size_type byte = 0; byte < 256; ++byte) {
+        mRoute[byte] = static_cast<unsigned char>(byte * shards / 256);
+    }
+}
+
+// Shard i takes the leading bytes in [splits[i - 1], splits[i]); splits must
+// be strictly increasing and non-zero, giving splits.size() + 1 shards.
+template <typename K, typename V, typename C, typename A>
+ShardedRadixTrie<K, V, C, A>::ShardedRadixTrie(const std::vector<unsigned char> &splits)
+    : mShards(),
+    mRoute() {
+    for (size_type i = 0; i < splits.size(); ++i) {
+        if (splits[i] == 0 || (i > 0 && splits[i] <= splits[i - 1])) {
+            throw std::invalid_argument("shard splits must be increasing and non-zero");
+        }
+    }
+    for (size_type i = 0; i <= splits.size(); ++i) {
+        mShards.push_back(std::make_unique<Shard>());
+    }
+    size_type shard = 0;
+    for (size_type byte = 0; byte < 256; ++byte) {
+        if (shard < splits.size() && byte >= splits[shard]) {
+            ++shard;
+        }
+        mRoute[byte] = static_cast<unsigned char>(shard);
+    }
+}
+
+// Split points that give each of shards roughly the same number of the
+// sample keys in [first, last), judged by their leading bytes.
+template <typename K, typename V, typename C, typename A>
+template <typename It>
+std::vector<unsigned char> ShardedRadixTrie<K, V, C, A>::splitsFor(It first, It last, size_type shards) {
+    std::array<size_type, 256> histogram{};
+    size_type total = 0;
+    for (; first != last; ++first) {
+        key_view key(*first);
+        ++histogram[radixSize(key) == 0 ? 0 : radixByte(key, 0)];
+        ++total;
+    }
+    std::vector<unsigned char> splits;
+    size_type seen = 0;
+    for (size_type byte = 0; byte < 256 && splits.size() + 1 < shards; ++byte) {
+        seen += histogram[byte];
+        size_type target = total * (splits.size() + 1) / shards;
+        if (seen >= target && seen > 0 && byte < 255) {
+            splits.push_back(static_cast<unsigned char>(byte + 1));
+        }
+    }
+    return splits;
+}
+
+template <typename K, typename V, typename C, typename A>
+auto ShardedRadixTrie<K, V, C, A>::size() const -> size_type {
+    size_type total = 0;
+    for (const auto &shard : mShards) {
+        std::lock_guard<std::mutex> lock(shard->mutex);
+        total += shard->trie.size();
+    }
+    return total;
+}
+
+template <typename K, typename V, typename C, typename A>
+bool ShardedRadixTrie<K, V, C, A>::empty() const {
+    return size() == 0;
+}
+
+template <typename K, typename V, typename C, typename A>
+void ShardedRadixTrie<K, V, C, A>::clear() {
+    for (auto &shard : mShards) {
+        std::lock_guard<std::mutex> lock(shard->mutex);
+        shard->trie.clear();
+    }
+}
+
+template <typename K, typename V, typename C, typename A>
+auto ShardedRadixTrie<K, V, C, A>::shardCount() const -> size_type {
+    return mShards.size();
+}
+
+template <typename K, typename V, typename C, typename A>
+auto ShardedRadixTrie<K, V, C, A>::shardOf(const key_view &key) const -> size_type {
+    return radixSize(key) == 0 ? 0 : mRoute[radixByte(key, 0)];
+}
+
+template <typename K, typename V, typename C, typename A>
+auto ShardedRadixTrie<K, V, C, A>::shard(size_type index) -> trie_type& {
+    return mShards[index]->trie;
+}
+
+template <typename K, typename V, typename C, typename A>
+auto ShardedRadixTrie<K, V, C, A>::shard(size_type index) const -> const trie_type& {
+    return mShards[index]->trie;
+}
+
+template <typename K, typename V, typename C, typename A>
+bool ShardedRadixTrie<K, V, C, A>::insert(const value_type &value) {
+    auto &shard = *mShards[shardOf(value.first)];
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    return shard.trie.insert(value).second;
+}
+
+template <typename K, typename V, typename C, typename A>
+bool ShardedRadixTrie<K, V, C, A>::insert(const key_view &key, const V &value) {
+    auto &shard = *mShards[shardOf(key)];
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    return shard.trie.insert(key, value).second;
+}
+
+template <typename K, typename V, typename C, typename A>
+bool ShardedRadixTrie<K, V, C, A>::erase(const key_view &key) {
+    auto &shard = *mShards[shardOf(key)];
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    return shard.trie.erase(key);
+}
+
+template <typename K, typename V, typename C, typename A>
+std::optional<V> ShardedRadixTrie<K, V, C, A>::find(const key_view &key) const {
+    auto &shard = *mShards[shardOf(key)];
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    auto it = shard.trie.find(key);
+    if (it == shard.trie.end()) {
+        return std::nullopt;
+    }
+    return it->second;
+}
+
+template <typename K, typename V, typename C, typename A>
+bool ShardedRadixTrie<K, V, C, A>::contains(const key_view &key) const {
+    auto &shard = *mShards[shardOf(key)];
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    return shard.trie.find(key) != shard.trie.end();
+}
+
+template <typename K, typename V, typename C, typename A>
+auto ShardedRadixTrie<K, V, C, A>::begin() const -> iterator {
+    return iterator(this, 0, mShards[0]->trie.begin());
+}
+
+template <typename K, typename V, typename C, typename A>
+auto ShardedRadixTrie<K, V, C, A>::end() const -> iterator {
+    return iterator(this, mShards.size(), typename iterator::inner_type());
+}
+
+} // namespace Patricia
@@ -0,0 +1,197 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#if !defined(RADIX_NO_SIMD) && defined(__SSE2__)
+#include <emmintrin.h>
+#define RADIX_HAVE_SSE2 1
+#endif
+
+#if !defined(RADIX_NO_SIMD) && defined(__AVX2__)
+#include <immintrin.h>
+#define RADIX_HAVE_AVX2 1
+#elif !defined(RADIX_NO_SIMD) && defined(__x86_64__) && defined(__GNUC__)
+#include <immintrin.h>
+#define RADIX_HAVE_AVX2 1
+#define RADIX_RUNTIME_AVX2 1
+#endif
+
+namespace Patricia {
+namespace simd {
+
+// Mismatch kernels: index of the first byte where a and b differ, or size
+// when the first size bytes are equal.
+
+inline size_t mismatchScalar(const char *a, const char *b, size_t size) {
+    size_t count = 0;
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__ && defined(__GNUC__)
+    for (; count + sizeof(uint64_t) <= size; count += sizeof(uint64_t)) {
+        uint64_t x;
+        uint64_t y;
+        std::memcpy(&x, a + count, sizeof(x));
+        std::memcpy(&y, b + count, sizeof(y));
+        if (x != y) {
+            return count + __builtin_ctzll(x ^ y) / 8;
+        }
+    }
+#endif
+    while (count < size && a[count] == b[count]) {
+        ++count;
+    }
+    return count;
+}
+
+#ifdef RADIX_HAVE_SSE2
+inline size_t mismatchSse2(const char *a, const char *b, size_t size) {
+    size_t count = 0;
+    for (; count + 16 <= size; count += 16) {
+        __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i *>(a + count));
+        __m128i y = _mm_loadu_si128(reinterpret_cast<const __m128i *>(b + count));
+        unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(_mm_cmpeq_epi8(x, y))) ^ 0xFFFFu;
+        if (mask != 0) {
+            return count + __builtin_ctz(mask);
+        }
+    }
+    return count + mismatchScalar(a + count, b + count, size - count);
+}
+#endif
+
+#ifdef RADIX_HAVE_AVX2
+#ifdef RADIX_RUNTIME_AVX2
+__attribute__((target("avx2")))
+#endif
+inline size_t mismatchAvx2(const char *a, const char *b, size_t size) {
+    size_t count = 0;
+    for (; count + 32 <= size; count += 32) {
+        __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(a + count));
+        __m256i y = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(b + count));
+        unsigned mask = ~static_cast<unsigned>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(x, y)));
+        if (mask != 0) {
+            return count + __builtin_ctz(mask);
+        }
+    }
+    return count + mismatchScalar(a + count, b + count, size - count);
+}
+#endif
+
+inline bool hasAvx2() {
+#if defined(RADIX_RUNTIME_AVX2)
+    static const bool supported = __builtin_cpu_supports("avx2");
+    return supported;
+#elif defined(RADIX_HAVE_AVX2)
+    return true;
+#else
+    return false;
+#endif
+}
+
+// Picks the widest kernel available: AVX2 when compiled in or detected at
+// runtime, SSE2 on any x86-64, the word-at-a-time loop otherwise. Short
+// inputs never leave the scalar loop.
+inline size_t mismatch(const char *a, const char *b, size_t size) {
+    if (size < 16) {
+        return mismatchScalar(a, b, size);
+    }
+#if defined(RADIX_HAVE_AVX2)
+    if (size >= 32 && hasAvx2()) {
+        return mismatchAvx2(a, b, size);
+    }
+#endif
+#if defined(RADIX_HAVE_SSE2)
+    return mismatchSse2(a, b, size);
+#else
+    return mismatchScalar(a, b, size);
+#endif
+}
+
+// Byte search kernels: index of the first occurrence of byte in data, or
+// size when there is none.
+
+inline size_t findByteScalar(const char *data, size_t size, char byte) {
+    auto found = static_cast<const char *>(std::memchr(data, byte, size));
+    return found == nullptr ? size : static_cast<size_t>(found - data);
+}
+
+#ifdef RADIX_HAVE_SSE2
+inline size_t findByteSse2(const char *data, size_t size, char byte) {
+    __m128i needle = _mm_set1_epi8(byte);
+    size_t pos = 0;
+    for (; pos + 16 <= size; pos += 16) {
+        __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + pos));
+        unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(_mm_cmpeq_epi8(chunk, needle)));
+        if (mask != 0) {
+            return pos + __builtin_ctz(mask);
+        }
+    }
+    return pos + findByteScalar(data + pos, size - pos, byte);
+}
+#endif
+
+#ifdef RADIX_HAVE_AVX2
+#ifdef RADIX_RUNTIME_AVX2
+__attribute__((target("avx2")))
+#endif
+inline size_t findByteAvx2(const char *data, size_t size, char byte) {
+    __m256i needle = _mm256_set1_epi8(byte);
+    size_t pos = 0;
+    for (; pos + 32 <= size; pos += 32) {
+        __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(data + pos));
+        unsigned mask = static_cast<unsigned>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(chunk, needle)));
+        if (mask != 0) {
+            return pos + __builtin_ctz(mask);
+        }
+    }
+    return pos + findByteScalar(data + pos, size - pos, byte);
+}
+#endif
+
+inline size_t findByte(const char *data, size_t size, char byte) {
+#if defined(RADIX_HAVE_AVX2)
+    if (size >= 32 && hasAvx2()) {
+        return findByteAvx2(data, size, byte);
+    }
+#endif
+#if defined(RADIX_HAVE_SSE2)
+    return findByteSse2(data, size, byte);
+#else
+    return findByteScalar(data, size, byte);
+#endif
+}
+
+// Child table kernels over a key array padded to 16 bytes, of which the
+// first size are valid and sorted: one compare and movemask answer the probe
+// on SSE2, the fallbacks scan.
+
+inline size_t findKey16(const unsigned char *keys, size_t size, unsigned char byte) {
+#if defined(RADIX_HAVE_SSE2)
+    __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i *>(keys));
+    unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(_mm_cmpeq_epi8(chunk, _mm_set1_epi8(static_cast<char>(byte)))));
+    mask &= (1u << size) - 1;
+    return mask != 0 ? static_cast<size_t>(__builtin_ctz(mask)) : size;
+#else
+    size_t pos = 0;
+    while (pos < size && keys[pos] != byte) {
+        ++pos;
+    }
+    return pos;
+#endif
+}
+
+inline size_t lowerBound16(const unsigned char *keys, size_t size, unsigned char byte) {
+#if defined(RADIX_HAVE_SSE2)
+    __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i *>(keys));
+    __m128i notLess = _mm_cmpeq_epi8(_mm_max_epu8(chunk, _mm_set1_epi8(static_cast<char>(byte))), chunk);
+    unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(notLess)) & ((1u << size) - 1);
+    return mask != 0 ? static_cast<size_t>(__builtin_ctz(mask)) : size;
+#else
+    size_t pos = 0;
+    while (pos < size && keys[pos] < byte) {
+        ++pos;
+    }
+    return pos;
+#endif
+}
+
+} // namespace simd
+} // namespace Patricia
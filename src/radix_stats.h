@@ -0,0 +1,108 @@
+#pragma once
+#include <cstddef>
+#include <ostream>
+#include <vector>
+
+namespace Patricia {
+
+// Operation counts kept by a trie built with RADIX_ENABLE_COUNTERS. Without
+// it the counting statements compile to nothing and every field stays 0.
+struct RadixCounters {
+    size_t inserts = 0;
+    size_t splits = 0;
+    size_t merges = 0;
+    size_t finds = 0;
+};
+
+#ifdef RADIX_ENABLE_COUNTERS
+#define RADIX_COUNT(counters, field, n) ((counters).field += (n))
+#else
+#define RADIX_COUNT(counters, field, n) ((void)0)
+#endif
+
+// Shape of a trie at one moment. Levels count edges from the root, so the
+// root is alone at level 0. Edge lengths are bucketed by powers of two:
+// bucket 0 holds empty edges (the root), bucket i lengths in
+// [2^(i-1), 2^i).
+struct RadixStats {
+#ifdef RADIX_ENABLE_COUNTERS
+    static constexpr bool countersEnabled = true;
+#else
+    static constexpr bool countersEnabled = false;
+#endif
+
+    size_t keys = 0;
+    size_t nodes = 0;
+    size_t leaves = 0;
+    size_t edgeBytes = 0;
+    size_t heapBytes = 0;
+    std::vector<size_t> depthHistogram;
+    std::vector<size_t> fanoutHistogram;
+    std::vector<size_t> edgeLengthHistogram;
+    RadixCounters counters;
+
+    void addNode(size_t level, size_t children, size_t edge);
+    double bytesPerKey() const;
+    double averageEdgeLength() const;
+    void print(std::ostream &out) const;
+};
+
+inline void RadixStats::addNode(size_t level, size_t children, size_t edge) {
+    auto bump = [](std::vector<size_t> &histogram, size_t index) {
+        if (histogram.size() <= index) {
+            histogram.resize(index + 1, 0);
+        }
+        ++histogram[index];
+    };
+    size_t bucket = 0;
+    while (edge >> bucket != 0) {
+        ++bucket;
+    }
+    ++nodes;
+    leaves += children == 0;
+    edgeBytes += edge;
+    bump(depthHistogram, level);
+    bump(fanoutHistogram, children);
+    bump(edgeLengthHistogram, bucket);
+}
+
+inline double RadixStats::bytesPerKey() const {
+    return keys == 0 ? 0.0 : static_cast<double>(heapBytes) / static_cast<double>(keys);
+}
+
+inline double RadixStats::averageEdgeLength() const {
+    return nodes <= 1 ? 0.0 : static_cast<double>(edgeBytes) / static_cast<double>(nodes - 1);
+}
+
+// A few lines of "name value" pairs; histograms print their non-empty
+// buckets only.
+inline void RadixStats::print(std::ostream &out) const {
+    out << "keys " << keys << ", nodes " << nodes << ", leaves " << leaves
+        << ", edge bytes " << edgeBytes << " (avg " << averageEdgeLength() << ")"
+        << ", heap bytes " << heapBytes << " (" << bytesPerKey() << " per key)\n";
+    auto histogram = [&out](const char *name, const std::vector<size_t> &counts, bool buckets) {
+        out << name << ":";
+        for (size_t i = 0; i < counts.size(); ++i) {
+            if (counts[i] == 0) {
+                continue;
+            }
+            out << " ";
+            if (!buckets || i <= 1) {
+                out << i;
+            } else {
+                out << (size_t(1) << (i - 1)) << "-" << (size_t(1) << i) - 1;
+            }
+            out << ":" << counts[i];
+        }
+        out << "\n";
+    };
+    histogram("depth", depthHistogram, false);
+    histogram("fanout", fanoutHistogram, false);
+    histogram("edge length", edgeLengthHistogram, true);
+    if (countersEnabled) {
+        out << "inserts " << counters.inserts << ", splits " << counters.splits
+            << ", merges " << counters.merges << ", finds " << counters.finds << "\n";
+    }
+}
+
+} // namespace Patricia
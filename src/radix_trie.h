@@ -1,213 +1,1309 @@
 #pragma once
 
+#include "radix_augment.h"
+#include "radix_critbit.h"
+#include "radix_handle.h"
 #include "radix_iter.h"
 #include "radix_node.h"
+#include "radix_parallel.h"
 #include "radix_helpers.h"
+#include "radix_pool.h"
+#include "radix_stats.h"
+#include <algorithm>
+#include <atomic>
+#include <exception>
 #include <string>
+#include <thread>
+#include <tuple>
+#include <type_traits>
+#include <vector>
+#include <iostream>
+#include <memory>
+#include <queue>
+#include <sstream>
 
 namespace Patricia {
 
 using namespace std::string_literals;
-template <typename K, typename V, typename C = std::less<K>>
+
+// What dump() prints: the whole tree one node per line, or the few lines of
+// stats().
+enum class RadixDump {
+    Tree,
+    Summary
+};
+
+// Keys are ordered by their unsigned bytes, the order of the child index and
+// of radixCompare(). C is kept for compatibility with the std::map signature
+// and must be the matching std::less; a custom comparator is rejected rather
+// than silently ignored.
+template <typename K, typename V, typename C = std::less<K>, typename A = RadixArena,
+        typename G = RadixNoAugment>
 class RadixTrie {
+    static_assert(std::is_same_v<C, std::less<K>> || std::is_same_v<C, std::less<>>,
+            "RadixTrie orders keys by unsigned bytes; C must be std::less");
+public:
     using key_type = K;
+    using key_view = typename RadixView<K>::type;
     using mapped_type = V;
-    using value_type = typename RadixNode<K, V, C>::value_type;
-    using iterator = RadixIter<K, V, C>;
+    using value_type = typename RadixNode<K, V, C, G>::value_type;
+    using iterator = RadixIter<K, V, C, G>;
     using size_type = std::size_t;
-public:
+    using allocator_type = A;
+    using node_type = RadixNodeHandle<K, V, A>;
+
+    struct insert_return_type {
+        iterator position;
+        bool inserted;
+        node_type node;
+    };
+
+    static constexpr size_type ParallelBuildThreshold = 1 << 16;
+    static constexpr size_type BatchWidth = 16;
+    static constexpr size_type TasksPerThread = 8;
+
     RadixTrie();
-    RadixTrie(C predicate);
+    template <typename It>
+    RadixTrie(It first, It last, bool sorted = false);
     ~RadixTrie();
+    RadixTrie(const RadixTrie &) = delete;
+    RadixTrie& operator=(const RadixTrie &) = delete;
     size_type size() const;
     bool empty() const;
     void clear();
 
-    iterator find(const K &key);
+    iterator find(const key_view &key);
+    iterator find(const char *key);
+    void findBatch(const key_view *keys, size_type count, iterator *out);
+    void containsBatch(const key_view *keys, size_type count, bool *out);
     iterator begin();
     iterator end();
+    iterator lower_bound(const key_view &key);
+    iterator upper_bound(const key_view &key);
+    std::pair<iterator, iterator> equal_range(const key_view &key);
 
     std::pair<iterator, bool> insert(const value_type &value);
-    bool erase(const K &key);
+    std::pair<iterator, bool> insert(const key_view &key, const V &value);
+    std::pair<iterator, bool> insert(const char *key, const V &value);
+    std::pair<iterator, bool> insert(value_type &&value);
+    insert_return_type insert(node_type &&node);
+    template <typename... Args>
+    std::pair<iterator, bool> emplace(Args&&... args);
+    template <typename... Args>
+    std::pair<iterator, bool> try_emplace(const key_view &key, Args&&... args);
+    template <typename M>
+    std::pair<iterator, bool> insert_or_assign(const key_view &key, M &&obj);
+    V& operator[](const key_view &key);
+    void refresh(iterator it);
+    node_type extract(const key_view &key);
+    node_type extract(iterator it);
+    template <typename It>
+    void build(It first, It last, bool sorted = false, unsigned threads = 0);
+    bool erase(const key_view &key);
+    bool erase(const char *key);
     void erase(iterator it);
-    void prefixMatch(const K &key, std::vector<iterator> &result);
-    void dump();
+    iterator erase(iterator first, iterator last);
+    size_type erase_prefix(const key_view &prefix);
+    RadixRange<iterator> prefixMatch(const key_view &prefix);
+    std::vector<iterator> prefixMatch(const key_view &prefix, size_type limit);
+    size_type count_prefix(const key_view &prefix);
+    size_type rank(const key_view &key);
+    iterator select(size_type index);
+    iterator longestPrefixMatch(const key_view &key);
+    std::vector<iterator> allPrefixesOf(const key_view &key);
+    std::vector<std::pair<iterator, size_t>> fuzzyFind(const key_view &key, size_t maxDistance,
+            size_type limit = static_cast<size_type>(-1));
+    std::vector<iterator> topK(const key_view &prefix, size_type k);
+    std::vector<RadixRange<iterator>> split(size_type parts);
+    template <typename F>
+    void parallel_for_each(F &&fn, unsigned threads = 0);
+    void dump(RadixDump mode = RadixDump::Tree, std::ostream &out = std::cout, unsigned threads = 1);
+    RadixStats stats() const;
+    const allocator_type& allocator() const;
+    RadixNode<K, V, C, G>* root() const;
 private:
-    void dump(RadixNode<K, V, C> *node, const std::string &prefix = ""s);
-    RadixNode<K, V, C> *mRoot;
+    void dump(RadixNode<K, V, C, G> *node, std::ostream &out, const std::string &prefix = ""s);
+    RadixNode<K, V, C, G>* locate(const key_view &key) const;
+    value_type* detach(RadixNode<K, V, C, G> *node);
+    size_type detachSubtree(RadixNode<K, V, C, G> *node);
+    RadixNode<K, V, C, G>* prune(RadixNode<K, V, C, G> *node);
+    RadixNode<K, V, C, G>* locatePrefix(const key_view &prefix) const;
+    std::vector<std::pair<RadixNode<K, V, C, G> *, bool>> partition(size_type parts) const;
+    template <typename F>
+    void prefixesOf(const key_view &key, F &&visit) const;
+    template <typename F>
+    void locateBatch(const key_view *keys, size_type count, F &&done) const;
+    template <typename F>
+    std::pair<iterator, bool> insertWith(const key_view &key, F &&make);
+    size_t buildSorted(RadixNode<K, V, C, G> *root, value_type **first, value_type **last, A &alloc);
+    size_t buildParallel(std::vector<value_type *> &values, unsigned threads);
+    void dropNodes(RadixNode<K, V, C, G> *node, A &alloc);
+    node_type handle(value_type *value);
+    RadixNode<K, V, C, G> *mRoot;
     size_t mSize;
-    C mPredicate;
+    A mAlloc;
+    std::shared_ptr<RadixHandleSource<A>> mHandles;
+#ifdef RADIX_ENABLE_COUNTERS
+    RadixCounters mCounters;
+#endif
 };
 
-template <typename K, typename V, typename C>
-RadixTrie<K, V, C>::RadixTrie()
+template <typename K, typename V, typename C, typename A, typename G>
+RadixTrie<K, V, C, A, G>::RadixTrie()
     : mRoot(nullptr),
     mSize(0),
-    mPredicate(C()) { }
+    mAlloc(),
+    mHandles() { }
 
-template <typename K, typename V, typename C>
-RadixTrie<K, V, C>::RadixTrie(C predicate)
-    : mRoot(nullptr),
-    mSize(0),
-    mPredicate(predicate) { }
+template <typename K, typename V, typename C, typename A, typename G>
+template <typename It>
+RadixTrie<K, V, C, A, G>::RadixTrie(It first, It last, bool sorted)
+    : RadixTrie() {
+    build(first, last, sorted);
+}
 
-template <typename K, typename V, typename C>
-RadixTrie<K, V, C>::~RadixTrie() {
-    delete mRoot;
+template <typename K, typename V, typename C, typename A, typename G>
+RadixTrie<K, V, C, A, G>::~RadixTrie() {
+    clear();
 }
 
-template <typename K, typename V, typename C>
-auto RadixTrie<K, V, C>::size() const -> size_type {
+template <typename K, typename V, typename C, typename A, typename G>
+auto RadixTrie<K, V, C, A, G>::size() const -> size_type {
     return mSize;
 }
 
-template <typename K, typename V, typename C>
-bool RadixTrie<K, V, C>::empty() const {
+template <typename K, typename V, typename C, typename A, typename G>
+bool RadixTrie<K, V, C, A, G>::empty() const {
     return mSize == 0;
 }
 
-template <typename K, typename V, typename C>
-void RadixTrie<K, V, C>::clear() {
-    delete mRoot;
+template <typename K, typename V, typename C, typename A, typename G>
+void RadixTrie<K, V, C, A, G>::clear() {
+    using node_type = RadixNode<K, V, C, G>;
+    if constexpr (!A::bulkRelease) {
+        destroy(mRoot, mAlloc);
+    } else if constexpr (!std::is_trivially_destructible_v<node_type> ||
+            !std::is_trivially_destructible_v<value_type>) {
+        destroy(mRoot, mAlloc, false);
+    }
+    if (mHandles != nullptr && mHandles.use_count() > 1) {
+        mHandles->orphaned.merge(mAlloc);
+        mHandles->alloc = &mHandles->orphaned;
+    }
+    mHandles.reset();
+    mAlloc.release();
     mRoot = nullptr;
     mSize = 0;
 }
 
-template <typename K, typename V, typename C>
-auto RadixTrie<K, V, C>::find(const K &key) -> iterator {
-    if (mRoot == nullptr) {
-        return iterator(nullptr);
+template <typename K, typename V, typename C, typename A, typename G>
+auto RadixTrie<K, V, C, A, G>::find(const key_view &key) -> iterator {
+    RADIX_COUNT(mCounters, finds, 1);
+    return iterator(locate(key), mRoot);
+}
+
+template <typename K, typename V, typename C, typename A, typename G>
+auto RadixTrie<K, V, C, A, G>::find(const char *key) -> iterator {
+    return find(key_view(key));
+}
+
+template <typename K, typename V, typename C, typename A, typename G>
+auto RadixTrie<K, V, C, A, G>::begin() -> iterator {
+    if (mRoot == nullptr || mSize == 0) {
+        return iterator(nullptr, mRoot);
+    }
+    return iterator(Patricia::begin(mRoot), mRoot);
+}
+
+template <typename K, typename V, typename C, typename A, typename G>
+auto RadixTrie<K, V, C, A, G>::end() -> iterator {
+    return iterator(nullptr, mRoot);
+}
+
+// First key not less than key. Each level costs one child probe plus an
+// edge comparison; leaving the matched path resolves to the first terminal
+// of the next subtree in order.
+template <typename K, typename V, typename C, typename A, typename G>
+auto RadixTrie<K, V, C, A, G>::lower_bound(const key_view &key) -> iterator {
+    if (mSize == 0) {
+        return end();
     }
-    auto node = findNode(key, mRoot, 0);
-    if (!node->isLeaf()) {
-        return iterator(nullptr);
+    auto node = mRoot;
+    size_t depth = 0;
+    size_t size = radixSize(key);
+    while (depth < size) {
+        auto byte = radixByte(key, depth);
+        auto child = node->children().find(byte);
+        if (child == nullptr) {
+            auto next = node->children().next(byte);
+            return iterator(next != nullptr ? descend(next) : ascend(node), mRoot);
+        }
+        auto edge = radixSlice(child->key(), 0, radixSize(child->key()));
+        size_t count = radixCommonPrefix(radixSlice(key, depth, size - depth), edge);
+        if (count == radixSize(edge)) {
+            node = child;
+            depth += count;
+            continue;
+        }
+        if (depth + count == size || radixByte(key, depth + count) < radixByte(edge, count)) {
+            return iterator(descend(child), mRoot);
+        }
+        return iterator(ascend(child), mRoot);
     }
-    return iterator(node);
+    return iterator(descend(node), mRoot);
 }
 
-template <typename K, typename V, typename C>
-auto RadixTrie<K, V, C>::begin() -> iterator {
-    if (mRoot == nullptr || mSize == 0) {
-        return iterator(nullptr);
+template <typename K, typename V, typename C, typename A, typename G>
+auto RadixTrie<K, V, C, A, G>::upper_bound(const key_view &key) -> iterator {
+    auto it = lower_bound(key);
+    if (it != end() && radixCompare(radixSlice(it->first, 0, radixSize(it->first)), key) == 0) {
+        ++it;
+    }
+    return it;
+}
+
+template <typename K, typename V, typename C, typename A, typename G>
+auto RadixTrie<K, V, C, A, G>::equal_range(const key_view &key) -> std::pair<iterator, iterator> {
+    auto first = lower_bound(key);
+    auto last = first;
+    if (last != end() && radixCompare(radixSlice(last->first, 0, radixSize(last->first)), key) == 0) {
+        ++last;
     }
-    return iterator(Patricia::begin(mRoot));
+    return {first, last};
+}
+
+template <typename K, typename V, typename C, typename A, typename G>
+auto RadixTrie<K, V, C, A, G>::insert(const value_type &value) -> std::pair<iterator, bool> {
+    return insertWith(value.first, [&]() {
+        return mAlloc.template create<value_type>(value);
+    });
+}
+
+template <typename K, typename V, typename C, typename A, typename G>
+auto RadixTrie<K, V, C, A, G>::insert(const key_view &key, const V &value) -> std::pair<iterator, bool> {
+    return insertWith(key, [&]() {
+        return mAlloc.template create<value_type>(K(key), value);
+    });
+}
+
+template <typename K, typename V, typename C, typename A, typename G>
+auto RadixTrie<K, V, C, A, G>::insert(const char *key, const V &value) -> std::pair<iterator, bool> {
+    return insert(key_view(key), value);
 }
 
-template <typename K, typename V, typename C>
-auto RadixTrie<K, V, C>::end() -> iterator {
-    return iterator(nullptr);
+template <typename K, typename V, typename C, typename A, typename G>
+auto RadixTrie<K, V, C, A, G>::insert(value_type &&value) -> std::pair<iterator, bool> {
+    return insertWith(value.first, [&]() {
+        return mAlloc.template create<value_type>(std::move(value));
+    });
 }
 
-template <typename K, typename V, typename C>
-auto RadixTrie<K, V, C>::insert(const value_type &value) -> std::pair<iterator, bool> {
+// Reuses the handle's pair when it came from this trie or the allocator can
+// adopt its block, and moves it into this trie's allocator otherwise. A key
+// that is already present leaves the handle untouched in the result, as
+// std::map does.
+template <typename K, typename V, typename C, typename A, typename G>
+auto RadixTrie<K, V, C, A, G>::insert(node_type &&node) -> insert_return_type {
+    if (node.empty()) {
+        return {end(), false, node_type()};
+    }
+    auto source = node.mValue;
+    auto result = insertWith(radixSlice(source->first, 0, radixSize(source->first)), [&]() {
+        if (mAlloc.adopt(*node.mSource->alloc, source, sizeof(value_type))) {
+            node.mValue = nullptr;
+            return source;
+        }
+        return mAlloc.template create<value_type>(std::move(*source));
+    });
+    if (!result.second) {
+        return {result.first, false, std::move(node)};
+    }
+    node.reset();
+    return {result.first, true, node_type()};
+}
+
+// The pair is built first since its key is needed for the descent, and is
+// dropped again if the key is already present.
+template <typename K, typename V, typename C, typename A, typename G>
+template <typename... Args>
+auto RadixTrie<K, V, C, A, G>::emplace(Args&&... args) -> std::pair<iterator, bool> {
+    auto value = mAlloc.template create<value_type>(std::forward<Args>(args)...);
+    std::pair<iterator, bool> result;
+    bool taken = false;
+    try {
+        result = insertWith(radixSlice(value->first, 0, radixSize(value->first)), [&]() {
+            taken = true;
+            return value;
+        });
+    } catch (...) {
+        if (!taken) {
+            mAlloc.destroy(value);
+        }
+        throw;
+    }
+    if (!result.second) {
+        mAlloc.destroy(value);
+    }
+    return result;
+}
+
+// Constructs the mapped value from args only when key is absent; args are
+// left alone otherwise.
+template <typename K, typename V, typename C, typename A, typename G>
+template <typename... Args>
+auto RadixTrie<K, V, C, A, G>::try_emplace(const key_view &key, Args&&... args) -> std::pair<iterator, bool> {
+    return insertWith(key, [&]() {
+        return mAlloc.template create<value_type>(std::piecewise_construct,
+                std::forward_as_tuple(K(key)), std::forward_as_tuple(std::forward<Args>(args)...));
+    });
+}
+
+template <typename K, typename V, typename C, typename A, typename G>
+template <typename M>
+auto RadixTrie<K, V, C, A, G>::insert_or_assign(const key_view &key, M &&obj) -> std::pair<iterator, bool> {
+    auto result = try_emplace(key, std::forward<M>(obj));
+    if (!result.second) {
+        result.first->second = std::forward<M>(obj);
+        refresh(result.first);
+    }
+    return result;
+}
+
+// Brings the augmentation up to date after the value at it was changed in
+// place, e.g. through operator[] or it->second.
+template <typename K, typename V, typename C, typename A, typename G>
+void RadixTrie<K, V, C, A, G>::refresh(iterator it) {
+    augmentRefresh(it.node());
+}
+
+template <typename K, typename V, typename C, typename A, typename G>
+V& RadixTrie<K, V, C, A, G>::operator[](const key_view &key) {
+    return try_emplace(key).first->second;
+}
+
+// Finds the place of key first and only then asks make() for the stored
+// value, so a key that is already present costs no allocation at all.
+template <typename K, typename V, typename C, typename A, typename G>
+template <typename F>
+auto RadixTrie<K, V, C, A, G>::insertWith(const key_view &key, F &&make) -> std::pair<iterator, bool> {
     if (mRoot == nullptr) {
-        auto defaultKey = radixSubstr(value.first, 0, 0);
-        mRoot = new RadixNode<K, V, C>(mPredicate);
-        mRoot->setKey(defaultKey);
+        mRoot = createNode<K, V, C, G>(nullptr, mAlloc);
+    }
+    auto node = findNode<K, V, C, G>(key, mRoot, 0);
+    size_t depth = node->depth() + radixSize(node->key());
+    size_t size = radixSize(key);
+    if (depth == size && node->isTerminal()) {
+        return {iterator(node, mRoot), false};
     }
-    auto node = findNode(value.first, mRoot, 0);
-    if (node->isLeaf()) {
-        return {node, false};
-    } else if (node == mRoot) {
-        ++mSize;
-        return {append(mRoot, value), true};
+    value_type *value = make();
+    try {
+        auto child = depth < size ? node->children().find(radixByte(key, depth)) : nullptr;
+        node = child != nullptr ? prepend(child, value, mAlloc) : append(node, value, mAlloc);
+        RADIX_COUNT(mCounters, splits, child != nullptr);
+    } catch (...) {
+        mAlloc.destroy(value);
+        throw;
     }
     ++mSize;
-    int size = radixSize(node->key());
-    auto childKey = radixSubstr(value.first, node->depth(), size);
-    if (childKey == node->key()) {
-        return {append(node, value), true};
+    RADIX_COUNT(mCounters, inserts, 1);
+    return {iterator(node, mRoot), true};
+}
+
+// Replaces the contents with [first, last). The values are sorted once
+// (skipped when sorted is set and the input really is in order) and the
+// trie is assembled bottom-up without any descent from the root. threads
+// selects the number of builders; 0 picks hardware concurrency for inputs
+// of ParallelBuildThreshold keys and more. Repeated keys keep their first
+// value, like repeated insert() calls.
+template <typename K, typename V, typename C, typename A, typename G>
+template <typename It>
+void RadixTrie<K, V, C, A, G>::build(It first, It last, bool sorted, unsigned threads) {
+    clear();
+    std::vector<value_type *> values;
+    try {
+        for (; first != last; ++first) {
+            values.push_back(mAlloc.template create<value_type>(*first));
+        }
+    } catch (...) {
+        for (auto value : values) {
+            mAlloc.destroy(value);
+        }
+        throw;
+    }
+    auto less = [](const value_type *left, const value_type *right) {
+        return radixCompare(radixSlice(left->first, 0, radixSize(left->first)),
+                radixSlice(right->first, 0, radixSize(right->first))) < 0;
+    };
+    if (!sorted || !std::is_sorted(values.begin(), values.end(), less)) {
+        std::stable_sort(values.begin(), values.end(), less);
     }
-    return {prepend(node, value), true};
+    size_t count = 0;
+    for (size_t i = 0; i < values.size(); ++i) {
+        if (count > 0 && !less(values[count - 1], values[i])) {
+            mAlloc.destroy(values[i]);
+        } else {
+            values[count++] = values[i];
+        }
+    }
+    values.resize(count);
+
+    mRoot = createNode<K, V, C, G>(nullptr, mAlloc);
+    if (threads == 0) {
+        threads = values.size() >= ParallelBuildThreshold ? std::thread::hardware_concurrency() : 1;
+    }
+    size_t splits = 0;
+    try {
+        if (threads <= 1) {
+            splits = buildSorted(mRoot, values.data(), values.data() + values.size(), mAlloc);
+        } else {
+            splits = buildParallel(values, threads);
+        }
+    } catch (...) {
+        dropNodes(mRoot, mAlloc);
+        mRoot = nullptr;
+        for (auto value : values) {
+            mAlloc.destroy(value);
+        }
+        clear();
+        throw;
+    }
+    mSize = values.size();
+    RADIX_COUNT(mCounters, inserts, mSize);
+    RADIX_COUNT(mCounters, splits, splits);
+    (void)splits;
 }
 
-template <typename K, typename V, typename C>
-bool RadixTrie<K, V, C>::erase(const K &key) {
-    if (mRoot == nullptr) {
-        return false;
+// Frees the nodes of a partly built tree but not their values: on a failed
+// build() some values are linked and some not yet, and all of them are
+// destroyed from the list instead.
+template <typename K, typename V, typename C, typename A, typename G>
+void RadixTrie<K, V, C, A, G>::dropNodes(RadixNode<K, V, C, G> *node, A &alloc) {
+    if (node == nullptr) {
+        return;
+    }
+    std::vector<RadixNode<K, V, C, G> *> pending{node};
+    while (!pending.empty()) {
+        auto current = pending.back();
+        pending.pop_back();
+        current->setValue(nullptr);
+        for (auto child : current->children()) {
+            pending.push_back(child);
+        }
+    }
+    destroy(node, alloc);
+}
+
+// Builds sorted, distinct values under root keeping only the rightmost path
+// on a stack: each key pops the nodes deeper than its common prefix with
+// the previous key, splits at most one edge and hangs one new node. Returns
+// the number of edges split.
+template <typename K, typename V, typename C, typename A, typename G>
+size_t RadixTrie<K, V, C, A, G>::buildSorted(RadixNode<K, V, C, G> *root, value_type **first, value_type **last, A &alloc) {
+    using node_type = RadixNode<K, V, C, G>;
+    auto end = [](node_type *node) {
+        return node->depth() + radixSize(node->key());
+    };
+    std::vector<node_type *> path{root};
+    key_view previous{};
+    size_t splits = 0;
+    for (auto it = first; it != last; ++it) {
+        auto value = *it;
+        auto key = radixSlice(value->first, 0, radixSize(value->first));
+        size_t common = it == first ? end(root) : radixCommonPrefix(previous, key);
+        node_type *split = nullptr;
+        while (end(path.back()) > common) {
+            split = path.back();
+            path.pop_back();
+        }
+        auto top = path.back();
+        if (split != nullptr && end(top) < common) {
+            // everything that can throw runs before split is moved
+            size_t head = common - split->depth();
+            auto middle = createNode<K, V, C, G>(nullptr, alloc);
+            K tail;
+            try {
+                middle->setKey(radixSubstr(split->key(), 0, head));
+                tail = radixSubstr(split->key(), head, radixSize(split->key()) - head);
+                middle->setChild(tail, split, alloc);
+            } catch (...) {
+                destroy(middle, alloc);
+                throw;
+            }
+            middle->setDepth(split->depth());
+            middle->setParent(top);
+            split->setKey(tail);
+            split->setDepth(common);
+            split->setParent(middle);
+            top->setChild(middle->key(), middle, alloc);
+            G::refresh(middle);
+            path.push_back(middle);
+            top = middle;
+            ++splits;
+        }
+        auto node = append(top, value, alloc);
+        if (node != top) {
+            path.push_back(node);
+        }
+        previous = key;
+    }
+    return splits;
+}
+
+// Splits the sorted values by leading byte and builds the groups on a pool
+// of threads, each with a private allocator. The subtrees are hung under
+// the root and the private allocators merged into the trie's afterwards.
+// On an error the partial subtree of the failing worker and the finished
+// ones are dropped without their values, for build() to destroy every value
+// exactly once. Returns the number of edges split.
+template <typename K, typename V, typename C, typename A, typename G>
+size_t RadixTrie<K, V, C, A, G>::buildParallel(std::vector<value_type *> &values, unsigned threads) {
+    using node_type = RadixNode<K, V, C, G>;
+    size_t start = 0;
+    if (!values.empty() && radixSize(values.front()->first) == 0) {
+        append(mRoot, values.front(), mAlloc);
+        start = 1;
+    }
+    std::vector<std::pair<size_t, size_t>> groups;
+    for (size_t i = start; i < values.size();) {
+        auto byte = radixByte(values[i]->first, 0);
+        size_t j = i + 1;
+        while (j < values.size() && radixByte(values[j]->first, 0) == byte) {
+            ++j;
+        }
+        groups.emplace_back(i, j);
+        i = j;
     }
-    auto defaultKey = radixSubstr(key, 0, 0);
-    auto child = findNode(key, mRoot, 0);
-    if (!child->isLeaf()) {
+    threads = std::min<size_t>(threads, groups.size());
+    std::vector<node_type *> subtrees(groups.size(), nullptr);
+    std::vector<size_t> splits(groups.size(), 0);
+    std::vector<A> allocators(threads == 0 ? 1 : threads);
+    std::vector<std::exception_ptr> errors(allocators.size());
+    std::atomic<size_t> next{0};
+    auto work = [&](size_t worker) {
+        auto &alloc = allocators[worker];
+        node_type *holder = nullptr;
+        try {
+            for (size_t group; (group = next.fetch_add(1)) < groups.size();) {
+                holder = createNode<K, V, C, G>(nullptr, alloc);
+                splits[group] = buildSorted(holder, values.data() + groups[group].first,
+                        values.data() + groups[group].second, alloc);
+                auto subtree = holder->firstChild();
+                holder->erase(subtree->key(), alloc);
+                destroy(holder, alloc);
+                holder = nullptr;
+                subtrees[group] = subtree;
+            }
+        } catch (...) {
+            dropNodes(holder, alloc);
+            errors[worker] = std::current_exception();
+            next = groups.size();
+        }
+    };
+    std::vector<std::thread> workers;
+    for (size_t worker = 1; worker < allocators.size(); ++worker) {
+        workers.emplace_back(work, worker);
+    }
+    work(0);
+    for (auto &worker : workers) {
+        worker.join();
+    }
+    for (auto &alloc : allocators) {
+        mAlloc.merge(alloc);
+    }
+    for (auto &error : errors) {
+        if (error) {
+            for (auto subtree : subtrees) {
+                dropNodes(subtree, mAlloc);
+            }
+            std::rethrow_exception(error);
+        }
+    }
+    for (auto subtree : subtrees) {
+        if (subtree != nullptr) {
+            subtree->setParent(mRoot);
+            mRoot->setChild(subtree->key(), subtree, mAlloc);
+        }
+    }
+    augmentRefresh(mRoot);
+    size_t total = 0;
+    for (auto count : splits) {
+        total += count;
+    }
+    return total;
+}
+
+template <typename K, typename V, typename C, typename A, typename G>
+bool RadixTrie<K, V, C, A, G>::erase(const key_view &key) {
+    auto node = locate(key);
+    if (node == nullptr) {
         return false;
     }
+    mAlloc.destroy(detach(node));
+    return true;
+}
 
-    auto parent = child->parent();
-    parent->erase(defaultKey);
-    delete child;
+// Takes the value out of terminal node and restores the shape invariants:
+// a node left without value and children goes away, one left with a single
+// child is folded into it. The caller owns the returned value.
+template <typename K, typename V, typename C, typename A, typename G>
+auto RadixTrie<K, V, C, A, G>::detach(RadixNode<K, V, C, G> *node) -> value_type* {
+    auto value = node->valuePtr();
+    node->setValue(nullptr);
     --mSize;
-    if (parent == mRoot) {
-        return true;
+    if (node == mRoot || node->size() > 1) {
+        augmentRefresh(node);
+        return value;
+    }
+    augmentRefresh(prune(node));
+    return value;
+}
+
+// Restores the shape at a node that lost its value or a child: valueless
+// nodes without children go away bottom-up, and the first one left with a
+// single child is folded into it. A fold that cannot allocate the joined
+// edge is skipped, which is why childless nodes can appear above a removed
+// one. Returns the node to refresh augmentation from.
+template <typename K, typename V, typename C, typename A, typename G>
+RadixNode<K, V, C, G>* RadixTrie<K, V, C, A, G>::prune(RadixNode<K, V, C, G> *node) {
+    while (node != mRoot && !node->isTerminal() && node->empty()) {
+        auto parent = node->parent();
+        parent->erase(node->key(), mAlloc);
+        destroy(node, mAlloc);
+        node = parent;
+    }
+    if (node != mRoot && !node->isTerminal() && node->size() == 1) {
+        auto merged = compress(node, mAlloc);
+        RADIX_COUNT(mCounters, merges, merged != node);
+        node = merged;
+    }
+    return node;
+}
+
+template <typename K, typename V, typename C, typename A, typename G>
+auto RadixTrie<K, V, C, A, G>::extract(const key_view &key) -> node_type {
+    auto node = locate(key);
+    if (node == nullptr) {
+        return node_type();
+    }
+    return handle(detach(node));
+}
+
+template <typename K, typename V, typename C, typename A, typename G>
+auto RadixTrie<K, V, C, A, G>::extract(iterator it) -> node_type {
+    return handle(detach(it.node()));
+}
+
+// Handles share one source per trie, made by the first extract().
+template <typename K, typename V, typename C, typename A, typename G>
+auto RadixTrie<K, V, C, A, G>::handle(value_type *value) -> node_type {
+    if (mHandles == nullptr) {
+        mHandles = std::make_shared<RadixHandleSource<A>>();
+        mHandles->alloc = &mAlloc;
+    }
+    return node_type(value, mHandles);
+}
+
+template <typename K, typename V, typename C, typename A, typename G>
+bool RadixTrie<K, V, C, A, G>::erase(const char *key) {
+    return erase(key_view(key));
+}
+
+template <typename K, typename V, typename C, typename A, typename G>
+void RadixTrie<K, V, C, A, G>::erase(iterator it) {
+    mAlloc.destroy(detach(it.node()));
+}
+
+// Removes [first, last) a subtree at a time: from first it climbs to the
+// highest node whose keys all lie in the range (first is its smallest key
+// and last is outside it) and drops that node's whole subtree. A key whose
+// own subtree reaches last is removed alone. Returns last.
+template <typename K, typename V, typename C, typename A, typename G>
+auto RadixTrie<K, V, C, A, G>::erase(iterator first, iterator last) -> iterator {
+    using node_type = RadixNode<K, V, C, G>;
+    auto encloses = [](node_type *top, node_type *node) {
+        for (; node != nullptr; node = node->parent()) {
+            if (node == top) {
+                return true;
+            }
+        }
+        return false;
+    };
+    while (first != last) {
+        auto node = first.node();
+        if (encloses(node, last.node())) {
+            auto next = std::next(first);
+            mAlloc.destroy(detach(node));
+            first = next;
+            continue;
+        }
+        auto top = node;
+        while (top != mRoot && descend(top->parent()) == node && !encloses(top->parent(), last.node())) {
+            top = top->parent();
+        }
+        first = iterator(ascend(top), mRoot);
+        detachSubtree(top);
     }
-    if (parent->size() > 1) {
-        return true;
+    return last;
+}
+
+// Drops every key starting with prefix by unlinking the one subtree that
+// holds them. Returns the number of keys removed.
+template <typename K, typename V, typename C, typename A, typename G>
+auto RadixTrie<K, V, C, A, G>::erase_prefix(const key_view &prefix) -> size_type {
+    auto node = locatePrefix(prefix);
+    if (node == nullptr) {
+        return 0;
     }
+    return detachSubtree(node);
+}
 
-    auto grandparent = parent->parent();
-    if (parent->empty()) {
-        grandparent->erase(parent->key());
-        delete parent;
-    } else {
-        grandparent = parent;
+// Frees the subtree under node in one walk and takes its key count off
+// mSize; the parent is folded into its remaining child when that leaves it
+// valueless with a single child. node == mRoot empties the trie.
+template <typename K, typename V, typename C, typename A, typename G>
+auto RadixTrie<K, V, C, A, G>::detachSubtree(RadixNode<K, V, C, G> *node) -> size_type {
+    if (node == mRoot) {
+        size_type count = mSize;
+        clear();
+        return count;
     }
-    if (grandparent == mRoot) {
-        return true;
+    auto parent = node->parent();
+    parent->erase(node->key(), mAlloc);
+    size_type count = destroy(node, mAlloc);
+    mSize -= count;
+    augmentRefresh(prune(parent));
+    return count;
+}
+
+template <typename K, typename V, typename C, typename A, typename G>
+RadixNode<K, V, C, G>* RadixTrie<K, V, C, A, G>::locate(const key_view &key) const {
+    if (mRoot == nullptr) {
+        return nullptr;
     }
-    if (grandparent->size() == 1) {
-        auto uncle = RadixNode<K, V, C>::begin(grandparent);
-        if (uncle->isLeaf()) {
-            return true;
+    auto node = findNode<K, V, C, G>(key, mRoot, 0);
+    if (!node->isTerminal() || node->depth() + radixSize(node->key()) != radixSize(key)) {
+        return nullptr;
+    }
+    return node;
+}
+
+// Looks up count keys; out[i] is find(keys[i]).
+template <typename K, typename V, typename C, typename A, typename G>
+void RadixTrie<K, V, C, A, G>::findBatch(const key_view *keys, size_type count, iterator *out) {
+    RADIX_COUNT(mCounters, finds, count);
+    locateBatch(keys, count, [this, out](size_type index, RadixNode<K, V, C, G> *node) {
+        out[index] = iterator(node, mRoot);
+    });
+}
+
+template <typename K, typename V, typename C, typename A, typename G>
+void RadixTrie<K, V, C, A, G>::containsBatch(const key_view *keys, size_type count, bool *out) {
+    RADIX_COUNT(mCounters, finds, count);
+    locateBatch(keys, count, [out](size_type index, RadixNode<K, V, C, G> *node) {
+        out[index] = node != nullptr;
+    });
+}
+
+// Runs up to BatchWidth descents in lockstep so that their cache misses
+// overlap. Each descent alternates two steps: when a node is reached only
+// its edge bytes and child slot are prefetched; on the next round, by which
+// time the other lookups have issued theirs, the edge is compared and the
+// child is picked and prefetched. done(index, node) gets the terminal node
+// for keys[index] or nullptr, and a finished slot takes the next key.
+template <typename K, typename V, typename C, typename A, typename G>
+template <typename F>
+void RadixTrie<K, V, C, A, G>::locateBatch(const key_view *keys, size_type count, F &&done) const {
+    using node_type = RadixNode<K, V, C, G>;
+    if (mRoot == nullptr) {
+        for (size_type i = 0; i < count; ++i) {
+            done(i, nullptr);
         }
-        auto oldKey = uncle->key();
-        uncle->setDepth(grandparent->depth());
-        uncle->setKey(radixJoin(grandparent->key(), uncle->key()));
-        uncle->setParent(grandparent->parent());
+        return;
+    }
+    struct Lookup {
+        node_type *node;
+        size_t depth;
+        size_type index;
+        bool loaded;
+    };
+    Lookup group[BatchWidth];
+    size_type active = 0;
+    size_type next = 0;
+    while (active < BatchWidth && next < count) {
+        group[active++] = Lookup{mRoot, 0, next++, false};
+    }
+    while (active > 0) {
+        for (size_type i = 0; i < active;) {
+            auto &lookup = group[i];
+            const auto &key = keys[lookup.index];
+            size_t size = radixSize(key);
+            auto node = lookup.node;
+            size_t edge = radixSize(node->key());
+            if (!lookup.loaded) {
+                radixPrefetch(radixSlice(node->key(), 0, edge).data());
+                if (lookup.depth + edge < size) {
+                    node->children().prefetch(radixByte(key, lookup.depth + edge));
+                }
+                lookup.loaded = true;
+                ++i;
+                continue;
+            }
+            node_type *result = nullptr;
+            bool finished = true;
+            if (lookup.depth + edge <= size && radixCommonPrefix(radixSlice(key, lookup.depth, edge),
+                    radixSlice(node->key(), 0, edge)) == edge) {
+                lookup.depth += edge;
+                if (lookup.depth == size) {
+                    result = node->isTerminal() ? node : nullptr;
+                } else if (auto child = node->children().find(radixByte(key, lookup.depth)); child != nullptr) {
+                    radixPrefetch(child);
+                    lookup.node = child;
+                    lookup.loaded = false;
+                    finished = false;
+                }
+            }
+            if (!finished) {
+                ++i;
+                continue;
+            }
+            done(lookup.index, result);
+            if (next < count) {
+                lookup = Lookup{mRoot, 0, next++, false};
+                ++i;
+            } else {
+                lookup = group[--active];
+            }
+        }
+    }
+}
 
-        grandparent->erase(uncle->key());
-        auto uncleParent = uncle->parent();
-        uncleParent->erase(grandparent->key());
-        uncleParent->setChild(grandparent->key(), uncle);
-        delete grandparent;
+// Root of the subtree holding every key that starts with prefix: the node
+// the prefix ends on, or the child whose edge the prefix ends inside.
+template <typename K, typename V, typename C, typename A, typename G>
+RadixNode<K, V, C, G>* RadixTrie<K, V, C, A, G>::locatePrefix(const key_view &prefix) const {
+    if (mSize == 0) {
+        return nullptr;
     }
-    return true;
+    auto node = findNode<K, V, C, G>(prefix, mRoot, 0);
+    size_t depth = node->depth() + radixSize(node->key());
+    size_t size = radixSize(prefix);
+    if (depth == size) {
+        return node;
+    }
+    auto child = node->children().find(radixByte(prefix, depth));
+    if (child == nullptr) {
+        return nullptr;
+    }
+    auto rest = radixSlice(prefix, depth, size - depth);
+    if (radixCommonPrefix(rest, radixSlice(child->key(), 0, radixSize(child->key()))) != size - depth) {
+        return nullptr;
+    }
+    return child;
 }
 
-template <typename K, typename V, typename C>
-void RadixTrie<K, V, C>::erase(iterator it) {
-    erase(it->first);
+template <typename K, typename V, typename C, typename A, typename G>
+auto RadixTrie<K, V, C, A, G>::allocator() const -> const allocator_type& {
+    return mAlloc;
 }
 
-template <typename K, typename V, typename C>
-void RadixTrie<K, V, C>::dump() {
-    dump(mRoot);
+// Keys starting with prefix as a lazy range: only the walk down to the
+// prefix is paid up front, each further key costs one iterator step.
+template <typename K, typename V, typename C, typename A, typename G>
+auto RadixTrie<K, V, C, A, G>::prefixMatch(const key_view &prefix) -> RadixRange<iterator> {
+    auto node = locatePrefix(prefix);
+    if (node == nullptr) {
+        return RadixRange<iterator>(end(), end());
+    }
+    return RadixRange<iterator>(iterator(descend(node), mRoot), iterator(ascend(node), mRoot));
 }
 
-template <typename K, typename V, typename C>
-void RadixTrie<K, V, C>::dump(RadixNode<K, V, C> *node, const std::string &prefix) {
-    auto parent = node->parent();
-    if (node->key().empty() && node->isLeaf()) {
+template <typename K, typename V, typename C, typename A, typename G>
+auto RadixTrie<K, V, C, A, G>::prefixMatch(const key_view &prefix, size_type limit) -> std::vector<iterator> {
+    std::vector<iterator> result;
+    auto range = prefixMatch(prefix);
+    for (auto it = range.begin(); it != range.end() && result.size() < limit; ++it) {
+        result.push_back(it);
+    }
+    return result;
+}
+
+// Keys starting with prefix: one descent with subtree counts, a walk over
+// the matches otherwise.
+template <typename K, typename V, typename C, typename A, typename G>
+auto RadixTrie<K, V, C, A, G>::count_prefix(const key_view &prefix) -> size_type {
+    if constexpr (RadixCounted<G>::value) {
+        auto node = locatePrefix(prefix);
+        return node == nullptr ? 0 : node->augment().count;
+    }
+    size_type count = 0;
+    auto range = prefixMatch(prefix);
+    for (auto it = range.begin(); it != range.end(); ++it) {
+        ++count;
+    }
+    return count;
+}
+
+// Number of stored keys less than key, i.e. the position of lower_bound(key).
+// O(depth * fan-out), see rankOf(). Needs RadixCountAugment.
+template <typename K, typename V, typename C, typename A, typename G>
+auto RadixTrie<K, V, C, A, G>::rank(const key_view &key) -> size_type {
+    static_assert(RadixCounted<G>::value, "rank() needs subtree counts");
+    auto it = lower_bound(key);
+    return it == end() ? mSize : rankOf(it.node());
+}
+
+// Key at position index in key order, or end(). O(depth * fan-out), see
+// selectNode(). Needs RadixCountAugment.
+template <typename K, typename V, typename C, typename A, typename G>
+auto RadixTrie<K, V, C, A, G>::select(size_type index) -> iterator {
+    static_assert(RadixCounted<G>::value, "select() needs subtree counts");
+    if (index >= mSize) {
+        return end();
+    }
+    return iterator(selectNode(mRoot, index), mRoot);
+}
+
+// Stored key that is the longest prefix of key (key itself included), or
+// end(). One descent, as opposed to probing find() with shorter prefixes.
+template <typename K, typename V, typename C, typename A, typename G>
+auto RadixTrie<K, V, C, A, G>::longestPrefixMatch(const key_view &key) -> iterator {
+    RadixNode<K, V, C, G> *deepest = nullptr;
+    prefixesOf(key, [&deepest](RadixNode<K, V, C, G> *node) {
+        deepest = node;
+    });
+    return iterator(deepest, mRoot);
+}
+
+// Every stored key that is a prefix of key, shortest first.
+template <typename K, typename V, typename C, typename A, typename G>
+auto RadixTrie<K, V, C, A, G>::allPrefixesOf(const key_view &key) -> std::vector<iterator> {
+    std::vector<iterator> result;
+    prefixesOf(key, [this, &result](RadixNode<K, V, C, G> *node) {
+        result.push_back(iterator(node, mRoot));
+    });
+    return result;
+}
+
+// Keys within Levenshtein distance maxDistance of key, with their distance,
+// in key order and at most limit of them. The walk carries one DP row per
+// byte of the path (row j: distance between the path so far and the first
+// j bytes of key) and drops a subtree as soon as the smallest entry of its
+// row exceeds maxDistance, since appending bytes never lowers it. Rows live
+// in one buffer indexed by path depth, which the depth-first order keeps
+// valid for every pending node.
+template <typename K, typename V, typename C, typename A, typename G>
+auto RadixTrie<K, V, C, A, G>::fuzzyFind(const key_view &key, size_t maxDistance, size_type limit)
+        -> std::vector<std::pair<iterator, size_t>> {
+    using node_type = RadixNode<K, V, C, G>;
+    std::vector<std::pair<iterator, size_t>> result;
+    if (mSize == 0 || limit == 0) {
+        return result;
+    }
+    size_t width = radixSize(key) + 1;
+    std::vector<size_t> rows(width);
+    for (size_t j = 0; j < width; ++j) {
+        rows[j] = j;
+    }
+    std::vector<node_type *> pending{mRoot};
+    while (!pending.empty()) {
+        auto node = pending.back();
+        pending.pop_back();
+        size_t depth = node->depth();
+        size_t edge = radixSize(node->key());
+        if (rows.size() < (depth + edge + 1) * width) {
+            rows.resize((depth + edge + 1) * width);
+        }
+        bool pruned = false;
+        for (size_t i = 0; i < edge && !pruned; ++i) {
+            auto byte = radixByte(node->key(), i);
+            const size_t *previous = rows.data() + (depth + i) * width;
+            size_t *next = rows.data() + (depth + i + 1) * width;
+            next[0] = previous[0] + 1;
+            size_t smallest = next[0];
+            for (size_t j = 1; j < width; ++j) {
+                size_t cost = previous[j - 1] + (radixByte(key, j - 1) != byte);
+                next[j] = std::min(std::min(previous[j], next[j - 1]) + 1, cost);
+                smallest = std::min(smallest, next[j]);
+            }
+            pruned = smallest > maxDistance;
+        }
+        if (pruned) {
+            continue;
+        }
+        size_t distance = rows[(depth + edge) * width + width - 1];
+        if (node->isTerminal() && distance <= maxDistance) {
+            result.emplace_back(iterator(node, mRoot), distance);
+            if (result.size() == limit) {
+                break;
+            }
+        }
+        size_t first = pending.size();
+        for (auto child : node->children()) {
+            pending.push_back(child);
+        }
+        std::reverse(pending.begin() + first, pending.end());
+    }
+    return result;
+}
+
+// Cuts the trie into pieces that cover it in key order: (node, true) stands
+// for the whole subtree of node, (node, false) for node alone, followed by
+// the pieces of its children. Subtrees are cut while they hold more than
+// size() / parts keys when subtree counts are kept; without them the top
+// levels are cut until there are at least parts pieces.
+template <typename K, typename V, typename C, typename A, typename G>
+auto RadixTrie<K, V, C, A, G>::partition(size_type parts) const
+        -> std::vector<std::pair<RadixNode<K, V, C, G> *, bool>> {
+    using node_type = RadixNode<K, V, C, G>;
+    std::vector<std::pair<node_type *, bool>> pieces;
+    if (mRoot == nullptr) {
+        return pieces;
+    }
+    size_type limit = mSize / std::max<size_type>(parts, 1);
+    std::vector<std::pair<node_type *, size_t>> pending;
+    std::vector<node_type *> children;
+    for (size_t levels = 0;; ++levels) {
+        size_t previous = pieces.size();
+        pieces.clear();
+        pending.assign(1, {mRoot, 0});
+        while (!pending.empty()) {
+            auto [node, level] = pending.back();
+            pending.pop_back();
+            bool cut = !node->empty();
+            if constexpr (RadixCounted<G>::value) {
+                cut = cut && node->augment().count > limit;
+            } else {
+                cut = cut && level < levels;
+            }
+            pieces.emplace_back(node, !cut);
+            if (cut) {
+                children.clear();
+                for (auto child : node->children()) {
+                    children.push_back(child);
+                }
+                for (auto it = children.rbegin(); it != children.rend(); ++it) {
+                    pending.emplace_back(*it, level + 1);
+                }
+            }
+        }
+        if (RadixCounted<G>::value || pieces.size() >= parts || pieces.size() == previous) {
+            return pieces;
+        }
+    }
+}
+
+// Splits the keys into about parts consecutive ranges in key order, along
+// subtree boundaries, so that each range can be walked on its own thread.
+template <typename K, typename V, typename C, typename A, typename G>
+auto RadixTrie<K, V, C, A, G>::split(size_type parts) -> std::vector<RadixRange<iterator>> {
+    std::vector<RadixRange<iterator>> ranges;
+    if (mSize == 0) {
+        return ranges;
+    }
+    std::vector<iterator> starts;
+    for (auto [node, whole] : partition(parts)) {
+        if (whole) {
+            starts.emplace_back(descend(node), mRoot);
+        } else if (node->isTerminal()) {
+            starts.emplace_back(node, mRoot);
+        }
+    }
+    for (size_t i = 0; i < starts.size(); ++i) {
+        ranges.emplace_back(starts[i], i + 1 < starts.size() ? starts[i + 1] : end());
+    }
+    return ranges;
+}
+
+// Calls fn(value) for every key from threads workers (0 for all cores),
+// one range of split() at a time; fn must be safe to call concurrently.
+// Keys within a range are visited in order, ranges in no particular order.
+template <typename K, typename V, typename C, typename A, typename G>
+template <typename F>
+void RadixTrie<K, V, C, A, G>::parallel_for_each(F &&fn, unsigned threads) {
+    if (threads == 0) {
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    auto ranges = split(threads * TasksPerThread);
+    radixParallelFor(ranges.size(), threads, [&ranges, &fn](size_t task) {
+        for (auto &value : ranges[task]) {
+            fn(value);
+        }
+    });
+}
+
+// The k best scored keys starting with prefix, best first; equal scores come
+// out in no particular order. Needs a RadixScoreAugment policy: the search
+// is best first over the subtree bounds, so a node is only expanded while
+// its bound can still beat the keys found so far and about k paths from
+// the prefix node are walked, however many keys share the prefix.
+template <typename K, typename V, typename C, typename A, typename G>
+auto RadixTrie<K, V, C, A, G>::topK(const key_view &prefix, size_type k) -> std::vector<iterator> {
+    static_assert(RadixScored<G>::value, "topK() needs subtree scores");
+    using node_type = RadixNode<K, V, C, G>;
+    using score_type = typename G::score_type;
+    // A subtree queued with its bound, or a single key with its own score;
+    // on equal scores the key goes first.
+    struct Entry {
+        score_type score;
+        bool exact;
+        node_type *node;
+    };
+    auto lower = [](const Entry &left, const Entry &right) {
+        return left.score < right.score || (left.score == right.score && left.exact < right.exact);
+    };
+    std::vector<iterator> result;
+    auto top = locatePrefix(prefix);
+    if (top == nullptr || k == 0) {
+        return result;
+    }
+    std::priority_queue<Entry, std::vector<Entry>, decltype(lower)> queue(lower);
+    queue.push({top->augment().best, top->empty(), top});
+    while (!queue.empty() && result.size() < k) {
+        auto entry = queue.top();
+        queue.pop();
+        if (entry.exact) {
+            result.emplace_back(entry.node, mRoot);
+            continue;
+        }
+        if (entry.node->isTerminal()) {
+            queue.push({G::score(entry.node->value()), true, entry.node});
+        }
+        for (auto child : entry.node->children()) {
+            queue.push({child->augment().best, child->empty(), child});
+        }
+    }
+    return result;
+}
+
+// Walks down key like findNode and calls visit(node) for each terminal on
+// the way; every fully matched node spells a prefix of key.
+template <typename K, typename V, typename C, typename A, typename G>
+template <typename F>
+void RadixTrie<K, V, C, A, G>::prefixesOf(const key_view &key, F &&visit) const {
+    if (mRoot == nullptr) {
         return;
     }
+    auto node = mRoot;
+    size_t depth = 0;
+    size_t size = radixSize(key);
+    if (node->isTerminal()) {
+        visit(node);
+    }
+    while (depth < size) {
+        auto child = node->children().find(radixByte(key, depth));
+        if (child == nullptr) {
+            return;
+        }
+        size_t edge = radixSize(child->key());
+        if (depth + edge > size ||
+                radixCommonPrefix(radixSlice(key, depth, edge), radixSlice(child->key(), 0, edge)) != edge) {
+            return;
+        }
+        node = child;
+        depth += edge;
+        if (node->isTerminal()) {
+            visit(node);
+        }
+    }
+}
+
+// Root node for read-only walks over the whole structure; nullptr until the
+// first insert.
+template <typename K, typename V, typename C, typename A, typename G>
+RadixNode<K, V, C, G>* RadixTrie<K, V, C, A, G>::root() const {
+    return mRoot;
+}
+
+// The tree dump runs on threads workers when asked to: each piece of
+// partition() is printed into its own buffer, with the "| " columns of its
+// ancestors worked out up front, and the buffers go out in order.
+template <typename K, typename V, typename C, typename A, typename G>
+void RadixTrie<K, V, C, A, G>::dump(RadixDump mode, std::ostream &out, unsigned threads) {
+    if (mode == RadixDump::Summary) {
+        stats().print(out);
+        return;
+    }
+    if (mRoot == nullptr) {
+        return;
+    }
+    if (threads <= 1) {
+        dump(mRoot, out);
+        return;
+    }
+    auto pieces = partition(threads * TasksPerThread);
+    std::vector<std::string> buffers(pieces.size());
+    radixParallelFor(pieces.size(), threads, [&](size_t task) {
+        auto node = pieces[task].first;
+        std::string prefix;
+        for (auto child = node; child->parent() != nullptr && child->parent()->parent() != nullptr;
+                child = child->parent()) {
+            auto parent = child->parent();
+            prefix.insert(0, parent->parent()->lastChild() == parent ? "  " : "| ");
+        }
+        std::ostringstream buffer;
+        if (pieces[task].second) {
+            dump(node, buffer, prefix);
+        } else {
+            if (node->parent() != nullptr) {
+                buffer << prefix << "+ ";
+            }
+            buffer << node->key() << (node->isTerminal() ? "$\n" : "\n");
+        }
+        buffers[task] = buffer.str();
+    });
+    for (const auto &buffer : buffers) {
+        out << buffer;
+    }
+}
+
+template <typename K, typename V, typename C, typename A, typename G>
+void RadixTrie<K, V, C, A, G>::dump(RadixNode<K, V, C, G> *node, std::ostream &out, const std::string &prefix) {
+    auto parent = node->parent();
     std::string pref = prefix;
     if (parent != nullptr) {
-        auto lastPtr = parent->children().rbegin()->second;
+        auto lastPtr = parent->lastChild();
         if (node != lastPtr) {
             pref += "| "s;
         } else {
             pref += "  "s;
         }
-        std::cout << prefix << "+ ";
+        out << prefix << "+ ";
     }
-    std::cout << node->key();
-    auto defaultKey = radixSubstr(node->key(), 0, 0);
-    if (auto sign = node->children().find(defaultKey); sign != node->children().end() && sign->second->isLeaf()) {
-        std::cout << "$";
+    out << node->key();
+    if (node->isTerminal()) {
+        out << "$";
     }
-    std::cout << std::endl;
+    out << "\n";
 
     for (auto child : node->children()) {
-        dump(child.second, pref);
+        dump(child, out, pref);
+    }
+}
+
+// One walk over every node. heapBytes is what the allocator has handed out
+// for nodes, values and child tables; key types that allocate on their own
+// (std::string edges) add to it outside the allocator.
+template <typename K, typename V, typename C, typename A, typename G>
+RadixStats RadixTrie<K, V, C, A, G>::stats() const {
+    RadixStats result;
+    result.keys = mSize;
+    result.heapBytes = mAlloc.bytesInUse();
+#ifdef RADIX_ENABLE_COUNTERS
+    result.counters = mCounters;
+#endif
+    if (mRoot == nullptr) {
+        return result;
+    }
+    std::vector<std::pair<RadixNode<K, V, C, G> *, size_t>> pending{{mRoot, 0}};
+    while (!pending.empty()) {
+        auto [node, level] = pending.back();
+        pending.pop_back();
+        result.addNode(level, node->size(), radixSize(node->key()));
+        for (auto child : node->children()) {
+            pending.emplace_back(child, level + 1);
+        }
     }
+    return result;
 }
 
 } // namespace Patricia
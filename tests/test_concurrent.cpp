@@ -0,0 +1,173 @@
+#define BOOST_TEST_MODULE concurrent_test_module
+#include "../src/radix_concurrent.h"
+#include <boost/test/unit_test.hpp>
+#include <atomic>
+#include <map>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+using Trie = Patricia::ConcurrentRadixTrie<std::string, size_t>;
+
+std::string makeKey(std::mt19937 &random) {
+    std::uniform_int_distribution<int> length(0, 6);
+    std::uniform_int_distribution<int> letter(0, 3);
+    std::string key(length(random), 'a');
+    for (auto &c : key) {
+        c = static_cast<char>('a' + letter(random));
+    }
+    return key;
+}
+
+size_t valueOf(const std::string &key) {
+    return std::hash<std::string>()(key);
+}
+
+}
+
+BOOST_AUTO_TEST_SUITE(concurrent_test_suite)
+BOOST_AUTO_TEST_CASE(concurrent_single_thread_against_map)
+{
+    std::mt19937 random(5);
+    Trie trie;
+    std::map<std::string, size_t> reference;
+    for (int step = 0; step < 5000; ++step) {
+        auto key = makeKey(random);
+        if (step % 3 == 2) {
+            BOOST_CHECK_EQUAL(trie.erase(key), reference.erase(key) == 1);
+        } else {
+            BOOST_CHECK_EQUAL(trie.insert(key, step), reference.insert({key, step}).second);
+        }
+        BOOST_REQUIRE_EQUAL(trie.size(), reference.size());
+    }
+    auto snapshot = trie.snapshot();
+    auto expected = reference.begin();
+    for (const auto &item : snapshot) {
+        BOOST_REQUIRE(expected != reference.end());
+        BOOST_CHECK_EQUAL(item.first, expected->first);
+        BOOST_CHECK_EQUAL(item.second, expected->second);
+        ++expected;
+    }
+    BOOST_CHECK(expected == reference.end());
+    for (const auto &item : reference) {
+        BOOST_CHECK(trie.find(item.first) == std::optional<size_t>(item.second));
+    }
+    size_t matched = 0;
+    for (const auto &item : snapshot.prefixMatch("ab")) {
+        BOOST_CHECK_EQUAL(item.first.compare(0, 2, "ab"), 0);
+        ++matched;
+    }
+    size_t wanted = 0;
+    for (auto it = reference.lower_bound("ab"); it != reference.end() && it->first.compare(0, 2, "ab") == 0; ++it) {
+        ++wanted;
+    }
+    BOOST_CHECK_EQUAL(matched, wanted);
+}
+
+BOOST_AUTO_TEST_CASE(concurrent_snapshot_is_stable)
+{
+    Trie trie;
+    trie.insert("alpha", 1);
+    trie.insert("alps", 2);
+    auto before = trie.snapshot();
+    trie.erase("alps");
+    trie.insert("alpine", 3);
+    std::vector<std::string> old;
+    for (const auto &item : before) {
+        old.push_back(item.first);
+    }
+    BOOST_CHECK(old == (std::vector<std::string>{"alpha", "alps"}));
+    BOOST_CHECK(!trie.contains("alps"));
+    BOOST_CHECK(trie.contains("alpine"));
+    BOOST_CHECK(before.find("alpine") == before.end());
+}
+
+BOOST_AUTO_TEST_CASE(concurrent_snapshots_beyond_one_chunk)
+{
+    Trie trie;
+    std::vector<Trie::Snapshot> snapshots;
+    for (size_t i = 0; i < 3 * Patricia::RadixEpoch::ChunkReaders; ++i) {
+        trie.insert("k" + std::to_string(i), i);
+        snapshots.push_back(trie.snapshot());
+        trie.erase("k" + std::to_string(i));
+    }
+    for (size_t i = 0; i < snapshots.size(); ++i) {
+        auto it = snapshots[i].find("k" + std::to_string(i));
+        BOOST_REQUIRE(it != snapshots[i].end());
+        BOOST_CHECK_EQUAL(it->second, i);
+    }
+    BOOST_CHECK(trie.empty());
+    snapshots.clear();
+    trie.insert("after", 1);
+    BOOST_CHECK(trie.contains("after"));
+}
+
+BOOST_AUTO_TEST_CASE(concurrent_readers_against_writer)
+{
+    Trie trie;
+    std::vector<std::string> stable;
+    for (const char *key : {"a", "abba", "b", "cab", "dddd", "dab"}) {
+        trie.insert(key, valueOf(key));
+        stable.emplace_back(key);
+    }
+    std::atomic<bool> done(false);
+    std::atomic<size_t> failures(0);
+    std::atomic<size_t> scans(0);
+    std::vector<std::thread> readers;
+    for (unsigned t = 0; t < 8; ++t) {
+        readers.emplace_back([&, t] {
+            std::mt19937 random(100 + t);
+            while (!done.load()) {
+                auto snapshot = trie.snapshot();
+                std::string previous;
+                bool first = true;
+                size_t found = 0;
+                for (const auto &item : snapshot) {
+                    if ((!first && item.first <= previous) || item.second != valueOf(item.first)) {
+                        ++failures;
+                    }
+                    previous = item.first;
+                    first = false;
+                    ++found;
+                }
+                for (const auto &key : stable) {
+                    auto it = snapshot.find(key);
+                    if (it == snapshot.end() || it->second != valueOf(key)) {
+                        ++failures;
+                    }
+                }
+                auto key = makeKey(random);
+                if (auto value = trie.find(key); value && *value != valueOf(key)) {
+                    ++failures;
+                }
+                if (found < stable.size()) {
+                    ++failures;
+                }
+                ++scans;
+            }
+        });
+    }
+
+    std::mt19937 random(1);
+    for (int step = 0; step < 20000; ++step) {
+        auto key = makeKey(random) + "x";
+        if (step % 2 == 0) {
+            trie.insert(key, valueOf(key));
+        } else {
+            trie.erase(key);
+        }
+    }
+    done = true;
+    for (auto &reader : readers) {
+        reader.join();
+    }
+    BOOST_CHECK_EQUAL(failures.load(), 0u);
+    BOOST_CHECK_GT(scans.load(), 0u);
+
+    trie.insert("quiet", valueOf("quiet"));
+    BOOST_CHECK_EQUAL(trie.retired(), 0u);
+}
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,112 @@
+#define BOOST_TEST_MODULE nickname_test_module
+#include "../src/nickname.h"
+#include "../src/nickname_io.h"
+#include <boost/test/unit_test.hpp>
+#include <algorithm>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <unistd.h>
+
+BOOST_AUTO_TEST_SUITE(nickname_test_suite)
+BOOST_AUTO_TEST_CASE(nickname_trie_output)
+{
+    Patricia::RadixTrie<std::string, int> trie;
+    for (auto word : {"aleksey", "sasha", "aleksandr", "alek", "alesha", "ab", "abc"}) {
+        trie.insert(word, 0);
+    }
+    std::ostringstream out;
+    Patricia::writeNicknames(trie, out);
+    BOOST_CHECK_EQUAL(out.str(),
+        "ab ab\n"
+        "abc abc\n"
+        "alek alek\n"
+        "aleksandr aleksa\n"
+        "aleksey alekse\n"
+        "alesha ales\n"
+        "sasha s\n");
+}
+
+BOOST_AUTO_TEST_CASE(nickname_stream_matches_trie)
+{
+    std::mt19937 random(3);
+    for (int round = 0; round < 50; ++round) {
+        std::uniform_int_distribution<int> length(0, 8);
+        std::uniform_int_distribution<int> letter(0, 2 + round % 5);
+        std::vector<std::string> words;
+        for (int i = 0; i < 100; ++i) {
+            std::string word(length(random), 'a');
+            for (auto &c : word) {
+                c = static_cast<char>('a' + letter(random));
+            }
+            words.push_back(word);
+        }
+        std::sort(words.begin(), words.end());
+
+        Patricia::RadixTrie<std::string, int> trie;
+        std::ostringstream streamed;
+        Patricia::NicknameStream stream(streamed);
+        for (const auto &word : words) {
+            trie.insert({word, 0});
+            stream.push(word);
+        }
+        stream.finish();
+        std::ostringstream built;
+        Patricia::writeNicknames(trie, built);
+        BOOST_REQUIRE_EQUAL(streamed.str(), built.str());
+        std::ostringstream tree;
+        trie.dump(Patricia::RadixDump::Tree, tree);
+        for (unsigned threads = 2; threads <= 5; ++threads) {
+            std::ostringstream parallel;
+            Patricia::writeNicknames(trie, parallel, threads);
+            BOOST_REQUIRE_EQUAL(parallel.str(), built.str());
+            std::ostringstream parallelTree;
+            trie.dump(Patricia::RadixDump::Tree, parallelTree, threads);
+            BOOST_REQUIRE_EQUAL(parallelTree.str(), tree.str());
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(nickname_stream_rejects_unsorted)
+{
+    std::ostringstream out;
+    Patricia::NicknameStream stream(out);
+    stream.push("b");
+    BOOST_CHECK_THROW(stream.push("a"), std::invalid_argument);
+}
+BOOST_AUTO_TEST_CASE(line_splitting)
+{
+    std::string longLine(Patricia::InputBuffer::ChunkSize * 3 / 2, 'x');
+    std::string text = "a\n\nbc\n" + longLine + "\n" + std::string(40, 'y') + "\nlast";
+    std::vector<std::string> expected;
+    std::istringstream in(text);
+    for (std::string line; getline(in, line);) {
+        expected.push_back(line);
+    }
+
+    std::vector<std::string> mapped;
+    Patricia::forEachLine(std::string_view(text), [&mapped](std::string_view line) {
+        mapped.emplace_back(line);
+    });
+    BOOST_CHECK(mapped == expected);
+
+    int fds[2];
+    BOOST_REQUIRE_EQUAL(pipe(fds), 0);
+    std::thread writer([&text, fd = fds[1]] {
+        Patricia::BufferedWriter out(fd, 4096);
+        out << std::string_view(text).substr(0, 10) << text[10]
+            << std::string_view(text).substr(11);
+        out.flush();
+        close(fd);
+    });
+    std::vector<std::string> streamed;
+    Patricia::forEachLine(fds[0], [&streamed](std::string_view line) {
+        streamed.emplace_back(line);
+    });
+    writer.join();
+    close(fds[0]);
+    BOOST_CHECK(streamed == expected);
+}
+BOOST_AUTO_TEST_SUITE_END()
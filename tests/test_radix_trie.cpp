@@ -0,0 +1,1521 @@
+#define BOOST_TEST_MODULE radix_trie_test_module
+#include "../src/radix_trie.h"
+#include "../src/radix_dawg.h"
+#include "../src/radix_frozen.h"
+#include "../src/nickname.h"
+#include "../src/radix_sharded.h"
+#include <boost/test/unit_test.hpp>
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <limits>
+#include <map>
+#include <mutex>
+#include <set>
+#include <random>
+#include <sstream>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <tuple>
+#include <vector>
+
+using Trie = Patricia::RadixTrie<std::string, int>;
+
+namespace {
+std::vector<std::string> keys(Trie &trie) {
+    std::vector<std::string> result;
+    for (auto it = trie.begin(); it != trie.end(); ++it) {
+        result.push_back(it->first);
+    }
+    return result;
+}
+
+// Path compression invariants: every edge below the root is non-empty and
+// starts with the byte it is indexed by, depths add up, and a node without
+// a value has at least two children.
+void checkShape(Trie &trie) {
+    auto root = trie.root();
+    if (root == nullptr) {
+        return;
+    }
+    std::vector<Patricia::RadixNode<std::string, int> *> pending{root};
+    while (!pending.empty()) {
+        auto node = pending.back();
+        pending.pop_back();
+        if (node != root) {
+            BOOST_REQUIRE(!node->key().empty());
+            BOOST_REQUIRE(node->isTerminal() || node->size() >= 2);
+        }
+        for (auto child : node->children()) {
+            BOOST_REQUIRE(child->parent() == node);
+            BOOST_REQUIRE_EQUAL(child->depth(), node->depth() + node->key().size());
+            BOOST_REQUIRE(node->children().find(static_cast<unsigned char>(child->key()[0])) == child);
+            pending.push_back(child);
+        }
+    }
+}
+}
+
+BOOST_AUTO_TEST_SUITE(radix_trie_test_suite)
+BOOST_AUTO_TEST_CASE(radix_trie_insert_find)
+{
+    Trie trie;
+    std::vector<std::string> words{"aleksey", "sasha", "aleksandr", "alek", "alesha"};
+    int index = 0;
+    for (const auto &word : words) {
+        BOOST_CHECK(trie.insert({word, index++}).second);
+    }
+    BOOST_CHECK(!trie.insert({"alek", 42}).second);
+    BOOST_CHECK_EQUAL(trie.size(), words.size());
+    index = 0;
+    for (const auto &word : words) {
+        auto it = trie.find(word);
+        BOOST_REQUIRE(it != trie.end());
+        BOOST_CHECK_EQUAL(it->first, word);
+        BOOST_CHECK_EQUAL(it->second, index++);
+    }
+    BOOST_CHECK(trie.find("ale") == trie.end());
+    BOOST_CHECK(trie.find("alekseyy") == trie.end());
+    std::vector<std::string> expected{"alek", "aleksandr", "aleksey", "alesha", "sasha"};
+    BOOST_CHECK(keys(trie) == expected);
+}
+
+BOOST_AUTO_TEST_CASE(radix_trie_terminal_nodes)
+{
+    Trie trie;
+    trie.insert({"ab", 1});
+    trie.insert({"abc", 2});
+    trie.insert({"abd", 3});
+    auto abd = trie.find("abd");
+    BOOST_REQUIRE(abd != trie.end());
+    BOOST_CHECK_EQUAL(abd.node()->parent(), trie.find("ab").node());
+    BOOST_CHECK_EQUAL(abd.node()->key(), "d");
+
+    BOOST_CHECK(trie.erase(std::string("ab")));
+    BOOST_CHECK(trie.find("ab") == trie.end());
+    BOOST_CHECK(trie.find("abc") != trie.end());
+    BOOST_CHECK(trie.erase(std::string("abc")));
+    BOOST_CHECK(trie.find("abd") == abd);
+    BOOST_CHECK_EQUAL(abd.node()->key(), "abd");
+    BOOST_CHECK(abd.node()->empty());
+
+    BOOST_CHECK(trie.insert({"", 4}).second);
+    BOOST_CHECK_EQUAL(trie.begin()->first, "");
+    BOOST_CHECK_EQUAL(trie.size(), 2u);
+}
+
+BOOST_AUTO_TEST_CASE(radix_trie_view_overloads)
+{
+    Trie trie;
+    std::string_view text = "nick:nickname:nicky";
+    BOOST_CHECK(trie.insert(text.substr(0, 4), 1).second);
+    BOOST_CHECK(trie.insert(text.substr(5, 8), 2).second);
+    BOOST_CHECK(trie.insert("nicky", 3).second);
+    BOOST_CHECK(!trie.insert(text.substr(14), 4).second);
+    BOOST_CHECK_EQUAL(trie.find(text.substr(5, 8))->second, 2);
+    BOOST_CHECK_EQUAL(trie.find("nicky")->second, 3);
+    BOOST_CHECK(trie.find(text.substr(0, 3)) == trie.end());
+
+    auto inUse = trie.allocator().bytesInUse();
+    BOOST_CHECK(!trie.insert("nick", 5).second);
+    BOOST_CHECK_EQUAL(trie.allocator().bytesInUse(), inUse);
+
+    BOOST_CHECK(trie.erase(text.substr(0, 4)));
+    BOOST_CHECK(!trie.erase("nick"));
+    BOOST_CHECK(trie.erase("nicky"));
+    BOOST_CHECK_EQUAL(trie.size(), 1u);
+}
+
+BOOST_AUTO_TEST_CASE(radix_trie_view_keys)
+{
+    std::string storage = "carrot car cart";
+    Patricia::RadixTrie<std::string_view, int> trie;
+    trie.insert({std::string_view(storage).substr(0, 6), 1});
+    trie.insert({std::string_view(storage).substr(7, 3), 2});
+    trie.insert({std::string_view(storage).substr(11, 4), 3});
+    std::vector<std::string_view> expected{"car", "carrot", "cart"};
+    std::vector<std::string_view> actual;
+    for (auto it = trie.begin(); it != trie.end(); ++it) {
+        actual.push_back(it->first);
+    }
+    BOOST_CHECK(actual == expected);
+    BOOST_CHECK(trie.erase("car"));
+    BOOST_CHECK_EQUAL(trie.find("cart")->second, 3);
+    BOOST_CHECK_EQUAL(trie.find("carrot")->second, 1);
+}
+
+BOOST_AUTO_TEST_CASE(radix_mismatch_kernels)
+{
+    using namespace Patricia::simd;
+    for (size_t size = 0; size < 200; size += 7) {
+        std::string left(size, 'k');
+        for (size_t pos = 0; pos <= size; ++pos) {
+            std::string right = left;
+            if (pos < size) {
+                right[pos] = static_cast<char>(0x80);
+            }
+            BOOST_CHECK_EQUAL(mismatchScalar(left.data(), right.data(), size), pos);
+            BOOST_CHECK_EQUAL(mismatch(left.data(), right.data(), size), pos);
+#ifdef RADIX_HAVE_SSE2
+            BOOST_CHECK_EQUAL(mismatchSse2(left.data(), right.data(), size), pos);
+#endif
+#ifdef RADIX_HAVE_AVX2
+            if (hasAvx2()) {
+                BOOST_CHECK_EQUAL(mismatchAvx2(left.data(), right.data(), size), pos);
+            }
+#endif
+        }
+    }
+    std::string longKey(300, 'x');
+    Trie trie;
+    trie.insert({longKey + "a", 1});
+    trie.insert({longKey + "b", 2});
+    trie.insert({longKey.substr(0, 150) + "y", 3});
+    BOOST_CHECK_EQUAL(trie.find(longKey + "b")->second, 2);
+    BOOST_CHECK_EQUAL(trie.find(longKey + "b").node()->depth(), 300u);
+    BOOST_CHECK(trie.find(longKey) == trie.end());
+}
+
+BOOST_AUTO_TEST_CASE(radix_child_probe_kernels)
+{
+    using namespace Patricia::simd;
+    const unsigned char sorted[] = {0x00, 0x01, 0x2f, 0x41, 0x61, 0x7f, 0x80, 0x81,
+        0x9a, 0xc0, 0xd5, 0xe0, 0xef, 0xf0, 0xfe, 0xff};
+    for (size_t size = 0; size <= 16; ++size) {
+        unsigned char keys[16] = {};
+        std::copy(sorted, sorted + size, keys);
+        for (int byte = 0; byte < 256; ++byte) {
+            auto value = static_cast<unsigned char>(byte);
+            auto found = std::find(keys, keys + size, value) - keys;
+            auto lower = std::lower_bound(keys, keys + size, value) - keys;
+            BOOST_CHECK_EQUAL(findKey16(keys, size, value), static_cast<size_t>(found));
+            BOOST_CHECK_EQUAL(lowerBound16(keys, size, value), static_cast<size_t>(lower));
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(radix_trie_bidirectional_bounds)
+{
+    std::mt19937 random(11);
+    std::uniform_int_distribution<int> length(1, 5);
+    std::uniform_int_distribution<int> letter(0, 2);
+    auto makeKey = [&]() {
+        std::string key(length(random), 'a');
+        for (auto &c : key) {
+            c = static_cast<char>('a' + letter(random));
+        }
+        return key;
+    };
+    Trie trie;
+    std::map<std::string, int> reference;
+    for (int i = 0; i < 200; ++i) {
+        auto key = makeKey();
+        trie.insert({key, i});
+        reference.insert({key, i});
+    }
+    std::vector<std::string> backwards;
+    for (auto it = trie.end(); it != trie.begin();) {
+        --it;
+        backwards.push_back(it->first);
+    }
+    std::vector<std::string> expected;
+    for (auto it = reference.rbegin(); it != reference.rend(); ++it) {
+        expected.push_back(it->first);
+    }
+    BOOST_CHECK(backwards == expected);
+
+    for (int i = 0; i < 300; ++i) {
+        auto probe = makeKey();
+        auto lower = trie.lower_bound(probe);
+        auto refLower = reference.lower_bound(probe);
+        if (refLower == reference.end()) {
+            BOOST_CHECK(lower == trie.end());
+        } else {
+            BOOST_REQUIRE(lower != trie.end());
+            BOOST_CHECK_EQUAL(lower->first, refLower->first);
+        }
+        auto upper = trie.upper_bound(probe);
+        auto refUpper = reference.upper_bound(probe);
+        if (refUpper == reference.end()) {
+            BOOST_CHECK(upper == trie.end());
+        } else {
+            BOOST_REQUIRE(upper != trie.end());
+            BOOST_CHECK_EQUAL(upper->first, refUpper->first);
+        }
+        auto range = trie.equal_range(probe);
+        BOOST_CHECK(range.first == lower);
+        BOOST_CHECK(range.second == upper);
+    }
+
+    auto first = trie.begin();
+    auto copy = first++;
+    BOOST_CHECK(copy == trie.begin());
+    BOOST_CHECK(--first == copy);
+    BOOST_CHECK(--trie.begin() == trie.end());
+}
+
+BOOST_AUTO_TEST_CASE(radix_trie_prefix_queries)
+{
+    Trie trie;
+    for (auto word : {"alek", "aleksandr", "aleksey", "alesha", "sasha", "sas", "bob"}) {
+        trie.insert(word, 0);
+    }
+    auto collect = [](auto range) {
+        std::vector<std::string> result;
+        for (auto it = range.begin(); it != range.end(); ++it) {
+            result.push_back(it->first);
+        }
+        return result;
+    };
+    BOOST_CHECK((collect(trie.prefixMatch("alek")) == std::vector<std::string>{"alek", "aleksandr", "aleksey"}));
+    BOOST_CHECK((collect(trie.prefixMatch("aleks")) == std::vector<std::string>{"aleksandr", "aleksey"}));
+    BOOST_CHECK((collect(trie.prefixMatch("al")) == std::vector<std::string>{"alek", "aleksandr", "aleksey", "alesha"}));
+    BOOST_CHECK((collect(trie.prefixMatch("sa")) == std::vector<std::string>{"sas", "sasha"}));
+    BOOST_CHECK(trie.prefixMatch("alex").empty());
+    BOOST_CHECK(trie.prefixMatch("bobby").empty());
+    BOOST_CHECK_EQUAL(collect(trie.prefixMatch("")).size(), trie.size());
+
+    BOOST_CHECK_EQUAL(trie.count_prefix("ale"), 4u);
+    BOOST_CHECK_EQUAL(trie.count_prefix("s"), 2u);
+    BOOST_CHECK_EQUAL(trie.count_prefix("z"), 0u);
+    auto limited = trie.prefixMatch("a", 2);
+    BOOST_REQUIRE_EQUAL(limited.size(), 2u);
+    BOOST_CHECK_EQUAL(limited[0]->first, "alek");
+    BOOST_CHECK_EQUAL(limited[1]->first, "aleksandr");
+}
+
+BOOST_AUTO_TEST_CASE(radix_trie_bulk_build)
+{
+    std::mt19937 random(5);
+    std::uniform_int_distribution<int> length(0, 7);
+    std::uniform_int_distribution<int> letter(0, 5);
+    std::vector<std::pair<std::string, int>> input;
+    for (int i = 0; i < 3000; ++i) {
+        std::string key(length(random), 'a');
+        for (auto &c : key) {
+            c = static_cast<char>('a' + letter(random));
+        }
+        input.emplace_back(key, i);
+    }
+    Trie inserted;
+    for (const auto &item : input) {
+        inserted.insert({item.first, item.second});
+    }
+    for (unsigned threads : {1u, 4u}) {
+        Trie built;
+        built.build(input.begin(), input.end(), false, threads);
+        BOOST_REQUIRE_EQUAL(built.size(), inserted.size());
+        auto left = built.begin();
+        for (auto right = inserted.begin(); right != inserted.end(); ++right, ++left) {
+            BOOST_REQUIRE(left != built.end());
+            BOOST_CHECK_EQUAL(left->first, right->first);
+            BOOST_CHECK_EQUAL(left->second, right->second);
+            BOOST_CHECK_EQUAL(left.node()->key(), right.node()->key());
+            BOOST_CHECK_EQUAL(left.node()->depth(), right.node()->depth());
+            BOOST_CHECK_EQUAL(left.node()->size(), right.node()->size());
+        }
+        BOOST_CHECK(left == built.end());
+
+        for (const auto &item : input) {
+            if (item.second % 2 == 0) {
+                built.erase(item.first);
+            }
+        }
+        built.insert({"zzzzzz", -1});
+        BOOST_CHECK_EQUAL(built.find("zzzzzz")->second, -1);
+    }
+
+    std::vector<std::pair<std::string, int>> sortedInput{{"a", 1}, {"ab", 2}, {"ab", 3}, {"b", 4}};
+    Trie sorted(sortedInput.begin(), sortedInput.end(), true);
+    BOOST_CHECK_EQUAL(sorted.size(), 3u);
+    BOOST_CHECK_EQUAL(sorted.find("ab")->second, 2);
+}
+
+namespace {
+// Heap policy whose allocations start failing once budget runs out, shared
+// by the private allocators of parallel builders.
+class FlakyHeap : public Patricia::RadixHeap {
+public:
+    static std::atomic<long> budget;
+
+    void* allocate(size_t size) {
+        if (budget.fetch_sub(1) <= 0) {
+            throw std::bad_alloc();
+        }
+        return RadixHeap::allocate(size);
+    }
+    template <typename T, typename... Args>
+    T* create(Args&&... args) {
+        void *place = allocate(sizeof(T));
+        try {
+            return new (place) T(std::forward<Args>(args)...);
+        } catch (...) {
+            deallocate(place, sizeof(T));
+            throw;
+        }
+    }
+    void merge(FlakyHeap &other) {
+        RadixHeap::merge(other);
+    }
+    bool adopt(FlakyHeap &other, void *ptr, size_t size) {
+        return RadixHeap::adopt(other, ptr, size);
+    }
+};
+
+std::atomic<long> FlakyHeap::budget{std::numeric_limits<long>::max()};
+
+struct Live {
+    static std::atomic<int> count;
+    explicit Live(int id) : id(id) { ++count; }
+    Live(const Live &other) : id(other.id) { ++count; }
+    ~Live() { --count; }
+    int id;
+};
+
+std::atomic<int> Live::count{0};
+}
+
+BOOST_AUTO_TEST_CASE(radix_trie_build_failure)
+{
+    using FlakyTrie = Patricia::RadixTrie<std::string, Live, std::less<std::string>, FlakyHeap>;
+    std::vector<std::pair<std::string, Live>> input;
+    for (int i = 0; i < 400; ++i) {
+        input.emplace_back(std::string(1, static_cast<char>('a' + i % 20)) + std::to_string(i * 7919), Live(i));
+    }
+    int baseline = Live::count;
+    for (unsigned threads : {1u, 4u}) {
+        bool built = false;
+        for (long budget = 0; !built; budget += 37) {
+            FlakyTrie trie;
+            FlakyHeap::budget = budget;
+            try {
+                trie.build(input.begin(), input.end(), false, threads);
+                built = true;
+            } catch (const std::bad_alloc &) {
+                BOOST_CHECK(trie.empty());
+                BOOST_CHECK_EQUAL(Live::count, baseline);
+                BOOST_CHECK_EQUAL(trie.allocator().bytesInUse(), 0u);
+            }
+            FlakyHeap::budget = std::numeric_limits<long>::max();
+            if (built) {
+                BOOST_CHECK_EQUAL(trie.size(), input.size());
+                BOOST_CHECK_EQUAL(trie.find(input[5].first)->second.id, 5);
+            }
+        }
+    }
+    BOOST_CHECK_EQUAL(Live::count, baseline);
+}
+
+BOOST_AUTO_TEST_CASE(radix_trie_insert_failure)
+{
+    using FlakyTrie = Patricia::RadixTrie<std::string, Live, std::less<std::string>, FlakyHeap>;
+    std::mt19937 random(9);
+    std::uniform_int_distribution<int> length(1, 6);
+    std::uniform_int_distribution<int> letter(0, 3);
+    std::uniform_int_distribution<long> budget(0, 3);
+    int baseline = Live::count;
+    {
+        FlakyTrie trie;
+        std::map<std::string, int> reference;
+        auto check = [&]() {
+            auto expected = reference.begin();
+            for (auto it = trie.begin(); it != trie.end(); ++it, ++expected) {
+                BOOST_REQUIRE(expected != reference.end());
+                BOOST_REQUIRE_EQUAL(it->first, expected->first);
+                BOOST_REQUIRE_EQUAL(it->second.id, expected->second);
+            }
+            BOOST_REQUIRE(expected == reference.end());
+        };
+        for (int step = 0; step < 3000; ++step) {
+            std::string key(length(random), 'a');
+            for (auto &c : key) {
+                c = static_cast<char>('a' + letter(random));
+            }
+            FlakyHeap::budget = budget(random);
+            try {
+                if (trie.try_emplace(key, step).second) {
+                    reference.emplace(key, step);
+                }
+            } catch (const std::bad_alloc &) {
+            }
+            FlakyHeap::budget = std::numeric_limits<long>::max();
+            BOOST_REQUIRE_EQUAL(trie.size(), reference.size());
+            BOOST_REQUIRE_EQUAL(Live::count, baseline + static_cast<int>(reference.size()));
+            if (step % 100 == 0) {
+                check();
+            }
+        }
+        check();
+        for (const auto &item : reference) {
+            BOOST_REQUIRE(trie.find(item.first) != trie.end());
+        }
+    }
+    BOOST_CHECK_EQUAL(Live::count, baseline);
+}
+
+BOOST_AUTO_TEST_CASE(radix_trie_erase_failure)
+{
+    using FlakyTrie = Patricia::RadixTrie<std::string, Live, std::less<std::string>, FlakyHeap>;
+    int baseline = Live::count;
+    {
+        FlakyTrie wide;
+        for (int i = 0; i < 20; ++i) {
+            wide.try_emplace(std::string(1, static_cast<char>('a' + i)), i);
+        }
+        for (int i = 0; i < 20; ++i) {
+            FlakyHeap::budget = 0;
+            BOOST_CHECK_NO_THROW(BOOST_CHECK(wide.erase(std::string(1, static_cast<char>('a' + i)))));
+            FlakyHeap::budget = std::numeric_limits<long>::max();
+            BOOST_REQUIRE_EQUAL(wide.size(), static_cast<size_t>(19 - i));
+            BOOST_REQUIRE_EQUAL(Live::count, baseline + 19 - i);
+        }
+
+        std::mt19937 random(13);
+        std::uniform_int_distribution<int> length(1, 24);
+        std::uniform_int_distribution<int> letter(0, 2);
+        FlakyTrie trie;
+        std::set<std::string> reference;
+        for (int step = 0; step < 4000; ++step) {
+            std::string key(length(random), 'a');
+            for (auto &c : key) {
+                c = static_cast<char>('a' + letter(random));
+            }
+            if (step % 3 == 2) {
+                FlakyHeap::budget = 0;
+                BOOST_REQUIRE_EQUAL(trie.erase(key), reference.erase(key) == 1);
+                FlakyHeap::budget = std::numeric_limits<long>::max();
+            } else if (trie.try_emplace(key, step).second) {
+                reference.insert(key);
+            }
+            BOOST_REQUIRE_EQUAL(trie.size(), reference.size());
+        }
+        auto expected = reference.begin();
+        for (auto it = trie.begin(); it != trie.end(); ++it, ++expected) {
+            BOOST_REQUIRE(expected != reference.end());
+            BOOST_REQUIRE_EQUAL(it->first, *expected);
+        }
+        BOOST_CHECK(expected == reference.end());
+        for (const auto &key : reference) {
+            BOOST_REQUIRE(trie.erase(key));
+        }
+        BOOST_CHECK(trie.begin() == trie.end());
+    }
+    BOOST_CHECK_EQUAL(Live::count, baseline);
+}
+
+BOOST_AUTO_TEST_CASE(radix_trie_arena_counters)
+{
+    Trie trie;
+    BOOST_CHECK_EQUAL(trie.allocator().bytesInUse(), 0u);
+    for (int i = 0; i < 1000; ++i) {
+        trie.insert({"key" + std::to_string(i), i});
+    }
+    BOOST_CHECK(trie.allocator().bytesInUse() > 0);
+    BOOST_CHECK(trie.allocator().bytesReserved() >= trie.allocator().bytesInUse());
+
+    BOOST_CHECK(trie.erase(std::string("key999")));
+    BOOST_CHECK(trie.find("key999") == trie.end());
+    auto reserved = trie.allocator().bytesReserved();
+    auto inUse = trie.allocator().bytesInUse();
+    trie.insert({"key999", 999});
+    BOOST_CHECK_EQUAL(trie.allocator().bytesReserved(), reserved);
+    BOOST_CHECK(trie.allocator().bytesInUse() > inUse);
+
+    trie.clear();
+    BOOST_CHECK(trie.empty());
+    BOOST_CHECK_EQUAL(trie.allocator().bytesReserved(), 0u);
+    BOOST_CHECK_EQUAL(trie.allocator().bytesInUse(), 0u);
+    trie.insert({"again", 1});
+    BOOST_CHECK(trie.find("again") != trie.end());
+}
+
+BOOST_AUTO_TEST_CASE(radix_trie_heap_policy)
+{
+    Patricia::RadixTrie<std::string, int, std::less<std::string>, Patricia::RadixHeap> trie;
+    trie.insert({"romane", 1});
+    trie.insert({"romanus", 2});
+    trie.insert({"romulus", 3});
+    BOOST_CHECK(trie.allocator().bytesInUse() > 0);
+    BOOST_CHECK(trie.find("romanus") != trie.end());
+    trie.clear();
+    BOOST_CHECK_EQUAL(trie.allocator().bytesInUse(), 0u);
+}
+BOOST_AUTO_TEST_CASE(radix_trie_wide_fanout)
+{
+    Trie trie;
+    const std::string zero(1, '\0');
+    std::vector<std::string> expected;
+    for (int byte = 255; byte > 0; --byte) {
+        std::string key(1, static_cast<char>(byte));
+        trie.insert({key + "x", byte});
+        trie.insert({zero + key, byte});
+    }
+    for (int byte = 1; byte < 256; ++byte) {
+        expected.push_back(std::string(1, static_cast<char>(byte)) + "x");
+    }
+    std::sort(expected.begin(), expected.end());
+    std::vector<std::string> zeroes;
+    for (int byte = 1; byte < 256; ++byte) {
+        zeroes.push_back(zero + std::string(1, static_cast<char>(byte)));
+    }
+    expected.insert(expected.end(), zeroes.begin(), zeroes.end());
+    std::sort(expected.begin(), expected.end());
+    BOOST_CHECK(keys(trie) == expected);
+
+    for (int byte = 1; byte < 250; ++byte) {
+        BOOST_CHECK(trie.erase(zero + std::string(1, static_cast<char>(byte))));
+    }
+    BOOST_CHECK_EQUAL(trie.size(), 255u + 6u);
+    BOOST_CHECK(trie.find(zero + std::string(1, static_cast<char>(252))) != trie.end());
+    BOOST_CHECK(trie.find(zero + std::string(1, static_cast<char>(2))) == trie.end());
+}
+
+BOOST_AUTO_TEST_CASE(radix_frozen_snapshot)
+{
+    using Frozen = Patricia::FrozenRadixTrie<int>;
+    std::mt19937 random(11);
+    std::uniform_int_distribution<int> length(1, 7);
+    std::uniform_int_distribution<int> letter(0, 3);
+    Trie trie;
+    std::map<std::string, int> reference;
+    for (int i = 0; i < 3000; ++i) {
+        std::string key(length(random), 'a');
+        for (auto &c : key) {
+            c = static_cast<char>('a' + letter(random));
+        }
+        trie.insert({key, i});
+        reference.insert({key, i});
+    }
+
+    std::ostringstream stream;
+    Frozen::write(trie, stream);
+    auto image = stream.str();
+    std::vector<char> buffer(image.begin(), image.end());
+    Frozen frozen(buffer.data(), buffer.size());
+    BOOST_CHECK_EQUAL(frozen.size(), reference.size());
+    BOOST_CHECK_EQUAL(frozen.bytes(), buffer.size());
+    std::ostringstream frozenTree;
+    std::ostringstream tree;
+    frozen.dump(frozenTree);
+    trie.dump(Patricia::RadixDump::Tree, tree);
+    BOOST_CHECK(!frozenTree.str().empty());
+    BOOST_CHECK_EQUAL(frozenTree.str(), tree.str());
+
+    auto expected = reference.begin();
+    for (auto item : frozen) {
+        BOOST_REQUIRE(expected != reference.end());
+        BOOST_CHECK_EQUAL(std::string(item.first), expected->first);
+        BOOST_CHECK_EQUAL(item.second, expected->second);
+        ++expected;
+    }
+    BOOST_CHECK(expected == reference.end());
+
+    for (const auto &item : reference) {
+        auto it = frozen.find(item.first);
+        BOOST_REQUIRE(it != frozen.end());
+        BOOST_CHECK_EQUAL(it->second, item.second);
+        BOOST_CHECK(frozen.find(item.first + "e") == frozen.end());
+    }
+    BOOST_CHECK(frozen.find("") == frozen.end());
+    for (std::string prefix : {"", "a", "ab", "abc", "dddd", "e", "abcdabcd"}) {
+        std::vector<std::string> matched;
+        for (auto item : frozen.prefixMatch(prefix)) {
+            matched.emplace_back(item.first);
+        }
+        std::vector<std::string> wanted;
+        for (auto it = reference.lower_bound(prefix);
+                it != reference.end() && it->first.compare(0, prefix.size(), prefix) == 0; ++it) {
+            wanted.push_back(it->first);
+        }
+        BOOST_CHECK(matched == wanted);
+        BOOST_CHECK_EQUAL(frozen.count_prefix(prefix), wanted.size());
+        BOOST_CHECK_EQUAL(frozen.prefixMatch(prefix, 2).size(), std::min<size_t>(2, wanted.size()));
+    }
+
+    const std::string path = "radix_frozen_snapshot.bin";
+    Frozen::write(trie, path);
+    auto mapped = Frozen::open(path);
+    std::remove(path.c_str());
+    BOOST_CHECK_EQUAL(mapped.size(), reference.size());
+    BOOST_CHECK_EQUAL(mapped.find("abc") != mapped.end(), reference.count("abc") == 1);
+
+    Trie empty;
+    std::ostringstream nothing;
+    Frozen::write(empty, nothing);
+    auto emptyImage = nothing.str();
+    std::vector<char> emptyBuffer(emptyImage.begin(), emptyImage.end());
+    Frozen emptyFrozen(emptyBuffer.data(), emptyBuffer.size());
+    BOOST_CHECK(emptyFrozen.empty());
+    BOOST_CHECK(emptyFrozen.begin() == emptyFrozen.end());
+
+    BOOST_CHECK_NO_THROW(frozen.verify());
+    BOOST_CHECK_NO_THROW(emptyFrozen.verify());
+    Patricia::FrozenRadixHeader header;
+    std::memcpy(&header, buffer.data(), sizeof(header));
+    auto corrupt = [&](size_t index, auto field, uint64_t value) {
+        auto *node = reinterpret_cast<Patricia::FrozenRadixNode *>(buffer.data() + header.nodesOffset) + index;
+        auto saved = node->*field;
+        node->*field = static_cast<std::remove_reference_t<decltype(node->*field)>>(value);
+        BOOST_CHECK_THROW(frozen.verify(), std::runtime_error);
+        node->*field = saved;
+    };
+    using Node = Patricia::FrozenRadixNode;
+    corrupt(5, &Node::edgeOffset, header.poolSize);
+    corrupt(5, &Node::edgeLength, header.poolSize + 1);
+    corrupt(0, &Node::children, header.childCount - 1);
+    corrupt(0, &Node::childCount, 0xffff);
+    corrupt(0, &Node::end, header.nodeCount + 1);
+    corrupt(7, &Node::end, 7);
+    corrupt(9, &Node::rank, header.keyCount);
+    corrupt(3, &Node::nodeDepth, 1000);
+    auto *childNodes = reinterpret_cast<uint32_t *>(buffer.data() + header.childNodesOffset);
+    childNodes[0] = static_cast<uint32_t>(header.nodeCount);
+    BOOST_CHECK_THROW(frozen.verify(), std::runtime_error);
+
+    buffer[0] = 'X';
+    BOOST_CHECK_THROW(Frozen(buffer.data(), buffer.size()), std::runtime_error);
+    BOOST_CHECK_THROW(Frozen(buffer.data(), 8), std::runtime_error);
+}
+
+BOOST_AUTO_TEST_CASE(radix_sharded_trie)
+{
+    std::vector<std::string> words;
+    std::mt19937 random(13);
+    std::uniform_int_distribution<int> length(0, 6);
+    std::uniform_int_distribution<int> letter(0, 25);
+    for (int i = 0; i < 4000; ++i) {
+        std::string word(length(random), 'a');
+        for (auto &c : word) {
+            c = static_cast<char>('a' + letter(random));
+        }
+        words.push_back(word);
+    }
+    using Sharded = Patricia::ShardedRadixTrie<std::string, int>;
+    auto splits = Sharded::splitsFor(words.begin(), words.end(), 4);
+    BOOST_CHECK_EQUAL(splits.size(), 3u);
+    BOOST_CHECK_THROW(Sharded(std::vector<unsigned char>{'b', 'a'}), std::invalid_argument);
+
+    std::vector<std::unique_ptr<Sharded>> variants;
+    variants.push_back(std::make_unique<Sharded>(splits));
+    variants.push_back(std::make_unique<Sharded>(7));
+    for (auto &sharded : variants) {
+        std::vector<std::thread> producers;
+        for (size_t t = 0; t < 4; ++t) {
+            producers.emplace_back([&sharded, &words, t] {
+                for (size_t i = t; i < words.size(); i += 4) {
+                    sharded->insert(words[i], static_cast<int>(words[i].size()));
+                }
+            });
+        }
+        for (auto &producer : producers) {
+            producer.join();
+        }
+        std::set<std::string> reference(words.begin(), words.end());
+        BOOST_CHECK_EQUAL(sharded->size(), reference.size());
+        std::vector<std::string> iterated;
+        for (const auto &item : *sharded) {
+            iterated.push_back(item.first);
+            BOOST_CHECK_EQUAL(item.second, static_cast<int>(item.first.size()));
+        }
+        BOOST_CHECK(iterated == std::vector<std::string>(reference.begin(), reference.end()));
+        BOOST_CHECK(sharded->find("") == std::optional<int>(0));
+        BOOST_CHECK(sharded->erase(*reference.rbegin()));
+        BOOST_CHECK(!sharded->contains(*reference.rbegin()));
+        sharded->clear();
+        BOOST_CHECK(sharded->begin() == sharded->end());
+    }
+}
+
+BOOST_AUTO_TEST_CASE(radix_trie_find_batch)
+{
+    std::mt19937 random(17);
+    std::uniform_int_distribution<int> length(0, 8);
+    std::uniform_int_distribution<int> letter(0, 3);
+    std::vector<std::string> words;
+    for (int i = 0; i < 2000; ++i) {
+        std::string word(length(random), 'a');
+        for (auto &c : word) {
+            c = static_cast<char>('a' + letter(random));
+        }
+        words.push_back(word);
+    }
+    Trie trie;
+    std::vector<std::string_view> empty{"", "a", "b"};
+    std::vector<Trie::iterator> emptyOut(3);
+    bool emptyFound[3];
+    trie.findBatch(empty.data(), empty.size(), emptyOut.data());
+    trie.containsBatch(empty.data(), empty.size(), emptyFound);
+    for (size_t i = 0; i < empty.size(); ++i) {
+        BOOST_CHECK(emptyOut[i] == trie.end());
+        BOOST_CHECK(!emptyFound[i]);
+    }
+    for (size_t i = 0; i < words.size(); i += 2) {
+        trie.insert({words[i], static_cast<int>(i)});
+    }
+    for (size_t count : {size_t(0), size_t(1), size_t(17), words.size()}) {
+        std::vector<std::string_view> keys(words.begin(), words.begin() + count);
+        std::vector<Trie::iterator> out(count);
+        std::unique_ptr<bool[]> found(new bool[count + 1]);
+        trie.findBatch(keys.data(), count, out.data());
+        trie.containsBatch(keys.data(), count, found.get());
+        for (size_t i = 0; i < count; ++i) {
+            BOOST_CHECK(out[i] == trie.find(keys[i]));
+            BOOST_CHECK_EQUAL(found[i], trie.find(keys[i]) != trie.end());
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(radix_trie_stats)
+{
+    Patricia::RadixTrie<std::string, int> trie;
+    BOOST_CHECK_EQUAL(trie.stats().nodes, 0);
+    for (auto key : {"romane", "romanus", "romulus", "rubens", "ruber", "rubicon", "rubicundus"}) {
+        trie.insert(key, 0);
+    }
+    auto stats = trie.stats();
+    BOOST_CHECK_EQUAL(stats.keys, 7);
+    // root, r, om, an, e, us, ulus, ub, e, ns, r, ic, on, undus
+    BOOST_CHECK_EQUAL(stats.nodes, 14);
+    BOOST_CHECK_EQUAL(stats.leaves, 7);
+    BOOST_CHECK_EQUAL(stats.edgeBytes, 27);
+    BOOST_CHECK_EQUAL(stats.depthHistogram.size(), 5);
+    BOOST_CHECK_EQUAL(stats.depthHistogram[0], 1);
+    BOOST_CHECK_EQUAL(stats.depthHistogram[1], 1);
+    BOOST_CHECK_EQUAL(stats.fanoutHistogram[0], 7);
+    BOOST_CHECK_EQUAL(stats.fanoutHistogram[1], 1);
+    BOOST_CHECK_EQUAL(stats.fanoutHistogram[2], 6);
+    BOOST_CHECK_EQUAL(stats.edgeLengthHistogram[0], 1);
+    BOOST_CHECK(stats.heapBytes > 0);
+    BOOST_CHECK(stats.bytesPerKey() > 0);
+
+    std::ostringstream summary;
+    trie.dump(Patricia::RadixDump::Summary, summary);
+    BOOST_CHECK(summary.str().find("nodes 14") != std::string::npos);
+    std::ostringstream tree;
+    trie.dump(Patricia::RadixDump::Tree, tree);
+    auto lines = tree.str();
+    BOOST_CHECK_EQUAL(std::count(lines.begin(), lines.end(), '\n'), 14);
+
+    trie.erase("romanus");
+    trie.find("rubens");
+#ifdef RADIX_ENABLE_COUNTERS
+    BOOST_CHECK_EQUAL(trie.stats().counters.inserts, 7);
+    BOOST_CHECK_EQUAL(trie.stats().counters.splits, 6);
+    BOOST_CHECK_EQUAL(trie.stats().counters.merges, 1);
+    BOOST_CHECK_EQUAL(trie.stats().counters.finds, 1);
+#else
+    BOOST_CHECK_EQUAL(trie.stats().counters.inserts, 0);
+#endif
+}
+
+namespace {
+
+// Mapped value that counts how it is constructed.
+struct Record {
+    static int copies;
+    static int moves;
+    Record() = default;
+    explicit Record(int id) : id(id) { }
+    Record(const Record &other) : id(other.id) { ++copies; }
+    Record(Record &&other) noexcept : id(other.id) { ++moves; }
+    Record& operator=(const Record &other) { id = other.id; ++copies; return *this; }
+    Record& operator=(Record &&other) noexcept { id = other.id; ++moves; return *this; }
+    int id = 0;
+};
+
+int Record::copies = 0;
+int Record::moves = 0;
+
+}
+
+BOOST_AUTO_TEST_CASE(radix_trie_emplace)
+{
+    Patricia::RadixTrie<std::string, Record> trie;
+    Record::copies = Record::moves = 0;
+    BOOST_CHECK(trie.try_emplace("alpha", 1).second);
+    BOOST_CHECK(trie.emplace(std::piecewise_construct, std::forward_as_tuple("alps"),
+            std::forward_as_tuple(2)).second);
+    BOOST_CHECK_EQUAL(Record::copies + Record::moves, 0);
+
+    Record record(3);
+    BOOST_CHECK(!trie.try_emplace("alpha", std::move(record)).second);
+    BOOST_CHECK_EQUAL(Record::moves, 0);
+    BOOST_CHECK(!trie.emplace("alps", Record(4)).second);
+    BOOST_CHECK_EQUAL(trie.find("alps")->second.id, 2);
+
+    BOOST_CHECK(trie.insert(std::make_pair(std::string("al"), Record(5))).second);
+    BOOST_CHECK_EQUAL(Record::copies, 0);
+    BOOST_CHECK(!trie.insert_or_assign("al", Record(6)).second);
+    BOOST_CHECK(trie.insert_or_assign("alt", Record(7)).second);
+    BOOST_CHECK_EQUAL(trie.find("al")->second.id, 6);
+    BOOST_CHECK_EQUAL(trie["alt"].id, 7);
+    BOOST_CHECK_EQUAL(trie["beta"].id, 0);
+    trie["beta"].id = 8;
+    BOOST_CHECK_EQUAL(trie.find("beta")->second.id, 8);
+    BOOST_CHECK_EQUAL(trie.size(), 5);
+    BOOST_CHECK_EQUAL(Record::copies, 0);
+}
+
+BOOST_AUTO_TEST_CASE(radix_trie_extract)
+{
+    using Trie = Patricia::RadixTrie<std::string, Record>;
+    Trie trie;
+    for (auto key : {"romane", "romanus", "romulus", "rubens"}) {
+        trie.try_emplace(key, static_cast<int>(std::string(key).size()));
+    }
+    BOOST_CHECK(trie.extract("roman").empty());
+    auto handle = trie.extract("romanus");
+    BOOST_REQUIRE(!handle.empty());
+    BOOST_CHECK_EQUAL(handle.key(), "romanus");
+    BOOST_CHECK_EQUAL(handle.mapped().id, 7);
+    BOOST_CHECK_EQUAL(trie.size(), 3);
+    BOOST_CHECK(trie.find("romanus") == trie.end());
+    BOOST_CHECK(trie.find("romane") != trie.end());
+
+    auto address = &handle.value();
+    Record::copies = Record::moves = 0;
+    auto back = trie.insert(std::move(handle));
+    BOOST_CHECK(back.inserted);
+    BOOST_CHECK(back.node.empty());
+    BOOST_CHECK(handle.empty());
+    BOOST_CHECK_EQUAL(&*back.position, address);
+    BOOST_CHECK_EQUAL(Record::copies + Record::moves, 0);
+
+    Trie other;
+    other.try_emplace("rubens", 0);
+    auto taken = other.insert(trie.extract(trie.find("rubens")));
+    BOOST_CHECK(!taken.inserted);
+    BOOST_REQUIRE(!taken.node.empty());
+    BOOST_CHECK_EQUAL(taken.node.mapped().id, 6);
+    BOOST_CHECK_EQUAL(trie.size(), 3);
+
+    auto moved = other.insert(trie.extract("romulus"));
+    BOOST_CHECK(moved.inserted);
+    BOOST_CHECK_EQUAL(Record::copies, 0);
+    BOOST_CHECK_EQUAL(other.size(), 2);
+    BOOST_CHECK_EQUAL(other.find("romulus")->second.id, 7);
+    BOOST_CHECK(trie.insert(std::move(taken.node)).inserted);
+    std::vector<std::string> keys;
+    for (const auto &value : trie) {
+        keys.push_back(value.first);
+    }
+    BOOST_CHECK((keys == std::vector<std::string>{"romane", "romanus", "rubens"}));
+
+    Trie::node_type kept;
+    {
+        Trie source;
+        source.try_emplace(std::string(40, 'k'), 40);
+        source.try_emplace("kept", 4);
+        kept = source.extract("kept");
+        source.try_emplace("later", 5);
+    }
+    BOOST_REQUIRE(!kept.empty());
+    BOOST_CHECK_EQUAL(kept.key(), "kept");
+    BOOST_CHECK_EQUAL(kept.mapped().id, 4);
+    BOOST_CHECK(other.insert(std::move(kept)).inserted);
+    BOOST_CHECK_EQUAL(other.find("kept")->second.id, 4);
+
+    using HeapTrie = Patricia::RadixTrie<std::string, Record, std::less<std::string>, Patricia::RadixHeap>;
+    HeapTrie left;
+    HeapTrie right;
+    left.try_emplace("heap", 4);
+    auto adopted = left.extract("heap");
+    auto place = &adopted.value();
+    auto held = left.allocator().bytesInUse();
+    Record::copies = Record::moves = 0;
+    BOOST_CHECK(right.insert(std::move(adopted)).inserted);
+    BOOST_CHECK_EQUAL(&*right.find("heap"), place);
+    BOOST_CHECK_EQUAL(Record::copies + Record::moves, 0);
+    BOOST_CHECK_EQUAL(held - left.allocator().bytesInUse(), sizeof(HeapTrie::value_type));
+    auto orphan = right.extract("heap");
+    right.clear();
+    BOOST_CHECK_EQUAL(orphan.mapped().id, 4);
+}
+
+BOOST_AUTO_TEST_CASE(radix_trie_erase_prefix_and_range)
+{
+    Trie trie;
+    for (auto key : {"", "app", "apple", "applet", "apply", "apt", "banana", "band", "bandana"}) {
+        trie.insert(key, 0);
+    }
+    BOOST_CHECK_EQUAL(trie.erase_prefix("appl"), 3);
+    BOOST_CHECK_EQUAL(trie.erase_prefix("appl"), 0);
+    BOOST_CHECK_EQUAL(trie.erase_prefix("c"), 0);
+    BOOST_CHECK((keys(trie) == std::vector<std::string>{"", "app", "apt", "banana", "band", "bandana"}));
+    checkShape(trie);
+
+    auto last = trie.erase(trie.find("apt"), trie.find("bandana"));
+    BOOST_CHECK(last == trie.find("bandana"));
+    BOOST_CHECK((keys(trie) == std::vector<std::string>{"", "app", "bandana"}));
+    checkShape(trie);
+
+    BOOST_CHECK(trie.erase(trie.begin(), trie.begin()) == trie.begin());
+    BOOST_CHECK_EQUAL(trie.size(), 3);
+    BOOST_CHECK(trie.erase(std::next(trie.begin()), trie.end()) == trie.end());
+    BOOST_CHECK((keys(trie) == std::vector<std::string>{""}));
+    BOOST_CHECK_EQUAL(trie.erase_prefix(""), 1);
+    BOOST_CHECK(trie.empty());
+    trie.insert("again", 1);
+    BOOST_CHECK((keys(trie) == std::vector<std::string>{"again"}));
+}
+
+BOOST_AUTO_TEST_CASE(radix_trie_random_bulk_erase)
+{
+    std::mt19937 random(11);
+    auto makeKey = [&](size_t maxLength) {
+        std::string key(random() % (maxLength + 1), 'a');
+        for (auto &c : key) {
+            c = static_cast<char>('a' + random() % 3);
+        }
+        return key;
+    };
+    for (int round = 0; round < 200; ++round) {
+        Trie trie;
+        std::map<std::string, int> reference;
+        for (int i = 0; i < 60; ++i) {
+            auto key = makeKey(6);
+            trie.insert(key, i);
+            reference.insert({key, i});
+        }
+        for (int step = 0; step < 6 && !reference.empty(); ++step) {
+            if (step % 2 == 0) {
+                auto prefix = makeKey(3);
+                size_t expected = 0;
+                for (auto it = reference.lower_bound(prefix);
+                        it != reference.end() && it->first.compare(0, prefix.size(), prefix) == 0;) {
+                    it = reference.erase(it);
+                    ++expected;
+                }
+                BOOST_REQUIRE_EQUAL(trie.erase_prefix(prefix), expected);
+            } else {
+                auto from = makeKey(4);
+                auto to = makeKey(4);
+                if (to < from) {
+                    std::swap(from, to);
+                }
+                reference.erase(reference.lower_bound(from), reference.lower_bound(to));
+                trie.erase(trie.lower_bound(from), trie.lower_bound(to));
+            }
+            BOOST_REQUIRE_EQUAL(trie.size(), reference.size());
+            checkShape(trie);
+            std::vector<std::string> expected;
+            for (const auto &item : reference) {
+                expected.push_back(item.first);
+            }
+            BOOST_REQUIRE(keys(trie) == expected);
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(radix_trie_longest_prefix_match)
+{
+    Trie routes;
+    BOOST_CHECK(routes.longestPrefixMatch("/api") == routes.end());
+    for (auto route : {"/", "/api/", "/api/v1/", "/api/v1/users", "/static/"}) {
+        routes.insert(route, static_cast<int>(std::string(route).size()));
+    }
+    BOOST_CHECK_EQUAL(routes.longestPrefixMatch("/api/v1/users/42")->first, "/api/v1/users");
+    BOOST_CHECK_EQUAL(routes.longestPrefixMatch("/api/v1/user")->first, "/api/v1/");
+    BOOST_CHECK_EQUAL(routes.longestPrefixMatch("/api/v2/")->first, "/api/");
+    BOOST_CHECK_EQUAL(routes.longestPrefixMatch("/apix")->first, "/");
+    BOOST_CHECK_EQUAL(routes.longestPrefixMatch("/static/")->first, "/static/");
+    BOOST_CHECK(routes.longestPrefixMatch("api") == routes.end());
+
+    std::vector<std::string> found;
+    for (auto it : routes.allPrefixesOf("/api/v1/users?id=1")) {
+        found.push_back(it->first);
+    }
+    BOOST_CHECK((found == std::vector<std::string>{"/", "/api/", "/api/v1/", "/api/v1/users"}));
+    BOOST_CHECK(routes.allPrefixesOf("").empty());
+    routes.insert("", 0);
+    BOOST_CHECK_EQUAL(routes.allPrefixesOf("x").size(), 1);
+    BOOST_CHECK_EQUAL(routes.longestPrefixMatch("x")->first, "");
+}
+
+BOOST_AUTO_TEST_CASE(radix_trie_fuzzy_find)
+{
+    auto levenshtein = [](const std::string &left, const std::string &right) {
+        std::vector<size_t> row(right.size() + 1);
+        for (size_t j = 0; j < row.size(); ++j) {
+            row[j] = j;
+        }
+        for (size_t i = 1; i <= left.size(); ++i) {
+            size_t diagonal = row[0];
+            row[0] = i;
+            for (size_t j = 1; j <= right.size(); ++j) {
+                size_t above = row[j];
+                row[j] = std::min({row[j] + 1, row[j - 1] + 1, diagonal + (left[i - 1] != right[j - 1])});
+                diagonal = above;
+            }
+        }
+        return row.back();
+    };
+    std::mt19937 random(17);
+    auto makeKey = [&]() {
+        std::string key(random() % 7, 'a');
+        for (auto &c : key) {
+            c = static_cast<char>('a' + random() % 4);
+        }
+        return key;
+    };
+    Trie trie;
+    std::set<std::string> reference;
+    for (int i = 0; i < 400; ++i) {
+        auto key = makeKey();
+        trie.insert(key, i);
+        reference.insert(key);
+    }
+    for (int query = 0; query < 100; ++query) {
+        auto key = makeKey();
+        for (size_t distance = 0; distance <= 2; ++distance) {
+            std::vector<std::pair<std::string, size_t>> expected;
+            for (const auto &word : reference) {
+                if (auto d = levenshtein(word, key); d <= distance) {
+                    expected.emplace_back(word, d);
+                }
+            }
+            std::vector<std::pair<std::string, size_t>> found;
+            for (const auto &match : trie.fuzzyFind(key, distance)) {
+                found.emplace_back(match.first->first, match.second);
+            }
+            BOOST_REQUIRE(found == expected);
+            auto limited = trie.fuzzyFind(key, distance, 2);
+            BOOST_REQUIRE_EQUAL(limited.size(), std::min<size_t>(2, expected.size()));
+        }
+    }
+    auto near = trie.fuzzyFind("", 0);
+    BOOST_CHECK(near.size() == reference.count(""));
+}
+
+BOOST_AUTO_TEST_CASE(radix_trie_top_k)
+{
+    using Score = Patricia::RadixScoreAugment<int>;
+    using ScoredTrie = Patricia::RadixTrie<std::string, int, std::less<std::string>, Patricia::RadixArena, Score>;
+    using Node = Patricia::RadixNode<std::string, int, std::less<std::string>, Score>;
+    std::function<int(Node *)> checkBounds = [&](Node *node) {
+        int best = node->isTerminal() ? node->value().second : std::numeric_limits<int>::lowest();
+        for (auto child : node->children()) {
+            best = std::max(best, checkBounds(child));
+        }
+        BOOST_REQUIRE_EQUAL(node->augment().best, best);
+        return best;
+    };
+    std::mt19937 random(23);
+    auto makeKey = [&]() {
+        std::string key(1 + random() % 6, 'a');
+        for (auto &c : key) {
+            c = static_cast<char>('a' + random() % 4);
+        }
+        return key;
+    };
+    ScoredTrie trie;
+    std::map<std::string, int> reference;
+    auto check = [&]() {
+        if (trie.root() != nullptr) {
+            checkBounds(trie.root());
+        }
+        for (const auto &prefix : std::vector<std::string>{"", "a", "bc", makeKey()}) {
+            for (size_t k : {1, 5, 50}) {
+                std::vector<int> expected;
+                for (const auto &[key, score] : reference) {
+                    if (key.compare(0, prefix.size(), prefix) == 0) {
+                        expected.push_back(score);
+                    }
+                }
+                std::sort(expected.rbegin(), expected.rend());
+                expected.resize(std::min(k, expected.size()));
+                std::vector<int> found;
+                std::set<std::string> keys;
+                for (auto it : trie.topK(prefix, k)) {
+                    BOOST_REQUIRE(it->first.compare(0, prefix.size(), prefix) == 0);
+                    BOOST_REQUIRE_EQUAL(reference.at(it->first), it->second);
+                    found.push_back(it->second);
+                    keys.insert(it->first);
+                }
+                BOOST_REQUIRE(found == expected);
+                BOOST_REQUIRE_EQUAL(keys.size(), found.size());
+            }
+        }
+    };
+    for (int step = 1; step <= 3000; ++step) {
+        auto key = makeKey();
+        int score = static_cast<int>(random() % 1000);
+        switch (random() % 8) {
+        case 0: {
+            auto prefix = key.substr(0, 3);
+            auto first = reference.lower_bound(prefix);
+            auto last = reference.lower_bound(prefix + "\xff");
+            BOOST_REQUIRE_EQUAL(trie.erase_prefix(prefix), static_cast<size_t>(std::distance(first, last)));
+            reference.erase(first, last);
+            break;
+        }
+        case 1:
+        case 2:
+            BOOST_REQUIRE_EQUAL(trie.erase(key), reference.erase(key) == 1);
+            break;
+        case 3:
+            trie.insert_or_assign(key, score);
+            reference[key] = score;
+            break;
+        default:
+            trie.insert(key, score);
+            reference.emplace(key, score);
+            break;
+        }
+        if (step % 100 == 0) {
+            check();
+        }
+    }
+
+    trie["bcd"] = 5000;
+    reference["bcd"] = 5000;
+    trie.refresh(trie.find("bcd"));
+    BOOST_REQUIRE_EQUAL(trie.topK("b", 1).front()->first, "bcd");
+    check();
+
+    std::vector<std::pair<std::string, int>> values(reference.begin(), reference.end());
+    trie.build(values.begin(), values.end(), true, 1);
+    check();
+    trie.build(values.begin(), values.end(), true, 4);
+    check();
+    BOOST_CHECK(trie.topK("zz", 3).empty());
+    BOOST_CHECK(trie.topK("", 0).empty());
+}
+
+BOOST_AUTO_TEST_CASE(radix_trie_order_statistics)
+{
+    using Counted = Patricia::RadixAugments<Patricia::RadixScoreAugment<int>, Patricia::RadixCountAugment>;
+    using CountedTrie = Patricia::RadixTrie<std::string, int, std::less<std::string>, Patricia::RadixArena, Counted>;
+    using Node = Patricia::RadixNode<std::string, int, std::less<std::string>, Counted>;
+    std::function<size_t(Node *)> checkCounts = [&](Node *node) {
+        size_t count = node->isTerminal();
+        for (auto child : node->children()) {
+            count += checkCounts(child);
+        }
+        BOOST_REQUIRE_EQUAL(node->augment().count, count);
+        return count;
+    };
+    std::mt19937 random(29);
+    auto makeKey = [&]() {
+        std::string key(random() % 6, 'a');
+        for (auto &c : key) {
+            c = static_cast<char>('a' + random() % 4);
+        }
+        return key;
+    };
+    CountedTrie trie;
+    std::map<std::string, int> reference;
+    auto check = [&]() {
+        if (trie.root() != nullptr) {
+            checkCounts(trie.root());
+        }
+        for (int query = 0; query < 20; ++query) {
+            auto key = makeKey();
+            auto first = reference.lower_bound(key);
+            BOOST_REQUIRE_EQUAL(trie.rank(key), static_cast<size_t>(std::distance(reference.begin(), first)));
+            auto last = reference.lower_bound(key + "\xff");
+            BOOST_REQUIRE_EQUAL(trie.count_prefix(key), static_cast<size_t>(std::distance(first, last)));
+        }
+        size_t index = 0;
+        for (const auto &entry : reference) {
+            auto it = trie.select(index);
+            BOOST_REQUIRE(it != trie.end());
+            BOOST_REQUIRE_EQUAL(it->first, entry.first);
+            auto jump = static_cast<std::ptrdiff_t>(random() % (reference.size() + 1)) -
+                    static_cast<std::ptrdiff_t>(index);
+            auto target = trie.select(index + jump);
+            BOOST_REQUIRE(it.advance(jump) == target);
+            ++index;
+        }
+        BOOST_REQUIRE(trie.select(reference.size()) == trie.end());
+        if (!reference.empty()) {
+            BOOST_REQUIRE_EQUAL(trie.end().advance(-1)->first, reference.rbegin()->first);
+        }
+    };
+    for (int step = 1; step <= 2000; ++step) {
+        auto key = makeKey();
+        switch (random() % 6) {
+        case 0:
+            trie.erase_prefix(key.substr(0, 2));
+            reference.erase(reference.lower_bound(key.substr(0, 2)), reference.lower_bound(key.substr(0, 2) + "\xff"));
+            break;
+        case 1:
+            BOOST_REQUIRE_EQUAL(trie.erase(key), reference.erase(key) == 1);
+            break;
+        default:
+            trie.insert(key, step);
+            reference.emplace(key, step);
+            break;
+        }
+        if (step % 200 == 0) {
+            check();
+        }
+    }
+    std::vector<std::pair<std::string, int>> values(reference.begin(), reference.end());
+    trie.build(values.begin(), values.end(), true, 4);
+    check();
+    BOOST_REQUIRE(trie.topK("", 1).front()->second == std::max_element(values.begin(), values.end(),
+            [](const auto &left, const auto &right) { return left.second < right.second; })->second);
+
+    // Without counts advance() steps and gives the same answer.
+    Trie plain;
+    for (const auto &entry : values) {
+        plain.insert(entry.first, entry.second);
+    }
+    auto it = plain.begin();
+    it.advance(static_cast<std::ptrdiff_t>(values.size() / 2));
+    BOOST_CHECK_EQUAL(it->first, values[values.size() / 2].first);
+    BOOST_CHECK_EQUAL(plain.count_prefix("a"), trie.count_prefix("a"));
+}
+
+BOOST_AUTO_TEST_CASE(radix_trie_parallel_for_each)
+{
+    using CountedTrie = Patricia::RadixTrie<std::string, int, std::less<std::string>, Patricia::RadixArena,
+            Patricia::RadixCountAugment>;
+    std::mt19937 random(31);
+    std::vector<std::pair<std::string, int>> values;
+    for (int i = 0; i < 5000; ++i) {
+        std::string key(random() % 9, 'a');
+        for (auto &c : key) {
+            c = static_cast<char>('a' + random() % (i < 2500 ? 3 : 20));
+        }
+        values.emplace_back(key, i);
+    }
+    Trie trie(values.begin(), values.end());
+    CountedTrie counted(values.begin(), values.end());
+    std::vector<std::string> expected;
+    for (const auto &entry : trie) {
+        expected.push_back(entry.first);
+    }
+
+    auto checkSplit = [&expected](auto &t, size_t parts) {
+        std::vector<std::string> keys;
+        size_t largest = 0;
+        auto ranges = t.split(parts);
+        for (const auto &range : ranges) {
+            BOOST_REQUIRE(!range.empty());
+            size_t size = 0;
+            for (const auto &entry : range) {
+                keys.push_back(entry.first);
+                ++size;
+            }
+            largest = std::max(largest, size);
+        }
+        BOOST_REQUIRE(keys == expected);
+        return largest;
+    };
+    for (size_t parts : {1, 2, 7, 64, 100000}) {
+        checkSplit(trie, parts);
+        BOOST_CHECK(checkSplit(counted, parts) <= std::max<size_t>(1, expected.size() / parts));
+    }
+
+    std::mutex lock;
+    std::multiset<std::string> visited;
+    std::atomic<long> sum{0};
+    counted.parallel_for_each([&](auto &entry) {
+        sum += entry.second;
+        std::lock_guard<std::mutex> guard(lock);
+        visited.insert(entry.first);
+    }, 4);
+    BOOST_CHECK(std::equal(visited.begin(), visited.end(), expected.begin(), expected.end()));
+    long total = 0;
+    for (const auto &entry : trie) {
+        total += entry.second;
+    }
+    BOOST_CHECK_EQUAL(sum.load(), total);
+    trie.parallel_for_each([](auto &entry) {
+        entry.second = -1;
+    }, 3);
+    BOOST_CHECK(std::all_of(trie.begin(), trie.end(), [](const auto &entry) { return entry.second == -1; }));
+
+    Trie empty;
+    BOOST_CHECK(empty.split(4).empty());
+    empty.parallel_for_each([](auto &) { BOOST_ERROR("called on an empty trie"); }, 2);
+
+    BOOST_CHECK_THROW(Patricia::radixParallelFor(1000, 4, [](size_t task) {
+        if (task == 10) {
+            throw std::runtime_error("task failed");
+        }
+    }), std::runtime_error);
+}
+
+BOOST_AUTO_TEST_CASE(radix_dawg)
+{
+    std::mt19937 random(37);
+    const char *endings[] = {"", "_tv", "_official", "123", "1", "_tv1"};
+    std::vector<std::pair<std::string, int>> values;
+    for (int i = 0; i < 3000; ++i) {
+        std::string key(random() % 5, 'a');
+        for (auto &c : key) {
+            c = static_cast<char>('a' + random() % 6);
+        }
+        values.emplace_back(key + endings[random() % 6], i);
+    }
+    Trie trie(values.begin(), values.end());
+    Patricia::RadixDawg<int> dawg(trie);
+    BOOST_REQUIRE_EQUAL(dawg.size(), trie.size());
+    BOOST_CHECK(dawg.nodeCount() < trie.stats().nodes / 2);
+
+    size_t index = 0;
+    auto it = dawg.begin();
+    for (auto node = trie.begin(); node != trie.end(); ++node, ++it, ++index) {
+        BOOST_REQUIRE(it != dawg.end());
+        BOOST_REQUIRE_EQUAL(it->first, node->first);
+        BOOST_REQUIRE_EQUAL(it->second, node->second);
+        BOOST_REQUIRE_EQUAL(it.index(), index);
+        size_t nickname = std::min(node->first.size(), Patricia::nicknameLength(node.node()));
+        BOOST_REQUIRE_EQUAL(it.uniquePrefix(), nickname);
+        BOOST_REQUIRE_EQUAL(dawg.uniquePrefix(node->first), nickname);
+        BOOST_REQUIRE_EQUAL(dawg.index(node->first), index);
+        auto found = dawg.find(node->first);
+        BOOST_REQUIRE(found == it);
+        BOOST_REQUIRE_EQUAL(found.key(), node->first);
+        BOOST_REQUIRE_EQUAL(found.value(), node->second);
+        if (std::next(node) != trie.end()) {
+            BOOST_REQUIRE_EQUAL(std::next(found).key(), std::next(node)->first);
+        }
+    }
+    BOOST_CHECK(it == dawg.end());
+    for (int query = 0; query < 1000; ++query) {
+        std::string key(random() % 8, 'a');
+        for (auto &c : key) {
+            c = static_cast<char>('a' + random() % 7);
+        }
+        bool stored = trie.find(key) != trie.end();
+        BOOST_REQUIRE_EQUAL(dawg.find(key) != dawg.end(), stored);
+        BOOST_REQUIRE_EQUAL(dawg.index(key) != dawg.npos, stored);
+        BOOST_REQUIRE_EQUAL(dawg.uniquePrefix(key) != dawg.npos, stored);
+    }
+
+    Trie empty;
+    Patricia::RadixDawg<int> none(empty);
+    BOOST_CHECK(none.begin() == none.end());
+    BOOST_CHECK(none.find("") == none.end());
+    Trie single;
+    single.insert("", 7);
+    Patricia::RadixDawg<int> root(single);
+    BOOST_REQUIRE(root.find("") != root.end());
+    BOOST_CHECK_EQUAL(root.begin()->second, 7);
+    BOOST_CHECK_EQUAL(root.uniquePrefix(""), 0u);
+    BOOST_CHECK(std::next(root.begin()) == root.end());
+}
+
+BOOST_AUTO_TEST_CASE(radix_critbit_integer_keys)
+{
+    std::mt19937_64 random(13);
+    Patricia::RadixTrie<uint64_t, int> trie;
+    std::map<uint64_t, int> reference;
+    for (int step = 0; step < 20000; ++step) {
+        // narrow and wide keys so that both short and long branches occur
+        uint64_t key = step % 2 == 0 ? random() % 512 : random();
+        if (step % 3 == 2) {
+            BOOST_REQUIRE_EQUAL(trie.erase(key), reference.erase(key) == 1);
+        } else {
+            BOOST_REQUIRE_EQUAL(trie.insert(key, step).second, reference.insert({key, step}).second);
+        }
+        uint64_t probe = random() % 1024;
+        auto lower = trie.lower_bound(probe);
+        auto expected = reference.lower_bound(probe);
+        BOOST_REQUIRE_EQUAL(lower == trie.end(), expected == reference.end());
+        if (expected != reference.end()) {
+            BOOST_REQUIRE_EQUAL(lower->first, expected->first);
+        }
+    }
+    BOOST_REQUIRE_EQUAL(trie.size(), reference.size());
+    auto it = trie.begin();
+    for (const auto &item : reference) {
+        BOOST_REQUIRE(it != trie.end());
+        BOOST_REQUIRE_EQUAL(it->first, item.first);
+        BOOST_REQUIRE_EQUAL(it->second, item.second);
+        BOOST_REQUIRE(trie.find(item.first) == it);
+        ++it;
+    }
+    BOOST_CHECK(it == trie.end());
+    auto back = trie.end();
+    for (auto item = reference.rbegin(); item != reference.rend(); ++item) {
+        BOOST_REQUIRE_EQUAL((--back)->first, item->first);
+    }
+    BOOST_CHECK(back == trie.begin());
+    BOOST_CHECK(trie.upper_bound(~uint64_t(0)) == trie.end());
+}
+
+BOOST_AUTO_TEST_CASE(radix_critbit_prefix_and_wide_keys)
+{
+    auto address = [](uint32_t a, uint32_t b, uint32_t c, uint32_t d) {
+        return a << 24 | b << 16 | c << 8 | d;
+    };
+    Patricia::RadixTrie<uint32_t, std::string> hosts;
+    hosts[address(10, 0, 0, 1)] = "gateway";
+    hosts[address(10, 0, 1, 7)] = "db";
+    hosts[address(10, 1, 0, 1)] = "other";
+    hosts[address(192, 168, 0, 1)] = "home";
+    BOOST_CHECK(!hosts.try_emplace(address(10, 0, 1, 7), "ignored").second);
+    std::vector<std::string> names;
+    for (const auto &host : hosts.prefixMatch(address(10, 0, 0, 0), 16)) {
+        names.push_back(host.second);
+    }
+    BOOST_CHECK((names == std::vector<std::string>{"gateway", "db"}));
+    BOOST_CHECK(hosts.prefixMatch(address(172, 16, 0, 0), 12).empty());
+    size_t all = 0;
+    for (auto it = hosts.prefixMatch(0, 0).begin(); it != hosts.end(); ++it) {
+        ++all;
+    }
+    BOOST_CHECK_EQUAL(all, 4);
+    hosts.erase(hosts.find(address(10, 0, 0, 1)));
+    BOOST_CHECK_EQUAL(hosts.begin()->second, "db");
+
+    using Wide = Patricia::RadixUint128;
+    Patricia::RadixTrie<Wide, int> wide;
+    Wide high = Wide(1) << 127;
+    for (Wide key : {high, Wide(3), high | 1, Wide(1) << 64, Wide(0)}) {
+        wide.insert(key, 0);
+    }
+    std::vector<Wide> order;
+    for (const auto &item : wide) {
+        order.push_back(item.first);
+    }
+    BOOST_CHECK((order == std::vector<Wide>{0, 3, Wide(1) << 64, high, high | 1}));
+    BOOST_CHECK(wide.lower_bound(4)->first == Wide(1) << 64);
+    BOOST_CHECK(wide.find(2) == wide.end());
+}
+
+BOOST_AUTO_TEST_CASE(radix_trie_random_against_map)
+{
+    std::mt19937 random(7);
+    std::uniform_int_distribution<int> length(0, 6);
+    std::uniform_int_distribution<int> letter(0, 3);
+    auto makeKey = [&]() {
+        std::string key(length(random), 'a');
+        for (auto &c : key) {
+            c = static_cast<char>('a' + letter(random));
+        }
+        return key;
+    };
+    Trie trie;
+    std::map<std::string, int> reference;
+    for (int step = 0; step < 5000; ++step) {
+        auto key = makeKey();
+        if (key.empty()) {
+            continue;
+        }
+        if (step % 3 == 2) {
+            BOOST_CHECK_EQUAL(trie.erase(key), reference.erase(key) == 1);
+        } else {
+            BOOST_CHECK_EQUAL(trie.insert({key, step}).second, reference.insert({key, step}).second);
+        }
+        BOOST_REQUIRE_EQUAL(trie.size(), reference.size());
+    }
+    checkShape(trie);
+    std::vector<std::string> expected;
+    for (const auto &item : reference) {
+        expected.push_back(item.first);
+        auto it = trie.find(item.first);
+        BOOST_REQUIRE(it != trie.end());
+        BOOST_CHECK_EQUAL(it->second, item.second);
+    }
+    BOOST_CHECK(keys(trie) == expected);
+}
+BOOST_AUTO_TEST_SUITE_END()